@@ -0,0 +1,399 @@
+// Measures the resource helpers of LveDevice in isolation on a headless device: buffer and image
+// creation per memory property class and size, findMemoryType lookups, copyBuffer and
+// copyBufferToImage throughput, and the latency of an empty single time command round trip.
+// Every case reports the median and the fastest of its repetitions.
+//
+//   DeviceBench [--repetitions N] [--csv results.csv]
+
+#include "lve_device.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using lve::LveDevice;
+using Clock = std::chrono::steady_clock;
+
+constexpr VkDeviceSize KIB = 1024;
+constexpr VkDeviceSize MIB = 1024 * KIB;
+constexpr uint32_t FIND_MEMORY_TYPE_CALLS = 10000;
+
+// keeps results that are only measured from being optimized away
+volatile uint32_t sink;
+
+struct MemoryClass {
+  const char *name;
+  VkMemoryPropertyFlags properties;
+};
+
+const MemoryClass MEMORY_CLASSES[] = {
+    {"device local", VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT},
+    {"host coherent",
+     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT},
+    {"host cached", VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT},
+    {"device local host visible",
+     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT},
+};
+
+// sizes swept by the buffer cases, 4 KiB to 64 MiB in steps of 4
+std::vector<VkDeviceSize> bufferSizes() {
+  std::vector<VkDeviceSize> sizes;
+  for (VkDeviceSize size = 4 * KIB; size <= 64 * MIB; size *= 4) sizes.push_back(size);
+  return sizes;
+}
+
+struct Timing {
+  double median = 0.0;
+  double min = 0.0;
+};
+
+// Runs the case repetitions times, each run returns the microseconds it measured
+Timing measure(uint32_t repetitions, const std::function<double()> &run) {
+  std::vector<double> samples;
+  samples.reserve(repetitions);
+  for (uint32_t i = 0; i < repetitions; i++) samples.push_back(run());
+  std::sort(samples.begin(), samples.end());
+  return {samples[samples.size() / 2], samples.front()};
+}
+
+double microseconds(Clock::time_point start, Clock::time_point end) {
+  return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+std::string sizeName(VkDeviceSize size) {
+  char buffer[32];
+  if (size >= MIB) {
+    std::snprintf(buffer, sizeof(buffer), "%llu MiB", static_cast<unsigned long long>(size / MIB));
+  } else {
+    std::snprintf(buffer, sizeof(buffer), "%llu KiB", static_cast<unsigned long long>(size / KIB));
+  }
+  return buffer;
+}
+
+// Rows are printed as they are measured and kept for the csv
+class Report {
+ public:
+  explicit Report(const std::string &csvPath) {
+    if (csvPath.empty()) return;
+    csv = std::fopen(csvPath.c_str(), "w");
+    if (!csv) throw std::runtime_error("failed to open " + csvPath);
+    std::fprintf(csv, "case,memory,size,median_us,min_us,throughput_gib_s\n");
+  }
+  ~Report() {
+    if (csv) std::fclose(csv);
+  }
+
+  Report(const Report &) = delete;
+  Report &operator=(const Report &) = delete;
+
+  void section(const char *title) {
+    std::printf(
+        "\n%s\n%-28s %10s %12s %12s %12s\n",
+        title,
+        "",
+        "size",
+        "median us",
+        "min us",
+        "GiB/s");
+  }
+
+  // bytes is 0 for cases without a throughput
+  void row(
+      const char *name,
+      const char *memory,
+      const std::string &size,
+      Timing timing,
+      VkDeviceSize bytes = 0) {
+    double throughput =
+        bytes ? static_cast<double>(bytes) / (1024.0 * 1024.0 * 1024.0) / (timing.median * 1e-6)
+              : 0.0;
+    std::printf(
+        "%-28s %10s %12.2f %12.2f",
+        memory,
+        size.c_str(),
+        timing.median,
+        timing.min);
+    if (bytes) std::printf(" %12.2f", throughput);
+    std::printf("\n");
+
+    if (csv) {
+      std::fprintf(
+          csv,
+          "%s,%s,%s,%.3f,%.3f,",
+          name,
+          memory,
+          size.c_str(),
+          timing.median,
+          timing.min);
+      if (bytes) std::fprintf(csv, "%.3f", throughput);
+      std::fprintf(csv, "\n");
+    }
+  }
+
+ private:
+  FILE *csv = nullptr;
+};
+
+void destroyBuffer(LveDevice &device, VkBuffer buffer, VkDeviceMemory memory) {
+  vkDestroyBuffer(device.device(), buffer, nullptr);
+  device.freeMemory(memory);
+}
+
+// Whether any memory type of a buffer has the properties, so unsupported classes are skipped
+// instead of createBuffer throwing
+bool supportsBufferMemory(LveDevice &device, VkMemoryPropertyFlags properties) {
+  VkBuffer buffer;
+  VkDeviceMemory memory;
+  device.createBuffer(
+      4 * KIB,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+      buffer,
+      memory);
+  VkMemoryRequirements requirements;
+  vkGetBufferMemoryRequirements(device.device(), buffer, &requirements);
+  destroyBuffer(device, buffer, memory);
+
+  uint32_t memoryTypeIndex;
+  return device.tryFindMemoryType(requirements.memoryTypeBits, properties, memoryTypeIndex);
+}
+
+void benchFindMemoryType(LveDevice &device, Report &report, uint32_t repetitions) {
+  report.section("findMemoryType, per call");
+  for (const auto &memoryClass : MEMORY_CLASSES) {
+    uint32_t memoryTypeIndex;
+    if (!device.tryFindMemoryType(UINT32_MAX, memoryClass.properties, memoryTypeIndex)) continue;
+
+    Timing timing = measure(repetitions, [&]() {
+      auto start = Clock::now();
+      for (uint32_t i = 0; i < FIND_MEMORY_TYPE_CALLS; i++) {
+        sink = device.findMemoryType(UINT32_MAX, memoryClass.properties);
+      }
+      auto end = Clock::now();
+      return microseconds(start, end) / FIND_MEMORY_TYPE_CALLS;
+    });
+    report.row(
+        "findMemoryType", memoryClass.name, "type " + std::to_string(memoryTypeIndex), timing);
+  }
+}
+
+void benchCreateBuffer(LveDevice &device, Report &report, uint32_t repetitions) {
+  report.section("createBuffer, create and allocate only");
+  for (const auto &memoryClass : MEMORY_CLASSES) {
+    if (!supportsBufferMemory(device, memoryClass.properties)) continue;
+
+    for (VkDeviceSize size : bufferSizes()) {
+      Timing timing = measure(repetitions, [&]() {
+        VkBuffer buffer;
+        VkDeviceMemory memory;
+        auto start = Clock::now();
+        device.createBuffer(
+            size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            memoryClass.properties,
+            buffer,
+            memory);
+        auto end = Clock::now();
+        destroyBuffer(device, buffer, memory);
+        return microseconds(start, end);
+      });
+      report.row("createBuffer", memoryClass.name, sizeName(size), timing);
+    }
+  }
+}
+
+// Host visible staging to device local, the upload path of LveModel
+void benchCopyBuffer(LveDevice &device, Report &report, uint32_t repetitions) {
+  report.section("copyBuffer, staging to device local, includes submit and wait");
+  for (VkDeviceSize size : bufferSizes()) {
+    VkBuffer staging, destination;
+    VkDeviceMemory stagingMemory, destinationMemory;
+    device.createBuffer(
+        size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        staging,
+        stagingMemory);
+    device.createBuffer(
+        size,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        destination,
+        destinationMemory);
+
+    void *data;
+    vkMapMemory(device.device(), stagingMemory, 0, size, 0, &data);
+    std::memset(data, 0xab, static_cast<size_t>(size));
+    vkUnmapMemory(device.device(), stagingMemory);
+
+    Timing timing = measure(repetitions, [&]() {
+      auto start = Clock::now();
+      device.copyBuffer(staging, destination, size);
+      return microseconds(start, Clock::now());
+    });
+    report.row("copyBuffer", "device local", sizeName(size), timing, size);
+
+    destroyBuffer(device, staging, stagingMemory);
+    destroyBuffer(device, destination, destinationMemory);
+  }
+}
+
+VkImageCreateInfo imageCreateInfo(uint32_t size, VkImageUsageFlags usage) {
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+  imageInfo.extent = {size, size, 1};
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.usage = usage;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  return imageInfo;
+}
+
+const uint32_t IMAGE_SIZES[] = {256, 1024, 2048, 4096};
+
+void benchCreateImage(LveDevice &device, Report &report, uint32_t repetitions) {
+  report.section("createImageWithInfo, RGBA8 device local, create and allocate only");
+  for (uint32_t size : IMAGE_SIZES) {
+    auto imageInfo = imageCreateInfo(
+        size, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+    Timing timing = measure(repetitions, [&]() {
+      VkImage image;
+      VkDeviceMemory memory;
+      auto start = Clock::now();
+      device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, memory);
+      auto end = Clock::now();
+      vkDestroyImage(device.device(), image, nullptr);
+      device.freeMemory(memory);
+      return microseconds(start, end);
+    });
+    report.row(
+        "createImageWithInfo",
+        "device local",
+        std::to_string(size) + "x" + std::to_string(size),
+        timing);
+  }
+}
+
+void benchCopyBufferToImage(LveDevice &device, Report &report, uint32_t repetitions) {
+  report.section("copyBufferToImage, RGBA8, includes submit and wait");
+  for (uint32_t size : IMAGE_SIZES) {
+    VkDeviceSize bytes = static_cast<VkDeviceSize>(size) * size * 4;
+    VkBuffer staging;
+    VkDeviceMemory stagingMemory;
+    device.createBuffer(
+        bytes,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        staging,
+        stagingMemory);
+
+    VkImage image;
+    VkDeviceMemory imageMemory;
+    device.createImageWithInfo(
+        imageCreateInfo(size, VK_IMAGE_USAGE_TRANSFER_DST_BIT),
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        image,
+        imageMemory);
+
+    // copyBufferToImage expects the image in TRANSFER_DST_OPTIMAL
+    VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier);
+    device.endSingleTimeCommands(commandBuffer);
+
+    Timing timing = measure(repetitions, [&]() {
+      auto start = Clock::now();
+      device.copyBufferToImage(staging, image, size, size, 1);
+      return microseconds(start, Clock::now());
+    });
+    report.row(
+        "copyBufferToImage",
+        "device local",
+        std::to_string(size) + "x" + std::to_string(size),
+        timing,
+        bytes);
+
+    vkDestroyImage(device.device(), image, nullptr);
+    device.freeMemory(imageMemory);
+    destroyBuffer(device, staging, stagingMemory);
+  }
+}
+
+// Cost of the submit and vkQueueWaitIdle every helper above pays, with nothing recorded
+void benchSingleTimeCommands(LveDevice &device, Report &report, uint32_t repetitions) {
+  report.section("beginSingleTimeCommands + endSingleTimeCommands, empty");
+  Timing timing = measure(repetitions, [&]() {
+    auto start = Clock::now();
+    device.endSingleTimeCommands(device.beginSingleTimeCommands());
+    return microseconds(start, Clock::now());
+  });
+  report.row("singleTimeCommands", "", "", timing);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  uint32_t repetitions = 20;
+  std::string csvPath;
+  for (int i = 1; i < argc; i += 2) {
+    std::string name = argv[i];
+    if (name == "--repetitions" && i + 1 < argc) {
+      repetitions = std::max(1, std::atoi(argv[i + 1]));
+    } else if (name == "--csv" && i + 1 < argc) {
+      csvPath = argv[i + 1];
+    } else {
+      std::cerr << "usage: DeviceBench [--repetitions N] [--csv results.csv]\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  try {
+    LveDevice device;
+    std::printf("%s, best and median of %u\n", device.properties.deviceName, repetitions);
+
+    Report report{csvPath};
+    benchFindMemoryType(device, report, repetitions);
+    benchCreateBuffer(device, report, repetitions);
+    benchCreateImage(device, report, repetitions);
+    benchSingleTimeCommands(device, report, repetitions);
+    benchCopyBuffer(device, report, repetitions);
+    benchCopyBufferToImage(device, report, repetitions);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
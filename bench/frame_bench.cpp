@@ -0,0 +1,814 @@
+// Renders a synthetic scene offscreen on a headless device and reports, per frame, the CPU time
+// spent recording the command buffer, the time vkQueueSubmit takes, the GPU time between the
+// first and last command, and the frame time, with percentiles over the run.
+//
+//   FrameBench --objects 10000 --triangles 64 --pipelines 8 --frames 500 --json result.json
+//
+// The scene is generated from --seed and every frame records the same commands, so runs with
+// the same arguments on the same device do the same work and can be compared across commits.
+//
+// Every pipeline draws with a combination of the color effects in simple_shader_effects.glsl.
+// --shader specialized builds one pipeline per combination from simple_shader.frag with the
+// effects as specialization constants. --shader uber draws everything with the one pipeline
+// of simple_shader_uber.frag and passes the effects as a push constant, so the same scene
+// compares pipeline binds against push constants and runtime branches in the shader.
+// Works on any device with dynamic rendering and synchronization2, including lavapipe
+// (VK_ICD_FILENAMES=<path to lvp_icd.json>) on machines without a GPU.
+//
+// --first-use sync|async leaves the specialized pipelines uncompiled until the first measured
+// frame, which is when the scene first needs them. Until a variant is compiled its objects draw
+// with the uber pipeline. sync compiles every variant while recording that frame, async hands
+// them to LvePipelineCompiler and keeps drawing with the fallback until each one is ready, so
+// the per frame CSV shows whether first use costs a spike. Compiles are only cold with the
+// driver's shader cache off, e.g. MESA_SHADER_CACHE_DISABLE=true.
+//
+// --samples renders into a multisampled color and depth target that is resolved into the
+// single sample image at the end of the pass. A list like --samples 1,2,4,8 runs the same
+// scene once per count on the same device and ends with their frame times side by side, with
+// --csv and --json written per count as <name>_<count>x<extension>.
+
+#include "lve_device.hpp"
+#include "lve_model.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_pipeline_compiler.hpp"
+#include "lve_pipeline_registry.hpp"
+#include "lve_render_graph.hpp"
+#include "lve_render_queue.hpp"
+#include "lve_thread_pool.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace lve;
+using Clock = std::chrono::steady_clock;
+
+constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+constexpr VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+// grayscale, contrast and posterize on or off, see simple_shader_effects.glsl
+constexpr uint32_t EFFECT_COMBINATIONS = 8;
+
+struct Config {
+  uint32_t objects = 1000;
+  uint32_t triangles = 256;  // per mesh
+  uint32_t pipelines = 4;
+  uint32_t meshes = 64;
+  uint32_t frames = 300;
+  uint32_t warmupFrames = 30;
+  uint32_t width = 1280;
+  uint32_t height = 720;
+  uint32_t seed = 1;
+  std::string shader = "specialized";
+  std::string firstUse = "none";
+  std::vector<VkSampleCountFlagBits> samples = {VK_SAMPLE_COUNT_1_BIT};
+  std::string csvPath;
+  std::string jsonPath;
+};
+
+struct FrameSample {
+  double recordMs = 0.0;
+  double submitMs = 0.0;
+  double gpuMs = NAN;  // NAN when the device has no usable timestamps
+  double frameMs = 0.0;
+  uint32_t pipelinesReady = 0;  // specialized variants drawn with, the rest used the fallback
+};
+
+struct Object {
+  uint32_t pipeline;
+  uint32_t mesh;
+  float depth;  // only orders draws within the same state
+};
+
+void printUsage() {
+  std::printf(
+      "usage: FrameBench [--objects N] [--triangles N] [--pipelines N] [--meshes N]\n"
+      "                  [--frames N] [--warmup N] [--width N] [--height N] [--seed N]\n"
+      "                  [--shader specialized|uber] [--first-use none|sync|async]\n"
+      "                  [--samples 1|2|4|8[,...]] [--csv per_frame.csv]\n"
+      "                  [--json summary.json]\n");
+}
+
+Config parseArguments(int argc, char **argv) {
+  Config config;
+  for (int i = 1; i < argc; i++) {
+    std::string name = argv[i];
+    if (name == "--help" || name == "-h") {
+      printUsage();
+      std::exit(EXIT_SUCCESS);
+    }
+    if (i + 1 >= argc) throw std::runtime_error("missing value for " + name);
+    std::string value = argv[++i];
+
+    if (name == "--shader") {
+      config.shader = value;
+    } else if (name == "--first-use") {
+      config.firstUse = value;
+    } else if (name == "--samples") {
+      config.samples.clear();
+      size_t start = 0;
+      while (start <= value.size()) {
+        size_t end = std::min(value.find(',', start), value.size());
+        uint32_t count = static_cast<uint32_t>(std::stoul(value.substr(start, end - start)));
+        if (count != 1 && count != 2 && count != 4 && count != 8) {
+          throw std::runtime_error("samples must be 1, 2, 4 or 8");
+        }
+        config.samples.push_back(static_cast<VkSampleCountFlagBits>(count));
+        start = end + 1;
+      }
+    } else if (name == "--csv") {
+      config.csvPath = value;
+    } else if (name == "--json") {
+      config.jsonPath = value;
+    } else {
+      uint32_t number = static_cast<uint32_t>(std::stoul(value));
+      if (name == "--objects") config.objects = number;
+      else if (name == "--triangles") config.triangles = number;
+      else if (name == "--pipelines") config.pipelines = number;
+      else if (name == "--meshes") config.meshes = number;
+      else if (name == "--frames") config.frames = number;
+      else if (name == "--warmup") config.warmupFrames = number;
+      else if (name == "--width") config.width = number;
+      else if (name == "--height") config.height = number;
+      else if (name == "--seed") config.seed = number;
+      else throw std::runtime_error("unknown argument " + name);
+    }
+  }
+
+  if (config.objects == 0 || config.triangles == 0 || config.frames == 0 ||
+      config.width == 0 || config.height == 0) {
+    throw std::runtime_error("objects, triangles, frames, width and height must be positive");
+  }
+  if (config.pipelines == 0 || config.pipelines > LveRenderQueue::MAX_PIPELINES) {
+    throw std::runtime_error("pipelines must be in [1, 4096]");
+  }
+  if (config.meshes == 0 || config.meshes > LveRenderQueue::MAX_MESHES) {
+    throw std::runtime_error("meshes must be in [1, 65536]");
+  }
+  if (config.shader != "specialized" && config.shader != "uber") {
+    throw std::runtime_error("shader must be specialized or uber");
+  }
+  if (config.firstUse != "none" && config.firstUse != "sync" && config.firstUse != "async") {
+    throw std::runtime_error("first-use must be none, sync or async");
+  }
+  if (config.firstUse != "none" && config.shader != "specialized") {
+    throw std::runtime_error("first-use needs the specialized shader");
+  }
+  return config;
+}
+
+// Each mesh is a cluster of small triangles in its own patch of clip space
+std::vector<LveModel::Vertex> makeMeshVertices(uint32_t triangles, std::mt19937 &random) {
+  std::uniform_real_distribution<float> unit{0.f, 1.f};
+  glm::vec2 center{unit(random) * 1.6f - 0.8f, unit(random) * 1.6f - 0.8f};
+  float patch = 0.05f + 0.15f * unit(random);
+
+  std::vector<LveModel::Vertex> vertices;
+  vertices.reserve(triangles * 3);
+  for (uint32_t i = 0; i < triangles; i++) {
+    glm::vec2 offset{unit(random) * 2.f - 1.f, unit(random) * 2.f - 1.f};
+    glm::vec2 corner = center + patch * offset;
+    glm::vec3 color{unit(random), unit(random), unit(random)};
+    float size = 0.02f + 0.03f * unit(random);
+    vertices.push_back({corner, color});
+    vertices.push_back({corner + glm::vec2{size, 0.f}, color});
+    vertices.push_back({corner + glm::vec2{0.f, size}, color});
+  }
+  return vertices;
+}
+
+double milliseconds(Clock::time_point start, Clock::time_point end) {
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+struct Summary {
+  double mean = NAN;
+  double p50 = NAN;
+  double p90 = NAN;
+  double p99 = NAN;
+  double max = NAN;
+};
+
+// Nearest rank percentiles, NAN samples are skipped
+Summary summarize(const std::vector<FrameSample> &samples, double FrameSample::*field) {
+  std::vector<double> values;
+  values.reserve(samples.size());
+  for (const auto &sample : samples) {
+    if (!std::isnan(sample.*field)) values.push_back(sample.*field);
+  }
+  Summary summary;
+  if (values.empty()) return summary;
+
+  std::sort(values.begin(), values.end());
+  auto percentile = [&values](double p) {
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+    return values[std::min(values.size() - 1, rank > 0 ? rank - 1 : 0)];
+  };
+  double total = 0.0;
+  for (double value : values) total += value;
+  summary.mean = total / values.size();
+  summary.p50 = percentile(50.0);
+  summary.p90 = percentile(90.0);
+  summary.p99 = percentile(99.0);
+  summary.max = values.back();
+  return summary;
+}
+
+std::string jsonNumber(double value) {
+  if (std::isnan(value)) return "null";
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.4f", value);
+  return buffer;
+}
+
+std::string jsonString(const std::string &value) {
+  std::string escaped = "\"";
+  for (char c : value) {
+    if (c == '"' || c == '\\') escaped += '\\';
+    escaped += c;
+  }
+  return escaped + "\"";
+}
+
+void writeCsv(const std::string &path, const std::vector<FrameSample> &samples) {
+  FILE *file = std::fopen(path.c_str(), "w");
+  if (!file) throw std::runtime_error("failed to open " + path);
+  std::fprintf(file, "frame,cpu_record_ms,submit_ms,gpu_ms,frame_ms,pipelines_ready\n");
+  for (size_t i = 0; i < samples.size(); i++) {
+    const auto &sample = samples[i];
+    std::fprintf(
+        file,
+        "%zu,%.4f,%.4f,%s,%.4f,%u\n",
+        i,
+        sample.recordMs,
+        sample.submitMs,
+        std::isnan(sample.gpuMs) ? "" : jsonNumber(sample.gpuMs).c_str(),
+        sample.frameMs,
+        sample.pipelinesReady);
+  }
+  std::fclose(file);
+}
+
+void writeJson(
+    const std::string &path,
+    const Config &config,
+    const std::string &deviceName,
+    VkSampleCountFlagBits samples,
+    double setupMs,
+    long long framesUntilReady,
+    const std::vector<std::pair<const char *, Summary>> &metrics) {
+  FILE *file = std::fopen(path.c_str(), "w");
+  if (!file) throw std::runtime_error("failed to open " + path);
+  std::fprintf(file, "{\n  \"device\": %s,\n", jsonString(deviceName).c_str());
+  std::fprintf(
+      file,
+      "  \"config\": {\"objects\": %u, \"triangles\": %u, \"pipelines\": %u, \"meshes\": %u, "
+      "\"frames\": %u, \"warmup\": %u, \"width\": %u, \"height\": %u, \"seed\": %u, "
+      "\"shader\": %s, \"first_use\": %s, \"samples\": %u},\n",
+      config.objects,
+      config.triangles,
+      config.pipelines,
+      config.meshes,
+      config.frames,
+      config.warmupFrames,
+      config.width,
+      config.height,
+      config.seed,
+      jsonString(config.shader).c_str(),
+      jsonString(config.firstUse).c_str(),
+      static_cast<uint32_t>(samples));
+  std::fprintf(file, "  \"setup_ms\": %s", jsonNumber(setupMs).c_str());
+  if (framesUntilReady >= 0) {
+    std::fprintf(file, ",\n  \"frames_until_ready\": %lld", framesUntilReady);
+  }
+  for (const auto &metric : metrics) {
+    const Summary &summary = metric.second;
+    std::fprintf(
+        file,
+        ",\n  \"%s\": {\"mean\": %s, \"p50\": %s, \"p90\": %s, \"p99\": %s, \"max\": %s}",
+        metric.first,
+        jsonNumber(summary.mean).c_str(),
+        jsonNumber(summary.p50).c_str(),
+        jsonNumber(summary.p90).c_str(),
+        jsonNumber(summary.p99).c_str(),
+        jsonNumber(summary.max).c_str());
+  }
+  std::fprintf(file, "\n}\n");
+  std::fclose(file);
+}
+
+// result.json with 4 samples becomes result_4x.json when several counts are run
+std::string outputPath(
+    const std::string &path, const Config &config, VkSampleCountFlagBits samples) {
+  if (config.samples.size() == 1) return path;
+  size_t slash = path.find_last_of("/\\");
+  size_t dot = path.find_last_of('.');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) dot = path.size();
+  return path.substr(0, dot) + "_" + std::to_string(samples) + "x" + path.substr(dot);
+}
+
+// Runs the scene with one sample count and returns the frame time summary
+Summary run(const Config &config, LveDevice &device, VkSampleCountFlagBits sampleCount) {
+  const VkExtent2D extent{config.width, config.height};
+  VkFormat depthFormat = device.findSupportedFormat(
+      {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+  // ---- scene, everything below depends only on the seed and the arguments ----
+  auto setupStart = Clock::now();
+  std::mt19937 random{config.seed};
+
+  std::vector<std::unique_ptr<LveModel>> meshes;
+  for (uint32_t i = 0; i < config.meshes; i++) {
+    meshes.push_back(
+        std::make_unique<LveModel>(device, makeMeshVertices(config.triangles, random)));
+  }
+
+  std::vector<Object> objects(config.objects);
+  std::uniform_real_distribution<float> unit{0.f, 1.f};
+  for (auto &object : objects) {
+    object.pipeline = random() % config.pipelines;
+    object.mesh = random() % config.meshes;
+    object.depth = unit(random);
+  }
+
+  // the effects of simple_shader_uber.frag, unused by the specialized pipelines
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(uint32_t);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  VkPipelineLayout pipelineLayout;
+  if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+
+  // Pipeline i draws with the effects i % EFFECT_COMBINATIONS, bit 0 grayscale, bit 1 contrast
+  // and bit 2 posterize. Specialized, constants 0 to 2 select them and constant 3 is not read
+  // by the shader but makes every index a separate pipeline object, uber has one pipeline.
+  auto configure = [&](PipelineConfigInfo &pipelineConfig) {
+    LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+    pipelineConfig.colorAttachmentFormat = COLOR_FORMAT;
+    pipelineConfig.depthAttachmentFormat = depthFormat;
+    pipelineConfig.multisampleInfo.rasterizationSamples = sampleCount;
+    pipelineConfig.pipelineLayout = pipelineLayout;
+  };
+  auto configureVariant = [&](PipelineConfigInfo &pipelineConfig, uint32_t i) {
+    configure(pipelineConfig);
+    uint32_t effects = i % EFFECT_COMBINATIONS;
+    pipelineConfig.fragSpecialization.set(0, (effects & 1) != 0);
+    pipelineConfig.fragSpecialization.set(1, (effects & 2) != 0);
+    pipelineConfig.fragSpecialization.set(2, (effects & 4) != 0);
+    pipelineConfig.fragSpecialization.set(3, i);
+  };
+
+  LvePipelineRegistry registry{device};
+  bool uber = config.shader == "uber";
+  bool deferred = config.firstUse != "none";
+  // The uber pipeline draws everything with --shader uber and is the fallback for variants
+  // that are not compiled yet with --first-use
+  std::shared_ptr<LvePipeline> uberPipeline;
+  if (uber || deferred) {
+    PipelineConfigInfo pipelineConfig{};
+    configure(pipelineConfig);
+    uberPipeline = registry.getPipeline(
+        "simple_shader.vert.spv", "simple_shader_uber.frag.spv", pipelineConfig);
+  }
+  // variants[i] is null until pipeline i can be drawn with, pipelines keeps them alive
+  std::vector<LvePipeline *> variants(uber ? 0 : config.pipelines, nullptr);
+  std::vector<std::shared_ptr<LvePipeline>> pipelines;
+  uint32_t variantsReady = 0;
+  auto compileVariant = [&](uint32_t i) {
+    PipelineConfigInfo pipelineConfig{};
+    configureVariant(pipelineConfig, i);
+    pipelines.push_back(
+        registry.getPipeline("simple_shader.vert.spv", "simple_shader.frag.spv", pipelineConfig));
+    variants[i] = pipelines.back().get();
+    variantsReady++;
+  };
+  if (!uber && !deferred) {
+    for (uint32_t i = 0; i < config.pipelines; i++) compileVariant(i);
+  }
+
+  std::unique_ptr<LveThreadPool> threadPool;
+  std::unique_ptr<LvePipelineCompiler> compiler;
+  std::vector<LvePipelineRequest> requests;
+  if (config.firstUse == "async") {
+    threadPool = std::make_unique<LveThreadPool>();
+    compiler = std::make_unique<LvePipelineCompiler>(device, *threadPool, &registry);
+  }
+  double setupMs = milliseconds(setupStart, Clock::now());
+
+  // ---- per frame in flight state ----
+  LveRenderQueue renderQueue;
+  renderQueue.reserve(objects.size());
+
+  // With multisampling the samples are resolved into color and never written to memory
+  auto recordScene = [&](VkCommandBuffer commandBuffer, LveRenderGraph &graph,
+                         LveRenderGraph::Resource color, LveRenderGraph::Resource multisampled,
+                         LveRenderGraph::Resource depth) {
+    VkRenderingAttachmentInfoKHR colorAttachment{};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.clearValue.color = {{0.f, 0.f, 0.f, 1.f}};
+    if (multisampled != LveRenderGraph::INVALID_RESOURCE) {
+      colorAttachment.imageView = graph.imageView(multisampled);
+      colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+      colorAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+      colorAttachment.resolveImageView = graph.imageView(color);
+      colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    } else {
+      colorAttachment.imageView = graph.imageView(color);
+      colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    }
+
+    VkRenderingAttachmentInfoKHR depthAttachment{};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    depthAttachment.imageView = graph.imageView(depth);
+    depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.clearValue.depthStencil = {1.f, 0};
+
+    VkRenderingInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.renderArea = {{0, 0}, extent};
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+    renderingInfo.pDepthAttachment = &depthAttachment;
+    device.cmdBeginRendering(commandBuffer, renderingInfo);
+
+    VkViewport viewport{};
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.maxDepth = 1.f;
+    VkRect2D scissor{{0, 0}, extent};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    // sorted every frame like the app does, it is part of the recording cost being measured
+    renderQueue.clear();
+    for (uint32_t i = 0; i < objects.size(); i++) {
+      const auto &object = objects[i];
+      renderQueue.add(
+          LveRenderQueue::makeKey(0, object.pipeline, 0, object.mesh, object.depth), i);
+    }
+    renderQueue.sort();
+    LvePipeline *bound = nullptr;
+    for (const auto &draw : renderQueue.draws()) {
+      const auto &object = objects[draw.index];
+      if (draw.changes & LveRenderQueue::PIPELINE) {
+        LvePipeline *variant = uber ? nullptr : variants[object.pipeline];
+        if (variant) {
+          variant->bind(commandBuffer);
+          bound = variant;
+        } else {
+          if (bound != uberPipeline.get()) {
+            uberPipeline->bind(commandBuffer);
+            bound = uberPipeline.get();
+          }
+          uint32_t effects = object.pipeline % EFFECT_COMBINATIONS;
+          vkCmdPushConstants(
+              commandBuffer,
+              pipelineLayout,
+              VK_SHADER_STAGE_FRAGMENT_BIT,
+              0,
+              sizeof(effects),
+              &effects);
+        }
+      }
+      if (draw.changes & LveRenderQueue::MESH) meshes[object.mesh]->bind(commandBuffer);
+      meshes[object.mesh]->draw(commandBuffer);
+    }
+
+    device.cmdEndRendering(commandBuffer);
+  };
+
+  std::vector<std::unique_ptr<LveRenderGraph>> graphs;
+  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    auto graph = std::make_unique<LveRenderGraph>(device);
+    LveRenderGraph *renderGraph = graph.get();
+    auto color = graph->createImage("color", {COLOR_FORMAT, extent});
+    auto depth = graph->createImage("depth", {depthFormat, extent, sampleCount});
+    auto multisampled = LveRenderGraph::INVALID_RESOURCE;
+    if (sampleCount != VK_SAMPLE_COUNT_1_BIT) {
+      multisampled = graph->createImage("multisampled color", {COLOR_FORMAT, extent, sampleCount});
+    }
+    graph->addPass(
+        "scene",
+        [=](LveRenderGraph::PassBuilder &pass) {
+          pass.write(color, LveResourceUsage::ColorAttachment);
+          pass.write(depth, LveResourceUsage::DepthAttachment);
+          if (multisampled != LveRenderGraph::INVALID_RESOURCE) {
+            pass.write(multisampled, LveResourceUsage::ColorAttachment);
+          }
+          // nothing reads the image, it only exists to be rendered
+          pass.sideEffects();
+        },
+        [&recordScene, renderGraph, color, multisampled, depth](VkCommandBuffer commandBuffer) {
+          recordScene(commandBuffer, *renderGraph, color, multisampled, depth);
+        });
+    graph->compile();
+    graphs.push_back(std::move(graph));
+  }
+
+  std::vector<VkCommandBuffer> commandBuffers(MAX_FRAMES_IN_FLIGHT);
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = device.getCommandPool();
+  allocInfo.commandBufferCount = MAX_FRAMES_IN_FLIGHT;
+  if (vkAllocateCommandBuffers(device.device(), &allocInfo, commandBuffers.data()) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate command buffers");
+  }
+
+  std::vector<VkFence> fences(MAX_FRAMES_IN_FLIGHT);
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+  for (auto &fence : fences) {
+    if (vkCreateFence(device.device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create fence");
+    }
+  }
+
+  // Two timestamps per frame in flight, around everything the frame records
+  bool gpuTiming = device.properties.limits.timestampComputeAndGraphics == VK_TRUE;
+  double timestampPeriodMs = device.properties.limits.timestampPeriod * 1e-6;
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (gpuTiming) {
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = 2 * MAX_FRAMES_IN_FLIGHT;
+    if (vkCreateQueryPool(device.device(), &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create query pool");
+    }
+  }
+
+  // ---- frames ----
+  uint32_t totalFrames = config.warmupFrames + config.frames;
+  std::vector<FrameSample> samples(totalFrames);
+  // frame last submitted from each slot, and its id in the deletion queue
+  std::vector<int64_t> slotFrame(MAX_FRAMES_IN_FLIGHT, -1);
+  std::vector<uint64_t> slotDeletionFrame(MAX_FRAMES_IN_FLIGHT, 0);
+
+  auto readTimestamps = [&](int slot) {
+    if (!gpuTiming || slotFrame[slot] < 0) return;
+    uint64_t timestamps[2];
+    VkResult result = vkGetQueryPoolResults(
+        device.device(),
+        queryPool,
+        2 * slot,
+        2,
+        sizeof(timestamps),
+        timestamps,
+        sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT);
+    if (result == VK_SUCCESS) {
+      samples[slotFrame[slot]].gpuMs = (timestamps[1] - timestamps[0]) * timestampPeriodMs;
+    }
+  };
+
+  std::vector<Clock::time_point> frameStarts(totalFrames + 1);
+  for (uint32_t frame = 0; frame < totalFrames; frame++) {
+    int slot = frame % MAX_FRAMES_IN_FLIGHT;
+    frameStarts[frame] = Clock::now();
+
+    vkWaitForFences(device.device(), 1, &fences[slot], VK_TRUE, UINT64_MAX);
+    readTimestamps(slot);
+    device.deletionQueue().collect(slotDeletionFrame[slot]);
+    vkResetFences(device.device(), 1, &fences[slot]);
+
+    // picks up what finished compiling since the last frame, never waits
+    for (uint32_t i = 0; i < requests.size(); i++) {
+      if (variants[i]) continue;
+      if (requests[i].hasFailed()) {
+        throw std::runtime_error("failed to compile pipeline: " + requests[i].error());
+      }
+      variants[i] = requests[i].get();
+      if (variants[i]) variantsReady++;
+    }
+
+    VkCommandBuffer commandBuffer = commandBuffers[slot];
+    auto recordStart = Clock::now();
+    // first use of the specialized variants, counted as recording like a draw that needs them
+    if (deferred && frame == config.warmupFrames) {
+      for (uint32_t i = 0; i < config.pipelines; i++) {
+        if (config.firstUse == "sync") {
+          compileVariant(i);
+          continue;
+        }
+        PipelineConfigInfo pipelineConfig{};
+        configureVariant(pipelineConfig, i);
+        requests.push_back(
+            compiler->compile("simple_shader.vert.spv", "simple_shader.frag.spv", pipelineConfig));
+      }
+    }
+    vkResetCommandBuffer(commandBuffer, 0);
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+      throw std::runtime_error("failed to begin recording command buffer!");
+    }
+    if (gpuTiming) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 2 * slot, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 2 * slot);
+    }
+    graphs[slot]->execute(commandBuffer);
+    if (gpuTiming) {
+      vkCmdWriteTimestamp(
+          commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 2 * slot + 1);
+    }
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to record command buffer!");
+    }
+    auto recordEnd = Clock::now();
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, fences[slot]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to submit draw command buffer!");
+    }
+    auto submitEnd = Clock::now();
+    slotDeletionFrame[slot] = device.deletionQueue().frameSubmitted();
+    slotFrame[slot] = frame;
+
+    samples[frame].recordMs = milliseconds(recordStart, recordEnd);
+    samples[frame].submitMs = milliseconds(recordEnd, submitEnd);
+    samples[frame].pipelinesReady = variantsReady;
+  }
+
+  // the last frame ends when the GPU is done with everything
+  vkWaitForFences(device.device(), MAX_FRAMES_IN_FLIGHT, fences.data(), VK_TRUE, UINT64_MAX);
+  frameStarts[totalFrames] = Clock::now();
+  for (int slot = 0; slot < MAX_FRAMES_IN_FLIGHT; slot++) readTimestamps(slot);
+  for (uint32_t frame = 0; frame < totalFrames; frame++) {
+    samples[frame].frameMs = milliseconds(frameStarts[frame], frameStarts[frame + 1]);
+  }
+
+  vkDeviceWaitIdle(device.device());
+  if (queryPool != VK_NULL_HANDLE) vkDestroyQueryPool(device.device(), queryPool, nullptr);
+  for (auto fence : fences) vkDestroyFence(device.device(), fence, nullptr);
+  vkFreeCommandBuffers(
+      device.device(), device.getCommandPool(), MAX_FRAMES_IN_FLIGHT, commandBuffers.data());
+  graphs.clear();
+  compiler.reset();
+  requests.clear();
+  variants.clear();
+  pipelines.clear();
+  uberPipeline.reset();
+  registry.releaseUnused();
+  vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+  meshes.clear();
+  // the device is idle, the next sample count starts with nothing left to collect
+  device.deletionQueue().flush();
+
+  // ---- results, warmup frames excluded ----
+  std::vector<FrameSample> measured(samples.begin() + config.warmupFrames, samples.end());
+  Summary frameMs = summarize(measured, &FrameSample::frameMs);
+  std::vector<std::pair<const char *, Summary>> metrics = {
+      {"cpu_record_ms", summarize(measured, &FrameSample::recordMs)},
+      {"submit_ms", summarize(measured, &FrameSample::submitMs)},
+      {"gpu_ms", summarize(measured, &FrameSample::gpuMs)},
+      {"frame_ms", frameMs},
+  };
+
+  // measured frames until every variant was drawn with, -1 without --first-use or if some
+  // never finished
+  long long framesUntilReady = -1;
+  if (deferred) {
+    for (size_t i = 0; i < measured.size(); i++) {
+      if (measured[i].pipelinesReady == config.pipelines) {
+        framesUntilReady = static_cast<long long>(i);
+        break;
+      }
+    }
+  }
+
+  const auto &queueStats = renderQueue.stats();
+  std::printf(
+      "%s: %u objects x %u triangles, %u variants (%s), %u meshes, %ux%u, %ux MSAA, "
+      "seed %u\n",
+      device.properties.deviceName,
+      config.objects,
+      config.triangles,
+      config.pipelines,
+      uber ? "one uber shader pipeline" : "specialized pipelines",
+      config.meshes,
+      config.width,
+      config.height,
+      static_cast<uint32_t>(sampleCount),
+      config.seed);
+  std::printf(
+      "setup %.1f ms, %u %s and %u mesh binds per frame, %u frames after %u warmup\n",
+      setupMs,
+      queueStats.pipelineBinds,
+      uber ? "push constant updates" : "pipeline binds",
+      queueStats.meshBinds,
+      config.frames,
+      config.warmupFrames);
+  if (deferred) {
+    std::printf(
+        "first use (%s): frame %.3f ms, recording %.3f ms, ",
+        config.firstUse.c_str(),
+        measured[0].frameMs,
+        measured[0].recordMs);
+    if (framesUntilReady >= 0) {
+      std::printf("all variants ready after %lld frames\n", framesUntilReady);
+    } else {
+      std::printf("%u of %u variants ready at the end\n", variantsReady, config.pipelines);
+    }
+  }
+  std::printf("%-14s %10s %10s %10s %10s %10s   (ms)\n", "", "mean", "p50", "p90", "p99", "max");
+  for (const auto &metric : metrics) {
+    const Summary &summary = metric.second;
+    std::printf(
+        "%-14s %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+        metric.first,
+        summary.mean,
+        summary.p50,
+        summary.p90,
+        summary.p99,
+        summary.max);
+  }
+
+  if (!config.csvPath.empty()) writeCsv(outputPath(config.csvPath, config, sampleCount), measured);
+  if (!config.jsonPath.empty()) {
+    writeJson(
+        outputPath(config.jsonPath, config, sampleCount),
+        config,
+        device.properties.deviceName,
+        sampleCount,
+        setupMs,
+        framesUntilReady,
+        metrics);
+  }
+  return frameMs;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  try {
+    Config config = parseArguments(argc, argv);
+    LveDevice device;
+    if (!device.dynamicRenderingEnabled() || !device.synchronization2Enabled()) {
+      throw std::runtime_error("FrameBench needs dynamic rendering and synchronization2");
+    }
+    VkSampleCountFlags supported = device.properties.limits.framebufferColorSampleCounts &
+                                   device.properties.limits.framebufferDepthSampleCounts;
+    for (VkSampleCountFlagBits samples : config.samples) {
+      if (!(supported & samples)) {
+        throw std::runtime_error(
+            std::to_string(samples) + " samples are not supported, the device allows up to " +
+            std::to_string(device.getMaxUsableSampleCount()));
+      }
+    }
+
+    std::vector<Summary> frameTimes;
+    for (VkSampleCountFlagBits samples : config.samples) {
+      if (!frameTimes.empty()) std::printf("\n");
+      frameTimes.push_back(run(config, device, samples));
+    }
+    if (config.samples.size() > 1) {
+      std::printf("\n%-14s %10s %10s %10s %10s   (frame ms)\n", "", "mean", "p50", "p99", "max");
+      for (size_t i = 0; i < config.samples.size(); i++) {
+        std::string label = std::to_string(config.samples[i]) + "x MSAA";
+        std::printf(
+            "%-14s %10.3f %10.3f %10.3f %10.3f\n",
+            label.c_str(),
+            frameTimes[i].mean,
+            frameTimes[i].p50,
+            frameTimes[i].p99,
+            frameTimes[i].max);
+      }
+    }
+    return EXIT_SUCCESS;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+}
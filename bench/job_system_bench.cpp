@@ -0,0 +1,190 @@
+// Measures how LveThreadPool scales from one worker to one per hardware thread on three kinds
+// of work, each run as a job so exactly that many threads take part:
+//   parallel for   one parallelFor over many cheap, uneven indices
+//   small jobs     thousands of independent jobs spawned from one job, spread by stealing
+//   fork join      a recursive split where every job waits for its children, with dependent
+//                  continuations summing the halves
+//
+//   JobSystemBench [--max-threads N] [--pin] [--repetitions N]
+//
+// --pin restricts worker i to hardware thread i + 1, see LveThreadPool::pinCurrentThread.
+
+#include "lve_thread_pool.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using lve::LveThreadPool;
+
+struct Config {
+  size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  bool pin = false;
+  int repetitions = 5;
+};
+
+void printUsage() {
+  std::printf("usage: JobSystemBench [--max-threads N] [--pin] [--repetitions N]\n");
+}
+
+Config parseArguments(int argc, char **argv) {
+  Config config;
+  for (int i = 1; i < argc; i++) {
+    std::string name = argv[i];
+    if (name == "--help" || name == "-h") {
+      printUsage();
+      std::exit(EXIT_SUCCESS);
+    }
+    if (name == "--pin") {
+      config.pin = true;
+      continue;
+    }
+    if (i + 1 >= argc) throw std::runtime_error("missing value for " + name);
+    std::string value = argv[++i];
+
+    if (name == "--max-threads") config.maxThreads = std::stoul(value);
+    else if (name == "--repetitions") config.repetitions = std::stoi(value);
+    else throw std::runtime_error("unknown argument " + name);
+  }
+
+  if (config.maxThreads == 0 || config.repetitions <= 0) {
+    throw std::runtime_error("max-threads and repetitions must be positive");
+  }
+  return config;
+}
+
+// A few hundred nanoseconds to a few microseconds of arithmetic, depending on n
+double work(uint32_t n) {
+  double x = n;
+  for (uint32_t i = 0; i < 64 + n % 512; i++) {
+    x = std::sqrt(x + i) * 1.0001;
+  }
+  return x;
+}
+
+// keeps results from being optimized away
+std::atomic<double> sink{0.0};
+
+void parallelForWorkload(LveThreadPool &pool) {
+  constexpr size_t COUNT = 200000;
+  std::vector<double> results(COUNT);
+  pool.parallelFor(COUNT, [&](size_t i) { results[i] = work(static_cast<uint32_t>(i)); });
+  sink = sink + results[COUNT / 2];
+}
+
+void smallJobsWorkload(LveThreadPool &pool) {
+  constexpr size_t COUNT = 20000;
+  std::vector<double> results(COUNT);
+  std::vector<LveThreadPool::JobHandle> jobs;
+  jobs.reserve(COUNT);
+  for (size_t i = 0; i < COUNT; i++) {
+    jobs.push_back(pool.submit([&results, i] { results[i] = work(static_cast<uint32_t>(i)); }));
+  }
+  for (const auto &job : jobs) {
+    pool.wait(job);
+  }
+  sink = sink + results[COUNT / 2];
+}
+
+// Splits [begin, end) until ranges are small, the sum of each split is a continuation of its
+// two halves
+double forkJoin(LveThreadPool &pool, uint32_t begin, uint32_t end) {
+  if (end - begin <= 64) {
+    double sum = 0.0;
+    for (uint32_t i = begin; i < end; i++) sum += work(i);
+    return sum;
+  }
+
+  uint32_t middle = begin + (end - begin) / 2;
+  auto halves = std::make_shared<std::array<double, 3>>();
+  auto left = pool.submit([&pool, halves, begin, middle] {
+    (*halves)[0] = forkJoin(pool, begin, middle);
+  });
+  auto right = pool.submit([&pool, halves, middle, end] {
+    (*halves)[1] = forkJoin(pool, middle, end);
+  });
+  auto sum = pool.submit([halves] { (*halves)[2] = (*halves)[0] + (*halves)[1]; }, {left, right});
+  pool.wait(sum);
+  return (*halves)[2];
+}
+
+void forkJoinWorkload(LveThreadPool &pool) { sink = sink + forkJoin(pool, 0, 200000); }
+
+// Best of repetitions, in milliseconds. Runs as a job, so the pool's workers are the only
+// threads working.
+double bestTime(
+    LveThreadPool &pool, int repetitions, const std::function<void(LveThreadPool &)> &workload) {
+  double best = 1e30;
+  for (int i = 0; i < repetitions; i++) {
+    auto start = std::chrono::steady_clock::now();
+    pool.wait(pool.submit([&] { workload(pool); }));
+    auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  return best;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  try {
+    Config config = parseArguments(argc, argv);
+
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < config.maxThreads; threads *= 2) {
+      threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(config.maxThreads);
+
+    struct Workload {
+      const char *name;
+      void (*run)(LveThreadPool &);
+    };
+    const Workload workloads[] = {
+        {"parallel for", parallelForWorkload},
+        {"small jobs", smallJobsWorkload},
+        {"fork join", forkJoinWorkload},
+    };
+
+    std::printf("%-14s", "workers");
+    for (size_t threads : threadCounts) std::printf(" %16zu", threads);
+    std::printf(
+        "   (ms and speedup over 1 worker, best of %d%s)\n",
+        config.repetitions,
+        config.pin ? ", pinned" : "");
+
+    // one pool per thread count, thread start up is not what is being measured
+    std::vector<std::unique_ptr<LveThreadPool>> pools;
+    for (size_t threads : threadCounts) {
+      pools.push_back(std::make_unique<LveThreadPool>(threads, config.pin));
+    }
+
+    for (const auto &workload : workloads) {
+      std::printf("%-14s", workload.name);
+      double single = 0.0;
+      for (auto &pool : pools) {
+        double time = bestTime(*pool, config.repetitions, workload.run);
+        if (single == 0.0) single = time;
+        std::printf(" %9.2f %5.2fx", time, single / time);
+      }
+      std::printf("\n");
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
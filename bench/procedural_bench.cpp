@@ -0,0 +1,90 @@
+// Times LveSierpinski::generate across depths and thread counts against the old push_back
+// recursion it replaced. Output goes into a preallocated vector, the same access pattern as
+// the mapped vertex buffer LveModel hands to the generator.
+
+#include "lve_procedural.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using lve::LveModel;
+
+constexpr int REPETITIONS = 5;
+
+void sierpinskiPushBack(
+    std::vector<LveModel::Vertex> &vertices,
+    int depth,
+    glm::vec2 left,
+    glm::vec2 right,
+    glm::vec2 top) {
+  if (depth == 0) {
+    vertices.push_back({{top}, {1.f, 0.f, 0.f}});
+    vertices.push_back({{right}, {0.f, 1.f, 0.f}});
+    vertices.push_back({{left}, {0.f, 0.f, 1.f}});
+  } else {
+    auto leftTop = 0.5f * (left + top);
+    auto rightTop = 0.5f * (right + top);
+    auto leftRight = 0.5f * (left + right);
+    sierpinskiPushBack(vertices, depth - 1, left, leftRight, leftTop);
+    sierpinskiPushBack(vertices, depth - 1, leftRight, right, rightTop);
+    sierpinskiPushBack(vertices, depth - 1, leftTop, rightTop, top);
+  }
+}
+
+// Best of REPETITIONS, in milliseconds
+template <typename F>
+double bestTime(F &&function) {
+  double best = 1e30;
+  for (int i = 0; i < REPETITIONS; i++) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  return best;
+}
+
+}  // namespace
+
+int main() {
+  std::vector<size_t> threadCounts{1, 2, 4, 8};
+  size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+  if (std::find(threadCounts.begin(), threadCounts.end(), hardwareThreads) == threadCounts.end())
+    threadCounts.push_back(hardwareThreads);
+
+  // pools are created once, thread start up is not what is being measured
+  std::vector<std::unique_ptr<lve::LveThreadPool>> pools;
+  for (size_t threads : threadCounts) {
+    pools.push_back(threads > 1 ? std::make_unique<lve::LveThreadPool>(threads - 1) : nullptr);
+  }
+
+  std::printf("%5s %12s %12s", "depth", "vertices", "push_back");
+  for (size_t threads : threadCounts) std::printf(" %9zut", threads);
+  std::printf("   (ms, best of %d)\n", REPETITIONS);
+
+  for (uint32_t depth = 6; depth <= 14; depth += 2) {
+    lve::LveSierpinski sierpinski{depth, {-0.5f, 0.5f}, {0.5f, 0.5f}, {0.f, -0.5f}};
+    std::printf("%5u %12u", depth, sierpinski.vertexCount());
+
+    double pushBack = bestTime([&] {
+      std::vector<LveModel::Vertex> vertices;
+      sierpinskiPushBack(vertices, depth, sierpinski.left, sierpinski.right, sierpinski.top);
+    });
+    std::printf(" %12.3f", pushBack);
+
+    std::vector<LveModel::Vertex> vertices(sierpinski.vertexCount());
+    for (auto &pool : pools) {
+      double generate = bestTime([&] { sierpinski.generate(vertices.data(), pool.get()); });
+      std::printf(" %10.3f", generate);
+    }
+    std::printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,255 @@
+// Runs a synthetic frame loop of simulation followed by rendering, once serially on one thread
+// and once with rendering on its own thread fed through LveSnapshotQueue, and reports the frame
+// rate of each. Simulation integrates particles into the frame's snapshot and then does about
+// --simulate-ms of arithmetic, rendering reads the snapshot back and does about --render-ms.
+// The arithmetic is a fixed iteration count calibrated once at startup, not a deadline, so each
+// side costs the same CPU time however the threads are scheduled. With a core per thread the
+// split should approach max(simulate, render) per frame instead of their sum, on a single core
+// it can't beat the serial loop.
+//
+//   RenderThreadBench --simulate-ms 4 --render-ms 6 --frames 300 --particles 10000
+//
+// Every snapshot is checked on the render side to hold the frame it was published as, whole.
+
+#include "lve_snapshot_queue.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using lve::LveSnapshotQueue;
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t MAX_SNAPSHOTS = 3;
+
+struct Config {
+  uint32_t frames = 300;
+  uint32_t particles = 10000;
+  double simulateMs = 4.0;
+  double renderMs = 6.0;
+};
+
+struct Particle {
+  float position[3];
+  float velocity[3];
+};
+
+// What the render side may read, written whole by the simulation of one frame
+struct Snapshot {
+  uint64_t frame = 0;
+  std::vector<Particle> particles;
+};
+
+void printUsage() {
+  std::printf(
+      "usage: RenderThreadBench [--frames N] [--particles N] [--simulate-ms MS] "
+      "[--render-ms MS]\n");
+}
+
+Config parseArguments(int argc, char **argv) {
+  Config config;
+  for (int i = 1; i < argc; i++) {
+    std::string name = argv[i];
+    if (name == "--help" || name == "-h") {
+      printUsage();
+      std::exit(EXIT_SUCCESS);
+    }
+    if (i + 1 >= argc) throw std::runtime_error("missing value for " + name);
+    std::string value = argv[++i];
+
+    if (name == "--frames") config.frames = static_cast<uint32_t>(std::stoul(value));
+    else if (name == "--particles") config.particles = static_cast<uint32_t>(std::stoul(value));
+    else if (name == "--simulate-ms") config.simulateMs = std::stod(value);
+    else if (name == "--render-ms") config.renderMs = std::stod(value);
+    else throw std::runtime_error("unknown argument " + name);
+  }
+
+  if (config.frames == 0 || config.particles == 0) {
+    throw std::runtime_error("frames and particles must be positive");
+  }
+  if (config.simulateMs < 0.0 || config.renderMs < 0.0) {
+    throw std::runtime_error("simulate-ms and render-ms can't be negative");
+  }
+  return config;
+}
+
+// A dependent chain of multiply-adds, the compiler can neither skip nor vectorize it
+double spin(uint64_t iterations) {
+  volatile double seed = 1.0;
+  double x = seed;
+  for (uint64_t i = 0; i < iterations; i++) {
+    x = x * 0.999999 + 0.000001;
+  }
+  return x;
+}
+
+// Iterations of spin() per millisecond, the fastest of a few runs so a preempted one doesn't
+// count
+double calibrateSpin() {
+  constexpr uint64_t ITERATIONS = 2000000;
+  double bestMs = 1e30;
+  volatile double sink = 0.0;
+  for (int i = 0; i < 5; i++) {
+    auto start = Clock::now();
+    sink = sink + spin(ITERATIONS);
+    bestMs = std::min(
+        bestMs, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+  }
+  return ITERATIONS / std::max(bestMs, 1e-3);
+}
+
+class Workload {
+ public:
+  Workload(const Config &config, double iterationsPerMs)
+      : simulateIterations{static_cast<uint64_t>(config.simulateMs * iterationsPerMs)},
+        renderIterations{static_cast<uint64_t>(config.renderMs * iterationsPerMs)},
+        particles(config.particles) {
+    for (uint32_t i = 0; i < particles.size(); i++) {
+      particles[i] = {{0.f, 0.f, 0.f}, {1.f, 0.5f * (i % 7), 0.25f * (i % 3)}};
+    }
+  }
+
+  void simulate(uint64_t frame, Snapshot &snapshot) {
+    constexpr float dt = 1.f / 60.f;
+    for (auto &particle : particles) {
+      for (int axis = 0; axis < 3; axis++) {
+        particle.position[axis] += particle.velocity[axis] * dt;
+      }
+    }
+    snapshot.frame = frame;
+    snapshot.particles = particles;
+    // the frame number in every particle, so a torn snapshot doesn't go unnoticed
+    for (auto &particle : snapshot.particles) {
+      particle.velocity[0] = static_cast<float>(frame);
+    }
+    simulateSink += spin(simulateIterations);
+  }
+
+  // Returns false if the snapshot isn't the frame expected next or was modified while read
+  bool render(uint64_t expectedFrame, const Snapshot &snapshot) {
+    bool whole = snapshot.frame == expectedFrame;
+    for (const auto &particle : snapshot.particles) {
+      whole = whole && particle.velocity[0] == static_cast<float>(expectedFrame);
+      checksum += particle.position[0] + particle.position[1] + particle.position[2];
+    }
+    checksum += spin(renderIterations);
+    return whole;
+  }
+
+  // keep the render side's reads and both sides' arithmetic from being optimized away, one per
+  // side so the threads don't write the same variable
+  double checksum = 0.0;
+  double simulateSink = 0.0;
+
+ private:
+  uint64_t simulateIterations;
+  uint64_t renderIterations;
+  std::vector<Particle> particles;
+};
+
+double runSerial(const Config &config, double iterationsPerMs) {
+  Workload workload{config, iterationsPerMs};
+  Snapshot snapshot;
+  auto start = Clock::now();
+  for (uint64_t frame = 0; frame < config.frames; frame++) {
+    workload.simulate(frame, snapshot);
+    if (!workload.render(frame, snapshot)) throw std::runtime_error("serial snapshot mismatch");
+  }
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+double runThreaded(const Config &config, double iterationsPerMs, uint32_t slotCount) {
+  Workload workload{config, iterationsPerMs};
+  std::array<Snapshot, MAX_SNAPSHOTS> snapshots;
+  LveSnapshotQueue queue{slotCount};
+
+  std::exception_ptr renderError;
+  auto start = Clock::now();
+  std::thread renderThread{[&] {
+    try {
+      uint32_t slot;
+      for (uint64_t frame = 0; frame < config.frames; frame++) {
+        if (!queue.acquire(slot)) break;
+        if (!workload.render(frame, snapshots[slot])) {
+          throw std::runtime_error(
+              "snapshot torn or out of order at frame " + std::to_string(frame));
+        }
+      }
+    } catch (...) {
+      renderError = std::current_exception();
+    }
+    queue.close();
+  }};
+
+  // the last publish returns false once the render thread is done and closed the queue
+  for (uint64_t frame = 0; frame < config.frames; frame++) {
+    workload.simulate(frame, snapshots[queue.writeSlot()]);
+    if (!queue.publish()) break;
+  }
+  renderThread.join();
+  if (renderError) std::rethrow_exception(renderError);
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void printRow(const char *name, const Config &config, double totalMs, double serialMs) {
+  std::printf(
+      "%-24s %10.2f %10.1f %9.2fx\n",
+      name,
+      totalMs / config.frames,
+      1000.0 * config.frames / totalMs,
+      serialMs / totalMs);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  try {
+    Config config = parseArguments(argc, argv);
+    double iterationsPerMs = calibrateSpin();
+    std::printf(
+        "%u frames, %u particles, simulate %.1f ms, render %.1f ms of work per frame "
+        "(%.0f iterations per ms)\n",
+        config.frames,
+        config.particles,
+        config.simulateMs,
+        config.renderMs,
+        iterationsPerMs);
+    unsigned int hardwareThreads = std::thread::hardware_concurrency();
+    if (hardwareThreads < 2) {
+      std::printf(
+          "expected: serial %.2f ms per frame, the split no faster: only one hardware thread, "
+          "the render thread can't run alongside simulation\n\n",
+          config.simulateMs + config.renderMs);
+    } else {
+      std::printf(
+          "expected: serial %.2f ms, split %.2f ms per frame\n\n",
+          config.simulateMs + config.renderMs,
+          std::max(config.simulateMs, config.renderMs));
+    }
+
+    std::printf("%-24s %10s %10s %10s\n", "", "ms/frame", "fps", "speedup");
+    double serialMs = runSerial(config, iterationsPerMs);
+    printRow("serial", config, serialMs, serialMs);
+    printRow(
+        "render thread, 2 slots", config, runThreaded(config, iterationsPerMs, 2), serialMs);
+    printRow(
+        "render thread, 3 slots",
+        config,
+        runThreaded(config, iterationsPerMs, MAX_SNAPSHOTS),
+        serialMs);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,95 @@
+// Times LveTransformHierarchy::update on trees of 100k and 1M nodes with 1% and 100% of
+// the local transforms changed per update, on the calling thread and on a thread pool.
+
+#include "lve_transform_hierarchy.hpp"
+
+// libs
+#include <glm/gtc/matrix_transform.hpp>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+using lve::LveTransformHierarchy;
+
+constexpr int REPETITIONS = 10;
+
+// 16 roots with 8 children per node, 7 levels at 1M nodes. Which nodes are changed is random,
+// so most of them are leaves, as with objects moving under a mostly static scene structure.
+void buildTree(LveTransformHierarchy &hierarchy, uint32_t nodeCount) {
+  constexpr uint32_t ROOTS = 16;
+  constexpr uint32_t CHILDREN = 8;
+  hierarchy.reserve(nodeCount);
+  for (uint32_t i = 0; i < nodeCount; i++) {
+    if (i < ROOTS) {
+      hierarchy.createNode();
+      continue;
+    }
+    glm::mat4 local = glm::translate(glm::mat4{1.f}, glm::vec3{0.01f * (i % 7), 0.f, 0.f});
+    hierarchy.createNode((i - ROOTS) / CHILDREN, local);
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 random{42};
+  lve::LveThreadPool threadPool;
+
+  std::printf(
+      "%9s %7s %7s %12s %12s %12s   (ms, best of %d, %zu workers)\n",
+      "nodes",
+      "dirty",
+      "levels",
+      "updated",
+      "serial",
+      "pool",
+      REPETITIONS,
+      threadPool.workerCount());
+
+  for (uint32_t nodeCount : {100000u, 1000000u}) {
+    LveTransformHierarchy hierarchy;
+    buildTree(hierarchy, nodeCount);
+    hierarchy.update();
+
+    for (float dirtyRatio : {0.01f, 1.f}) {
+      std::vector<LveTransformHierarchy::Node> dirtyNodes(nodeCount);
+      for (uint32_t i = 0; i < nodeCount; i++) dirtyNodes[i] = i;
+      std::shuffle(dirtyNodes.begin(), dirtyNodes.end(), random);
+      dirtyNodes.resize(static_cast<size_t>(nodeCount * dirtyRatio));
+
+      float angle = 0.f;
+      auto time = [&](lve::LveThreadPool *pool) {
+        double best = 1e30;
+        for (int i = 0; i < REPETITIONS; i++) {
+          angle += 0.01f;
+          glm::mat4 local = glm::rotate(glm::mat4{1.f}, angle, glm::vec3{0.f, 0.f, 1.f});
+          for (auto node : dirtyNodes) hierarchy.setLocalTransform(node, local);
+
+          auto start = std::chrono::steady_clock::now();
+          hierarchy.update(pool);
+          auto end = std::chrono::steady_clock::now();
+          best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        return best;
+      };
+
+      double serial = time(nullptr);
+      double pool = time(&threadPool);
+      std::printf(
+          "%9u %6.0f%% %7u %12u %12.3f %12.3f\n",
+          nodeCount,
+          dirtyRatio * 100.f,
+          hierarchy.stats().levels,
+          hierarchy.stats().updatedNodes,
+          serial,
+          pool);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,65 @@
+# Writes compiled SPIR-V into a C++ source as uint32_t arrays plus a lookup table by file name,
+# see src/lve_embedded_shaders.hpp
+#
+# cmake -DOUTPUT=<file.cpp> -DSHADERS=<a.spv|b.spv|...> -P embed_shaders.cmake
+# SHADERS is '|' separated so the list survives being passed through a custom command
+
+if (NOT OUTPUT)
+  message(FATAL_ERROR "embed_shaders: OUTPUT not set")
+endif()
+
+string(REPLACE "|" ";" SHADER_LIST "${SHADERS}")
+
+set(ARRAYS "")
+set(ENTRIES "")
+foreach(SPIRV ${SHADER_LIST})
+  get_filename_component(FILE_NAME ${SPIRV} NAME)
+  string(MAKE_C_IDENTIFIER "${FILE_NAME}" SYMBOL)
+
+  file(READ ${SPIRV} HEX_CONTENT HEX)
+  string(LENGTH "${HEX_CONTENT}" HEX_LENGTH)
+  math(EXPR REMAINDER "${HEX_LENGTH} % 8")
+  if (HEX_LENGTH EQUAL 0 OR NOT REMAINDER EQUAL 0)
+    message(FATAL_ERROR "embed_shaders: ${SPIRV} is not a whole number of SPIR-V words")
+  endif()
+  math(EXPR WORD_COUNT "${HEX_LENGTH} / 8")
+
+  # SPIR-V is a little endian word stream, swap every 4 bytes into a uint32_t literal
+  string(REGEX REPLACE
+    "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])"
+    "0x\\4\\3\\2\\1u," WORDS "${HEX_CONTENT}")
+  # eight words per line, cmake regexes have no {n} repetition
+  set(LINE_PATTERN "")
+  foreach(I RANGE 1 8)
+    string(APPEND LINE_PATTERN "[^,]+,")
+  endforeach()
+  string(REGEX REPLACE "(${LINE_PATTERN})" "\\1\n    " WORDS "${WORDS}")
+  string(REGEX REPLACE "\n    $" "" WORDS "${WORDS}")
+
+  string(APPEND ARRAYS
+    "\n  alignas(4) const uint32_t ${SYMBOL}[${WORD_COUNT}] = {\n    ${WORDS}\n  };\n")
+  string(APPEND ENTRIES
+    "    {\"${FILE_NAME}\", ${SYMBOL}, sizeof(${SYMBOL})},\n")
+endforeach()
+
+set(CONTENT "// Generated by cmake/embed_shaders.cmake, do not edit\n\
+#include \"lve_embedded_shaders.hpp\"\n\
+\n\
+namespace lve {\n\
+namespace {\n\
+${ARRAYS}}\n\
+\n\
+  // terminated by an entry with a null name\n\
+  const LveEmbeddedShader embeddedShaders[] = {\n\
+${ENTRIES}    {nullptr, nullptr, 0},\n\
+  };\n\
+}\n")
+
+# only touch the file when it changes so unchanged shaders don't relink, the build tracks this
+# step through the stamp file CMakeLists.txt touches after it
+if (EXISTS ${OUTPUT})
+  file(READ ${OUTPUT} PREVIOUS)
+endif()
+if (NOT PREVIOUS STREQUAL CONTENT)
+  file(WRITE ${OUTPUT} "${CONTENT}")
+endif()
@@ -1,120 +1,425 @@
 #include "first_app.hpp"
 
+#include "lve_trace.hpp"
+
 // std
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <cstdint>
+#include <exception>
+#include <iostream>
 #include <memory>
 #include <stdexcept>
+#include <thread>
 
 namespace lve {
 
-  // https://pastebin.com/0bu2a2ZP
-  void sierpinski(
-    std::vector<LveModel::Vertex>& vertices,
-    signed depth,
-    glm::vec2 left,
-    glm::vec2 right,
-    glm::vec2 top
-  ) {
-    if (depth == 0) {
-      vertices.push_back({{top}  , {1.f, 0.f, 0.f}});
-      vertices.push_back({{right}, {0.f, 1.f, 0.f}});
-      vertices.push_back({{left} , {0.f, 0.f, 1.f}});
-    } else {
-      auto leftTop = 0.5f * (left + top);
-      auto rightTop = 0.5f * (right + top);
-      auto leftRight = 0.5f * (left + right);
-      sierpinski(vertices, depth - 1, left, leftRight, leftTop);
-      sierpinski(vertices, depth - 1, leftRight, right, rightTop);
-      sierpinski(vertices, depth - 1, leftTop, rightTop, top);
-    }
-  }
-
   FirstApp::FirstApp() {
+    LveTrace::setThreadName("main");
+    if (TRACE_PATH[0] != '\0')
+      LveTrace::start(TRACE_PATH);
+    // nothing is streamed yet that could be evicted, so running low is only reported
+    lveDevice.memoryBudget().addThresholdCallback(
+      MEMORY_WARNING_RATIO,
+      [](uint32_t heapIndex, const LveMemoryBudget::Heap &heap, bool over) {
+        std::cout << "Memory heap " << heapIndex << (over ? " above " : " back below ")
+                  << MEMORY_WARNING_RATIO * 100.f << "% of its budget ("
+                  << heap.usage / (1024 * 1024) << " of " << heap.budget / (1024 * 1024)
+                  << " MiB)" << std::endl;
+      });
+    if (PIPELINE_STATISTICS && lveDevice.pipelineStatisticsQueryEnabled()) {
+      pipelineStatistics = std::make_unique<LvePipelineStatistics>(
+        lveDevice, LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+    }
     loadModels();
     createPipelineLayout();
-    recreateSwapChain();
+    recreateSwapChain(waitWhileMinimized());
     createCommandBuffers();
   }
 
   FirstApp::~FirstApp() {
+    // a compile still running on a worker, e.g. when the window closed during the first
+    // frames, creates its pipeline with this layout
+    pipelineCompiler.waitIdle();
     vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
   }
 
   void FirstApp::run() {
-    while (!lveWindow.shouldClose()) {
-      glfwPollEvents();
-      drawFrame();
+    std::thread renderThread;
+    std::exception_ptr renderError;
+    if (RENDER_THREAD) {
+      renderThread = std::thread{[this, &renderError] {
+        try {
+          renderLoop();
+        } catch (...) {
+          renderError = std::current_exception();
+        }
+        // wakes the main thread if it waits to publish
+        snapshotQueue.close();
+      }};
     }
 
+    try {
+      while (!lveWindow.shouldClose()) {
+        if (LOW_LATENCY_MODE && !RENDER_THREAD)
+          waitForFrame();
+
+        glfwPollEvents();
+        waitWhileMinimized();
+        if (lveWindow.shouldClose())
+          break;
+
+        RenderSnapshot &snapshot = renderSnapshots[snapshotQueue.writeSlot()];
+        simulate(snapshot);
+        if (!RENDER_THREAD) {
+          drawFrame(snapshot);
+        } else if (!snapshotQueue.publish()) {
+          break;  // the render thread stopped
+        }
+      }
+    } catch (...) {
+      snapshotQueue.close();
+      if (renderThread.joinable())
+        renderThread.join();
+      // the destructors free memory and swap chain images submitted frames may still use
+      vkDeviceWaitIdle(lveDevice.device());
+      throw;
+    }
+
+    snapshotQueue.close();
+    if (renderThread.joinable())
+      renderThread.join();
     vkDeviceWaitIdle(lveDevice.device());
+    if (renderError)
+      std::rethrow_exception(renderError);
+
+    LveTrace::stop();
+    pipelineRegistry.printStats();
+    std::cout << "Pipeline compile: " << fallbackFrames << " frames drawn with the fallback, "
+              << skippedSceneFrames << " without the scene, longest frame "
+              << longestCompilingFrameMs << " ms while compiling and " << longestFrameMs
+              << " ms after" << std::endl;
+    if (!renderGraphs.empty())
+      renderGraphs[0]->printStats();
+    if (meshletFrames > 0) {
+      std::cout << "Meshlets: " << meshletCuller->meshletCount() << " clusters, "
+                << static_cast<double>(culledMeshlets) / meshletFrames << " culled per frame ("
+                << static_cast<double>(occludedMeshlets) / meshletFrames << " occluded)"
+                << std::endl;
+    }
+    if (renderedFrames > 0) {
+      std::cout << "LOD: " << submittedTriangles / renderedFrames << " triangles per frame, "
+                << fullDetailTriangles / renderedFrames << " without LOD" << std::endl;
+    }
+    lveDevice.frameStats().printStats();
+    if (pipelineStatistics)
+      pipelineStatistics->printStats();
   }
 
   void FirstApp::loadModels() {
-    /* std::vector<LveModel::Vertex> vertices; */
-    /* sierpinski(vertices, 5, {0.f, -0.5f}, {0.5f, 0.5f}, {-0.5f, 0.5f}); */
+    LveSierpinski sierpinski{SIERPINSKI_DEPTH, {-0.5f, 0.5f}, {0.5f, 0.5f}, {0.f, -0.5f}};
+    if (MODEL_LOD_LEVELS <= 1 && !MESHLET_CULLING) {
+      lveModel = std::make_unique<LveModel>(
+        lveDevice,
+        sierpinski.vertexCount(),
+        [&](LveModel::Vertex* vertices) { sierpinski.generate(vertices, &threadPool); });
+      return;
+    }
 
-    std::vector<LveModel::Vertex> vertices {
-      {{0.f, -0.5f} , {1.f, 0.f, 0.f}},
-      {{0.5f, 0.5f} , {0.f, 1.f, 0.f}},
-      {{-0.5f, 0.5f}, {0.f, 0.f, 1.f}},
-    };
-    lveModel = std::make_unique<LveModel>(lveDevice, vertices);
+    // simplification and meshlets need the vertices on the CPU
+    std::vector<LveModel::Vertex> vertices(sierpinski.vertexCount());
+    sierpinski.generate(vertices.data(), &threadPool);
+    std::vector<LveModel::Vertex> uniqueVertices;
+    std::vector<uint32_t> indices;
+    LveModel::weld(vertices, uniqueVertices, indices);
+
+    LveModel::LodSettings lodSettings{};
+    lodSettings.maxLevels = MODEL_LOD_LEVELS;
+    lveModel = std::make_unique<LveModel>(lveDevice, uniqueVertices, indices, lodSettings);
+
+    if (MESHLET_CULLING) {
+      LveMeshlets meshlets = LveMeshlets::build(LveModel::getPositions(uniqueVertices), indices);
+      meshletCuller = std::make_unique<LveMeshletCuller>(lveDevice, meshlets);
+      meshletsCulled.assign(LveSwapChain::MAX_FRAMES_IN_FLIGHT, false);
+    }
   }
 
   void FirstApp::createPipelineLayout() {
+    // the effects of the fallback pipeline, see simple_shader_uber.frag
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(uint32_t);
+
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = 0;
     pipelineLayoutInfo.pSetLayouts = nullptr;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    pipelineLayoutInfo.pPushConstantRanges = nullptr;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
     if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
       throw std::runtime_error("failed to create pipeline layout");
   }
 
-  void FirstApp::recreateSwapChain() {
+  // Nothing can be presented while minimized, blocks until the window has a size again or is
+  // closed. Main thread only, like every GLFW call.
+  VkExtent2D FirstApp::waitWhileMinimized() {
     auto extent = lveWindow.getExtent();
-    while (extent.width == 0 || extent.height == 0) {
-      extent = lveWindow.getExtent();
+    while ((extent.width == 0 || extent.height == 0) && !lveWindow.shouldClose()) {
       glfwWaitEvents();
+      extent = lveWindow.getExtent();
     }
+    return extent;
+  }
 
-    vkDeviceWaitIdle(lveDevice.device());
+  void FirstApp::recreateSwapChain(VkExtent2D extent) {
+    // No device wait: the old swap chain hands its frame fences over to the new one and its
+    // images, framebuffers and render pass are retired once in flight frames have finished
+    bool pipelineCompatible = false;
+    if (lveSwapChain == nullptr) {
+      lveSwapChain =
+        std::make_unique<LveSwapChain>(lveDevice, extent, MSAA_SAMPLES, DYNAMIC_RENDERING);
+    } else {
+      std::shared_ptr<LveSwapChain> oldSwapChain = std::move(lveSwapChain);
+      lveSwapChain = std::make_unique<LveSwapChain>(
+        lveDevice, extent, oldSwapChain, MSAA_SAMPLES, DYNAMIC_RENDERING);
+
+      // pipelines stay valid with any compatible render pass
+      pipelineCompatible =
+        pipelineRequest.valid() && oldSwapChain->compareSwapFormats(*lveSwapChain);
+      // compiles still running were configured with the old render pass
+      if (!pipelineCompatible)
+        pipelineCompiler.waitIdle();
+    }
+
+    if (!pipelineCompatible)
+      createPipeline();
+    createRenderGraphs();
+  }
+
+  void FirstApp::createRenderGraphs() {
+    // the old graphs' attachments are retired through the deletion queue
+    renderGraphs.clear();
+    depthPyramids.clear();
+    occlusionCulling = false;
+    if (!lveSwapChain->usesDynamicRendering())
+      return;
+
+    VkExtent2D extent = lveSwapChain->getSwapChainExtent();
+    VkSampleCountFlagBits samples = lveSwapChain->getSampleCount();
+    VkFormat depthFormat = lveSwapChain->getSwapChainDepthFormat();
+    occlusionCulling = OCCLUSION_CULLING && meshletCuller &&
+                       LveDepthPyramid::isSupported(lveDevice, depthFormat, samples);
+
+    for (int i = 0; i < LveSwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+      auto graph = std::make_unique<LveRenderGraph>(lveDevice);
+      LveRenderGraph *renderGraph = graph.get();
+
+      // the acquired image is handed to the graph every frame in recordCommandBuffer
+      swapChainImage = graph->importImage(
+        "swap chain image",
+        VK_NULL_HANDLE,
+        VK_NULL_HANDLE,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+      );
+      auto depth = graph->createImage("depth", {depthFormat, extent, samples});
+      auto color = LveRenderGraph::INVALID_RESOURCE;
+      if (samples != VK_SAMPLE_COUNT_1_BIT) {
+        color = graph->createImage(
+          "multisampled color", {lveSwapChain->getSwapChainImageFormat(), extent, samples});
+      }
+      auto swapImage = swapChainImage;
+
+      if (!occlusionCulling) {
+        graph->addPass(
+          "scene",
+          [=](LveRenderGraph::PassBuilder &pass) {
+            pass.write(swapImage, LveResourceUsage::ColorAttachment);
+            pass.write(depth, LveResourceUsage::DepthAttachment);
+            if (color != LveRenderGraph::INVALID_RESOURCE)
+              pass.write(color, LveResourceUsage::ColorAttachment);
+          },
+          [this, renderGraph, swapImage, depth, color](VkCommandBuffer commandBuffer) {
+            renderScenePass(
+              commandBuffer, *renderGraph, swapImage, depth, color, LveMeshletCuller::Phase::All);
+          }
+        );
+
+        graph->compile();
+        renderGraphs.push_back(std::move(graph));
+        continue;
+      }
+
+      // Two phase occlusion culling: what was visible last frame is drawn first, its depth is
+      // reduced into a pyramid, the remaining meshlets are tested against it and drawn after
+      graph->addPass(
+        "scene",
+        [=](LveRenderGraph::PassBuilder &pass) {
+          if (color != LveRenderGraph::INVALID_RESOURCE)
+            pass.write(color, LveResourceUsage::ColorAttachment);
+          else
+            pass.write(swapImage, LveResourceUsage::ColorAttachment);
+          pass.write(depth, LveResourceUsage::DepthAttachment);
+        },
+        [this, renderGraph, swapImage, depth, color](VkCommandBuffer commandBuffer) {
+          renderScenePass(
+            commandBuffer, *renderGraph, swapImage, depth, color, LveMeshletCuller::Phase::Early);
+        }
+      );
+      graph->addPass(
+        "depth pyramid",
+        [=](LveRenderGraph::PassBuilder &pass) {
+          pass.read(depth, LveResourceUsage::SampledCompute);
+          pass.sideEffects();
+        },
+        [this, i](VkCommandBuffer commandBuffer) {
+          if (meshletsCulled[lveSwapChain->getFrameIndex()])
+            depthPyramids[i]->build(commandBuffer);
+        }
+      );
+      graph->addPass(
+        "occlusion culling",
+        [](LveRenderGraph::PassBuilder &pass) { pass.sideEffects(); },
+        [this, i](VkCommandBuffer commandBuffer) {
+          size_t frameSlot = lveSwapChain->getFrameIndex();
+          if (!meshletsCulled[frameSlot])
+            return;
+          meshletCuller->cull(
+            commandBuffer,
+            static_cast<uint32_t>(frameSlot),
+            LveMeshletCuller::View{},
+            LveMeshletCuller::Phase::Late,
+            depthPyramids[i].get());
+        }
+      );
+      graph->addPass(
+        "late scene",
+        [=](LveRenderGraph::PassBuilder &pass) {
+          // everything is loaded except the swap chain image, which a resolve overwrites
+          if (color != LveRenderGraph::INVALID_RESOURCE) {
+            pass.read(color, LveResourceUsage::ColorAttachment);
+            pass.write(color, LveResourceUsage::ColorAttachment);
+          } else {
+            pass.read(swapImage, LveResourceUsage::ColorAttachment);
+          }
+          pass.write(swapImage, LveResourceUsage::ColorAttachment);
+          pass.read(depth, LveResourceUsage::DepthAttachment);
+          pass.write(depth, LveResourceUsage::DepthAttachment);
+        },
+        [this, renderGraph, swapImage, depth, color](VkCommandBuffer commandBuffer) {
+          renderScenePass(
+            commandBuffer, *renderGraph, swapImage, depth, color, LveMeshletCuller::Phase::Late);
+        }
+      );
+
+      graph->compile();
+      depthPyramids.push_back(
+        std::make_unique<LveDepthPyramid>(lveDevice, graph->imageView(depth), extent, samples));
+      renderGraphs.push_back(std::move(graph));
+    }
+  }
 
-    if (lveSwapChain)
-      lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent);
-    else {
-      lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent, std::move(lveSwapChain));
-      if (lveSwapChain->imageCount() != commandBuffers.size()) {
-        freeCommandBuffers();
-        createCommandBuffers();
+  // The scene is drawn in one pass, or with occlusion culling split into an early pass that
+  // clears the attachments and a late pass that loads them
+  void FirstApp::renderScenePass(
+      VkCommandBuffer commandBuffer,
+      LveRenderGraph &renderGraph,
+      LveRenderGraph::Resource swapImage,
+      LveRenderGraph::Resource depth,
+      LveRenderGraph::Resource color,
+      LveMeshletCuller::Phase phase) {
+    bool first = phase != LveMeshletCuller::Phase::Late;
+    bool last = phase != LveMeshletCuller::Phase::Early;
+    VkAttachmentLoadOp loadOp = first ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+    VkAttachmentStoreOp storeOp =
+      last ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+
+    // With multisampling the transient MSAA target is resolved into the swap chain image when
+    // the last pass ends, its samples are only written to memory for a pass that loads them
+    VkRenderingAttachmentInfoKHR colorAttachment{};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = loadOp;
+    colorAttachment.clearValue.color = CLEAR_COLOR;
+    if (color != LveRenderGraph::INVALID_RESOURCE) {
+      colorAttachment.imageView = renderGraph.imageView(color);
+      colorAttachment.storeOp = storeOp;
+      if (last) {
+        colorAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+        colorAttachment.resolveImageView = renderGraph.imageView(swapImage);
+        colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
       }
+    } else {
+      colorAttachment.imageView = renderGraph.imageView(swapImage);
+      colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     }
 
-    // if render pass compatible do nothing else
-    createPipeline();
+    VkRenderingAttachmentInfoKHR depthAttachment{};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    depthAttachment.imageView = renderGraph.imageView(depth);
+    depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.loadOp = loadOp;
+    depthAttachment.storeOp = storeOp;
+    depthAttachment.clearValue.depthStencil = CLEAR_DEPTH;
+
+    VkRenderingInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.renderArea.offset = {0, 0};
+    renderingInfo.renderArea.extent = lveSwapChain->getSwapChainExtent();
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+    renderingInfo.pDepthAttachment = &depthAttachment;
+
+    lveDevice.cmdBeginRendering(commandBuffer, renderingInfo);
+    renderScene(commandBuffer, phase);
+    lveDevice.cmdEndRendering(commandBuffer);
   }
 
   void FirstApp::createPipeline() {
     assert(lveSwapChain && "Cannot create pipeline before swap chain");
     assert(pipelineLayout && "Cannot create pipeline before pipeline layout");
 
+    auto configure = [this](PipelineConfigInfo &pipelineConfig) {
+      LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+      pipelineConfig.renderPass = lveSwapChain->getRenderPass();
+      pipelineConfig.colorAttachmentFormat = lveSwapChain->getSwapChainImageFormat();
+      pipelineConfig.depthAttachmentFormat = lveSwapChain->getSwapChainDepthFormat();
+      pipelineConfig.multisampleInfo.rasterizationSamples = lveSwapChain->getSampleCount();
+      pipelineConfig.pipelineLayout = pipelineLayout;
+    };
+
+    // Requested first so it starts compiling first, a registry hit is ready right away
     PipelineConfigInfo pipelineConfig{};
-    LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
-    pipelineConfig.renderPass = lveSwapChain->getRenderPass();
-    pipelineConfig.pipelineLayout = pipelineLayout;
-    lvePipeline = std::make_unique<LvePipeline>(
-      lveDevice,
+    configure(pipelineConfig);
+    pipelineConfig.fragSpecialization.set(0, GRAYSCALE);  // constant_id 0 in simple_shader.frag
+    pipelineRequest = pipelineCompiler.compile(
       "simple_shader.vert.spv",
       "simple_shader.frag.spv",
       pipelineConfig
     );
+
+    // One pipeline for every effect combination, so it is usually ready from an earlier
+    // variant when a new one is requested
+    PipelineConfigInfo fallbackConfig{};
+    configure(fallbackConfig);
+    fallbackRequest = pipelineCompiler.compile(
+      "simple_shader.vert.spv",
+      "simple_shader_uber.frag.spv",
+      fallbackConfig
+    );
+
+    // pipelines built against a render pass that was replaced are no longer referenced
+    pipelineRegistry.releaseUnused();
   }
 
   void FirstApp::createCommandBuffers() {
-    commandBuffers.resize(lveSwapChain->imageCount());
+    // One per frame in flight, the frame fence guards reuse regardless of swap chain recreation
+    commandBuffers.resize(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -136,28 +441,107 @@ namespace lve {
     commandBuffers.clear();
   }
 
-  void FirstApp::recordCommandBuffer(int i) {
+  void FirstApp::recordCommandBuffer(int imageIndex) {
+    LVE_TRACE_SCOPE("recordCommandBuffer");
+    size_t frameSlot = lveSwapChain->getFrameIndex();
+    VkCommandBuffer commandBuffer = commandBuffers[frameSlot];
+
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
-    if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS)
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
       throw std::runtime_error("failed to begin recording command buffer");
+    selectScenePipeline();
+    gpuTimer.begin(commandBuffer, static_cast<uint32_t>(frameSlot));
+    // around every pass of the frame, queries can't be begun inside one and ended outside it
+    if (pipelineStatistics)
+      pipelineStatistics->begin(commandBuffer, static_cast<uint32_t>(frameSlot));
+
+    // culling runs before rendering starts, coarser levels are cheap enough to draw whole
+    if (meshletCuller) {
+      meshletsCulled[frameSlot] = modelLod == 0;
+      if (modelLod == 0) {
+        // identity projection: the clip volume in model space, looking down +z
+        meshletCuller->cull(
+          commandBuffer,
+          static_cast<uint32_t>(frameSlot),
+          LveMeshletCuller::View{},
+          occlusionCulling ? LveMeshletCuller::Phase::Early : LveMeshletCuller::Phase::All);
+      }
+    }
+
+    if (lveSwapChain->usesDynamicRendering()) {
+      LveRenderGraph &renderGraph = *renderGraphs[lveSwapChain->getFrameIndex()];
+      renderGraph.setImage(
+        swapChainImage,
+        lveSwapChain->getImage(imageIndex),
+        lveSwapChain->getImageView(imageIndex)
+      );
+      renderGraph.execute(commandBuffer);
+    } else {
+      VkRenderPassBeginInfo renderPassInfo{};
+      renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+      renderPassInfo.renderPass = lveSwapChain->getRenderPass();
+      renderPassInfo.framebuffer = lveSwapChain->getFrameBuffer(imageIndex);
+
+      renderPassInfo.renderArea.offset = {0, 0};
+      renderPassInfo.renderArea.extent = lveSwapChain->getSwapChainExtent();
+
+      std::array<VkClearValue, 2> clearValues{};
+      clearValues[0].color = CLEAR_COLOR;
+      clearValues[1].depthStencil = CLEAR_DEPTH;
+      renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+      renderPassInfo.pClearValues = clearValues.data();
+
+      vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+      renderScene(commandBuffer, LveMeshletCuller::Phase::All);
+      vkCmdEndRenderPass(commandBuffer);
+    }
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = lveSwapChain->getRenderPass();
-    renderPassInfo.framebuffer = lveSwapChain->getFrameBuffer(i);
+    if (pipelineStatistics)
+      pipelineStatistics->end(commandBuffer, static_cast<uint32_t>(frameSlot));
+    gpuTimer.end(commandBuffer, static_cast<uint32_t>(frameSlot));
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+      throw std::runtime_error("failed to record command buffer");
+  }
 
-    renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = lveSwapChain->getSwapChainExtent();
+  // Whatever is ready, never waits for a compile
+  void FirstApp::selectScenePipeline() {
+    if (pipelineRequest.hasFailed())
+      throw std::runtime_error("failed to compile pipeline: " + pipelineRequest.error());
+    if (fallbackRequest.hasFailed())
+      throw std::runtime_error("failed to compile fallback pipeline: " + fallbackRequest.error());
+
+    auto frameStart = LveLatencyTracker::Clock::now();
+    bool compiling = !pipelineRequest.isReady();
+    if (lastFrameStart != LveLatencyTracker::Clock::time_point{}) {
+      double frameMs =
+        std::chrono::duration<double, std::milli>(frameStart - lastFrameStart).count();
+      double &longest = compiling ? longestCompilingFrameMs : longestFrameMs;
+      longest = std::max(longest, frameMs);
+    }
+    lastFrameStart = frameStart;
+
+    scenePipeline = pipelineRequest.get();
+    sceneFallback = false;
+    if (!compiling)
+      return;
 
-    std::array<VkClearValue, 2> clearValues{};
-    clearValues[0].color = {0.1f, 0.1f, 0.1f, 1.f};
-    clearValues[1].depthStencil = {1.f, 0};
-    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-    renderPassInfo.pClearValues = clearValues.data();
+    scenePipeline = fallbackRequest.get();
+    sceneFallback = scenePipeline != nullptr;
+    if (sceneFallback) {
+      fallbackFrames++;
+    } else {
+      skippedSceneFrames++;
+    }
+  }
 
-    vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  void FirstApp::renderScene(VkCommandBuffer commandBuffer, LveMeshletCuller::Phase phase) {
+    uint32_t frameSlot = static_cast<uint32_t>(lveSwapChain->getFrameIndex());
+    bool drawMeshlets = meshletCuller && meshletsCulled[frameSlot];
+    // without meshlets everything is drawn in the early pass
+    if (phase == LveMeshletCuller::Phase::Late && !drawMeshlets)
+      return;
 
     VkViewport viewport{};
     viewport.x = 0.f;
@@ -167,35 +551,143 @@ namespace lve {
     viewport.minDepth = 0.f;
     viewport.maxDepth = 1.f;
     VkRect2D scissor{{0, 0}, lveSwapChain->getSwapChainExtent()};
-    vkCmdSetViewport(commandBuffers[i], 0, 1, &viewport);
-    vkCmdSetScissor(commandBuffers[i], 0, 1, &scissor);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    // nothing to draw with until a pipeline finished compiling
+    if (!scenePipeline)
+      return;
 
-    lvePipeline->bind(commandBuffers[i]);
-    lveModel->bind(commandBuffers[i]);
-    lveModel->draw(commandBuffers[i]);
+    // Only the one model so far, ids index the scene's pipelines and meshes. The model is
+    // drawn straight in clip space, its depth in the key is left at 0.
+    renderQueue.clear();
+    renderQueue.add(LveRenderQueue::makeKey(0, 0, 0, 0, 0.f), 0);
+    renderQueue.sort();
+
+    for (const auto &draw : renderQueue.draws()) {
+      if (draw.changes & LveRenderQueue::PIPELINE) {
+        scenePipeline->bind(commandBuffer);
+        if (sceneFallback) {
+          uint32_t effects = GRAYSCALE ? UBER_EFFECT_GRAYSCALE : 0;
+          vkCmdPushConstants(
+            commandBuffer,
+            pipelineLayout,
+            VK_SHADER_STAGE_FRAGMENT_BIT,
+            0,
+            sizeof(effects),
+            &effects);
+        }
+      }
+      if (draw.changes & LveRenderQueue::MESH)
+        lveModel->bind(commandBuffer);
 
-    vkCmdEndRenderPass(commandBuffers[i]);
-    if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
-      throw std::runtime_error("failed to record command buffer");
+      if (drawMeshlets) {
+        meshletCuller->draw(commandBuffer, frameSlot, phase);
+      } else {
+        lveModel->draw(commandBuffer, modelLod);
+      }
+    }
+    if (phase == LveMeshletCuller::Phase::Late)
+      return;
+
+    submittedTriangles += lveModel->getTriangleCount(modelLod);
+    fullDetailTriangles += lveModel->getTriangleCount();
+    renderedFrames++;
+  }
+
+  // The slot's fence has been waited for by acquireNextImage, its counters are final
+  void FirstApp::readMeshletStats(size_t frameSlot) {
+    if (!meshletCuller || !meshletsCulled[frameSlot])
+      return;
+
+    LveMeshletCuller::Stats stats = meshletCuller->readStats(static_cast<uint32_t>(frameSlot));
+    culledMeshlets += stats.frustumCulled + stats.backfaceCulled + stats.occlusionCulled;
+    occludedMeshlets += stats.occlusionCulled;
+    meshletFrames++;
+    meshletsCulled[frameSlot] = false;
+  }
+
+  // Main thread: everything drawFrame needs from the window and the scene, sampled now
+  void FirstApp::simulate(RenderSnapshot &snapshot) {
+    LVE_TRACE_SCOPE("simulate");
+    snapshot.inputTime = LveLatencyTracker::Clock::now();
+    snapshot.extent = lveWindow.getExtent();
+    snapshot.windowResized = lveWindow.wasWindowResized();
+    lveWindow.resetWindowResizedFlag();
+
+    // the model is drawn straight in clip space, without a camera, at the window's height
+    float viewportHeight = static_cast<float>(snapshot.extent.height);
+    float pixelsPerUnit = LveLodSelector::pixelsPerUnit(glm::mat4{1.f}, 1.f, viewportHeight);
+    selectedLod = lodSelector.select(*lveModel, pixelsPerUnit, selectedLod);
+    snapshot.modelLod = selectedLod;
   }
 
-  void FirstApp::drawFrame() {
+  // Render thread: draws snapshots in the order the main thread published them
+  void FirstApp::renderLoop() {
+    LveTrace::setThreadName("render");
+    uint32_t slot;
+    while (true) {
+      // like drawFrame, only touches render thread state: the swap chain and latency tracker
+      if (LOW_LATENCY_MODE)
+        waitForFrame();
+      if (!snapshotQueue.acquire(slot))
+        break;
+      drawFrame(renderSnapshots[slot]);
+    }
+  }
+
+  void FirstApp::waitForFrame() {
+    LVE_TRACE_SCOPE("waitForFrame");
+    lveSwapChain->waitForFrameFence();
+    latencyTracker.frameSlotCompleted(lveSwapChain->getFrameIndex());
+
+    if (!latencyTracker.measuresPresent())
+      return;
+
+    uint64_t lastPresentId = lveSwapChain->lastPresentId();
+    if (lastPresentId <= PRESENT_WAIT_QUEUED_FRAMES)
+      return;
+
+    // Don't block forever if the window is hidden and nothing gets displayed
+    constexpr uint64_t timeout = 100'000'000;
+    uint64_t presentId = lastPresentId - PRESENT_WAIT_QUEUED_FRAMES;
+    if (lveSwapChain->waitForPresent(presentId, timeout) == VK_SUCCESS)
+      latencyTracker.framePresented(presentId);
+  }
+
+  void FirstApp::drawFrame(const RenderSnapshot &snapshot) {
+    LVE_TRACE_SCOPE("drawFrame");
+    latencyTracker.inputSampled(snapshot.inputTime);
+    modelLod = snapshot.modelLod;
+
     uint32_t imageIndex;
     auto result = lveSwapChain->acquireNextImage(&imageIndex);
+    size_t frameSlot = lveSwapChain->getFrameIndex();
+    latencyTracker.frameSlotCompleted(frameSlot);
+    // the slot's fence was waited for, its previous frame finished on the GPU
+    gpuTimer.collect(static_cast<uint32_t>(frameSlot), "frame", "graphics queue");
+    if (pipelineStatistics)
+      pipelineStatistics->collect(static_cast<uint32_t>(frameSlot));
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-      recreateSwapChain();
+      recreateSwapChain(snapshot.extent);
       return;
     }
 
     if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
       throw std::runtime_error("failed to acquire swap chain image");
 
+    readMeshletStats(frameSlot);
+    lveDevice.memoryBudget().update();
+    if (MEMORY_LOG_INTERVAL > 0 && drawnFrames % MEMORY_LOG_INTERVAL == 0)
+      lveDevice.memoryBudget().printStats();
+    drawnFrames++;
     recordCommandBuffer(imageIndex);
-    result = lveSwapChain->submitCommandBuffers(&commandBuffers[imageIndex], &imageIndex);
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || lveWindow.wasWindowResized()) {
-      lveWindow.resetWindowResizedFlag();
-      recreateSwapChain();
+    lveDevice.frameStats().endFrame();
+    result = lveSwapChain->submitCommandBuffers(&commandBuffers[frameSlot], &imageIndex);
+    latencyTracker.frameSubmitted(lveSwapChain->lastPresentId(), frameSlot);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || snapshot.windowResized) {
+      recreateSwapChain(snapshot.extent);
       return;
     }
 
@@ -3,9 +3,23 @@
 #include "lve_window.hpp"
 #include "lve_pipeline.hpp"
 #include "lve_device.hpp"
+#include "lve_gpu_timer.hpp"
+#include "lve_depth_pyramid.hpp"
 #include "lve_swap_chain.hpp"
 #include "lve_model.hpp"
+#include "lve_latency_tracker.hpp"
+#include "lve_lod_selector.hpp"
+#include "lve_meshlet_culler.hpp"
+#include "lve_pipeline_compiler.hpp"
+#include "lve_pipeline_statistics.hpp"
+#include "lve_pipeline_registry.hpp"
+#include "lve_procedural.hpp"
+#include "lve_render_graph.hpp"
+#include "lve_render_queue.hpp"
+#include "lve_snapshot_queue.hpp"
+#include "lve_thread_pool.hpp"
 
+#include <array>
 #include <memory>
 
 namespace lve {
@@ -14,6 +28,53 @@ namespace lve {
       static constexpr int WIDTH = 800;
       static constexpr int HEIGHT = 600;
 
+      // Record and submit frames on a render thread while the main thread polls input and
+      // simulates the next one, so simulation time no longer adds to the frame time
+      static constexpr bool RENDER_THREAD = true;
+      // Snapshots shared with the render thread, simulation runs up to one less ahead of it
+      static constexpr uint32_t RENDER_SNAPSHOTS = 3;
+      // Wait for the frame fence, and the present wait below, before the next frame starts.
+      // Without RENDER_THREAD the main thread waits before polling input so input is as fresh
+      // as possible. With it the render thread waits before taking the next snapshot, which
+      // throttles simulation through the snapshot queue, but input is still sampled up to
+      // RENDER_SNAPSHOTS - 1 frames ahead of the frame that shows it.
+      static constexpr bool LOW_LATENCY_MODE = true;
+      // Throttle the CPU to display cadence with VK_KHR_present_wait when available, part of
+      // the LOW_LATENCY_MODE wait
+      static constexpr bool PRESENT_WAIT_THROTTLE = true;
+      // Presents allowed to be queued while sampling input for the next frame
+      static constexpr uint64_t PRESENT_WAIT_QUEUED_FRAMES = 1;
+      // Clamped to the highest count the device supports for color and depth attachments
+      static constexpr VkSampleCountFlagBits MSAA_SAMPLES = VK_SAMPLE_COUNT_4_BIT;
+      // Render without render pass and framebuffer objects when the device supports it
+      static constexpr bool DYNAMIC_RENDERING = true;
+      // Fragment shader variant, selected with a specialization constant
+      static constexpr bool GRAYSCALE = false;
+      // Bit of simple_shader_uber.frag's effects push constant for GRAYSCALE
+      static constexpr uint32_t UBER_EFFECT_GRAYSCALE = 1;
+      // Subdivisions of the triangle that is drawn, 0 draws a single triangle
+      static constexpr uint32_t SIERPINSKI_DEPTH = 0;
+      // Simplified levels generated for the model, 1 draws the mesh as generated
+      static constexpr uint32_t MODEL_LOD_LEVELS = 4;
+      // Screen space error a level of detail may show, in pixels
+      static constexpr float LOD_MAX_PIXEL_ERROR = 1.f;
+      // Draw the full detail level as meshlets culled by a compute pass
+      static constexpr bool MESHLET_CULLING = true;
+      // Skip meshlets hidden behind last frame's visible ones, needs dynamic rendering
+      static constexpr bool OCCLUSION_CULLING = true;
+      // Count primitives and shader invocations of every frame, when the device supports it
+      static constexpr bool PIPELINE_STATISTICS = true;
+      static constexpr VkClearColorValue CLEAR_COLOR = {{0.1f, 0.1f, 0.1f, 1.f}};
+      static constexpr VkClearDepthStencilValue CLEAR_DEPTH = {1.f, 0};
+      // Frames between memory budget log lines, 0 to disable
+      static constexpr uint64_t MEMORY_LOG_INTERVAL = 1000;
+      // Share of a heap's budget above which a warning is logged
+      static constexpr float MEMORY_WARNING_RATIO = 0.9f;
+      // Per-frame latency csv, empty to disable
+      static constexpr const char *LATENCY_LOG_PATH = "";
+      // Chrome trace of CPU scopes and GPU frames, written when run() returns, empty to disable
+      static constexpr const char *TRACE_PATH = "";
+
       FirstApp();
       ~FirstApp();
 
@@ -23,22 +84,100 @@ namespace lve {
     void run();
 
     private:
+      // What the main thread hands drawFrame, written whole before it's published
+      struct RenderSnapshot {
+        LveLatencyTracker::Clock::time_point inputTime;
+        VkExtent2D extent;
+        bool windowResized;
+        uint32_t modelLod;
+      };
+
       LveWindow lveWindow{ WIDTH, HEIGHT, "Vulkan" };
       LveDevice lveDevice{lveWindow};
+      LvePipelineRegistry pipelineRegistry{lveDevice};
+      LveThreadPool threadPool;
+      LvePipelineCompiler pipelineCompiler{lveDevice, threadPool, &pipelineRegistry};
       std::unique_ptr<LveSwapChain> lveSwapChain;
-      std::unique_ptr<LvePipeline> lvePipeline;
+      // Both compile on workers, nothing on the render thread waits for them. Frames draw with
+      // pipelineRequest once it's ready and until then with fallbackRequest, simple_shader_uber
+      // taking the effects as a push constant. Frames before either is ready skip the scene.
+      LvePipelineRequest pipelineRequest;
+      LvePipelineRequest fallbackRequest;
+      // Picked by recordCommandBuffer for the frame being recorded
+      LvePipeline *scenePipeline = nullptr;
+      bool sceneFallback = false;
+      // Frames recorded while pipelineRequest compiled, and the longest frame time then and
+      // after, to show the compile doesn't stall frames
+      uint64_t fallbackFrames = 0;
+      uint64_t skippedSceneFrames = 0;
+      double longestCompilingFrameMs = 0.0;
+      double longestFrameMs = 0.0;
+      LveLatencyTracker::Clock::time_point lastFrameStart{};
       VkPipelineLayout pipelineLayout;
       std::vector<VkCommandBuffer> commandBuffers;
+      // One per frame in flight, only used with dynamic rendering
+      std::vector<std::unique_ptr<LveRenderGraph>> renderGraphs;
+      LveRenderGraph::Resource swapChainImage = LveRenderGraph::INVALID_RESOURCE;
       std::unique_ptr<LveModel> lveModel;
+      // Scene draws sorted by state, rebuilt for every pass
+      LveRenderQueue renderQueue;
+      LveLodSelector lodSelector{LOD_MAX_PIXEL_ERROR};
+      uint32_t modelLod = 0;
+      // Triangles drawn, and what the full detail meshes would have cost
+      uint64_t submittedTriangles = 0;
+      uint64_t fullDetailTriangles = 0;
+      uint64_t renderedFrames = 0;
+      // Every frame drawFrame records, also those without the scene, paces the memory log
+      uint64_t drawnFrames = 0;
+      // Only set up with MESHLET_CULLING, used while the model is at full detail
+      std::unique_ptr<LveMeshletCuller> meshletCuller;
+      // Whether each frame in flight culled meshlets, their counters are read once it completes
+      std::vector<bool> meshletsCulled;
+      uint64_t culledMeshlets = 0;
+      uint64_t occludedMeshlets = 0;
+      uint64_t meshletFrames = 0;
+      // Set up by createRenderGraphs, one pyramid per render graph
+      bool occlusionCulling = false;
+      std::vector<std::unique_ptr<LveDepthPyramid>> depthPyramids;
+      // presents are only measured by waitForFrame
+      LveLatencyTracker latencyTracker{
+        LveSwapChain::MAX_FRAMES_IN_FLIGHT,
+        LOW_LATENCY_MODE && PRESENT_WAIT_THROTTLE && lveDevice.presentWaitEnabled(),
+        LATENCY_LOG_PATH
+      };
+      // One range per frame in flight, around its whole command buffer
+      LveGpuTimer gpuTimer{lveDevice, LveSwapChain::MAX_FRAMES_IN_FLIGHT};
+      // Only set up with PIPELINE_STATISTICS, one query per frame in flight
+      std::unique_ptr<LvePipelineStatistics> pipelineStatistics;
+      // Without RENDER_THREAD only the first snapshot is used, nothing is ever published
+      std::array<RenderSnapshot, RENDER_SNAPSHOTS> renderSnapshots;
+      LveSnapshotQueue snapshotQueue{RENDER_SNAPSHOTS};
+      // Main thread side, modelLod is the level of the frame being rendered
+      uint32_t selectedLod = 0;
 
       void loadModels();
       void createPipelineLayout();
       void createPipeline();
       void createCommandBuffers();
       void freeCommandBuffers();
-      void drawFrame();
-      void recreateSwapChain();
+      VkExtent2D waitWhileMinimized();
+      void simulate(RenderSnapshot &snapshot);
+      void renderLoop();
+      void waitForFrame();
+      void drawFrame(const RenderSnapshot &snapshot);
+      void recreateSwapChain(VkExtent2D extent);
+      void createRenderGraphs();
       void recordCommandBuffer(int imageIndex);
+      void readMeshletStats(size_t frameSlot);
+      void selectScenePipeline();
+      void renderScenePass(
+        VkCommandBuffer commandBuffer,
+        LveRenderGraph &renderGraph,
+        LveRenderGraph::Resource swapImage,
+        LveRenderGraph::Resource depth,
+        LveRenderGraph::Resource color,
+        LveMeshletCuller::Phase phase);
+      void renderScene(VkCommandBuffer commandBuffer, LveMeshletCuller::Phase phase);
   };
 }
 
@@ -0,0 +1,103 @@
+#include "lve_deletion_queue.hpp"
+
+// std
+#include <stdexcept>
+
+namespace lve {
+
+LveDeletionQueue::LveDeletionQueue(VkDevice device, LveMemoryBudget *memoryBudget)
+    : device{device}, memoryBudget{memoryBudget} {}
+
+LveDeletionQueue::~LveDeletionQueue() { flush(); }
+
+void LveDeletionQueue::push(VkObjectType type, uint64_t handle) {
+  if (handle == 0) return;
+
+  std::lock_guard<std::mutex> lock{mutex};
+  entries.push_back({type, handle, frame});
+  stats_.pending++;
+  stats_.totalQueued++;
+}
+
+uint64_t LveDeletionQueue::frameSubmitted() {
+  std::lock_guard<std::mutex> lock{mutex};
+  stats_.destroyedLastFrame = stats_.destroyedThisFrame;
+  stats_.destroyedThisFrame = 0;
+  return frame++;
+}
+
+void LveDeletionQueue::collect(uint64_t completedFrame) {
+  std::lock_guard<std::mutex> lock{mutex};
+  // entries are queued in frame order, so everything that can go is at the front
+  while (!entries.empty() && entries.front().frame <= completedFrame) {
+    destroy(entries.front());
+    entries.pop_front();
+  }
+}
+
+void LveDeletionQueue::flush() {
+  std::lock_guard<std::mutex> lock{mutex};
+  while (!entries.empty()) {
+    destroy(entries.front());
+    entries.pop_front();
+  }
+}
+
+void LveDeletionQueue::destroy(const Entry &entry) {
+  switch (entry.type) {
+    case VK_OBJECT_TYPE_BUFFER:
+      vkDestroyBuffer(device, (VkBuffer)entry.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_IMAGE:
+      vkDestroyImage(device, (VkImage)entry.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_IMAGE_VIEW:
+      vkDestroyImageView(device, (VkImageView)entry.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_DEVICE_MEMORY:
+      if (memoryBudget) memoryBudget->freed((VkDeviceMemory)entry.handle);
+      vkFreeMemory(device, (VkDeviceMemory)entry.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_PIPELINE:
+      vkDestroyPipeline(device, (VkPipeline)entry.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_SAMPLER:
+      vkDestroySampler(device, (VkSampler)entry.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_SHADER_MODULE:
+      vkDestroyShaderModule(device, (VkShaderModule)entry.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_FRAMEBUFFER:
+      vkDestroyFramebuffer(device, (VkFramebuffer)entry.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_RENDER_PASS:
+      vkDestroyRenderPass(device, (VkRenderPass)entry.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_SEMAPHORE:
+      vkDestroySemaphore(device, (VkSemaphore)entry.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_FENCE:
+      vkDestroyFence(device, (VkFence)entry.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+      vkDestroyPipelineLayout(device, (VkPipelineLayout)entry.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT:
+      vkDestroyDescriptorSetLayout(device, (VkDescriptorSetLayout)entry.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+      vkDestroyDescriptorPool(device, (VkDescriptorPool)entry.handle, nullptr);
+      break;
+    case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+      vkDestroySwapchainKHR(device, (VkSwapchainKHR)entry.handle, nullptr);
+      break;
+    default:
+      throw std::runtime_error("deletion queue: unsupported object type");
+  }
+
+  stats_.pending--;
+  stats_.destroyedThisFrame++;
+  stats_.totalDestroyed++;
+}
+
+}  // namespace lve
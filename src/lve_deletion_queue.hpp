@@ -0,0 +1,96 @@
+#pragma once
+
+#include "lve_memory_budget.hpp"
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace lve {
+
+// Defers destruction of Vulkan objects until the GPU has finished every frame that could still
+// reference them. Objects are stamped with the frame currently being recorded and destroyed once
+// that frame is known to be complete, so freeing resources never requires vkDeviceWaitIdle.
+// Objects may be queued from any thread.
+class LveDeletionQueue {
+ public:
+  struct Stats {
+    uint32_t pending = 0;
+    uint32_t destroyedThisFrame = 0;
+    uint32_t destroyedLastFrame = 0;
+    uint64_t totalQueued = 0;
+    uint64_t totalDestroyed = 0;
+  };
+
+  // memoryBudget, if set, is told about every allocation the queue frees
+  explicit LveDeletionQueue(VkDevice device, LveMemoryBudget *memoryBudget = nullptr);
+  ~LveDeletionQueue();
+
+  LveDeletionQueue(const LveDeletionQueue &) = delete;
+  LveDeletionQueue &operator=(const LveDeletionQueue &) = delete;
+
+  void destroyBuffer(VkBuffer buffer) { push(VK_OBJECT_TYPE_BUFFER, (uint64_t)buffer); }
+  void destroyImage(VkImage image) { push(VK_OBJECT_TYPE_IMAGE, (uint64_t)image); }
+  void destroyImageView(VkImageView view) { push(VK_OBJECT_TYPE_IMAGE_VIEW, (uint64_t)view); }
+  void freeMemory(VkDeviceMemory memory) { push(VK_OBJECT_TYPE_DEVICE_MEMORY, (uint64_t)memory); }
+  void destroyPipeline(VkPipeline pipeline) { push(VK_OBJECT_TYPE_PIPELINE, (uint64_t)pipeline); }
+  void destroySampler(VkSampler sampler) { push(VK_OBJECT_TYPE_SAMPLER, (uint64_t)sampler); }
+  void destroyShaderModule(VkShaderModule module) {
+    push(VK_OBJECT_TYPE_SHADER_MODULE, (uint64_t)module);
+  }
+  void destroyFramebuffer(VkFramebuffer framebuffer) {
+    push(VK_OBJECT_TYPE_FRAMEBUFFER, (uint64_t)framebuffer);
+  }
+  void destroyRenderPass(VkRenderPass renderPass) {
+    push(VK_OBJECT_TYPE_RENDER_PASS, (uint64_t)renderPass);
+  }
+  void destroySemaphore(VkSemaphore semaphore) {
+    push(VK_OBJECT_TYPE_SEMAPHORE, (uint64_t)semaphore);
+  }
+  void destroyFence(VkFence fence) { push(VK_OBJECT_TYPE_FENCE, (uint64_t)fence); }
+  void destroyPipelineLayout(VkPipelineLayout layout) {
+    push(VK_OBJECT_TYPE_PIPELINE_LAYOUT, (uint64_t)layout);
+  }
+  void destroyDescriptorSetLayout(VkDescriptorSetLayout layout) {
+    push(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, (uint64_t)layout);
+  }
+  void destroyDescriptorPool(VkDescriptorPool pool) {
+    push(VK_OBJECT_TYPE_DESCRIPTOR_POOL, (uint64_t)pool);
+  }
+  void destroySwapchain(VkSwapchainKHR swapChain) {
+    push(VK_OBJECT_TYPE_SWAPCHAIN_KHR, (uint64_t)swapChain);
+  }
+
+  // Returns the id of the frame that was just submitted and starts recording the next one
+  uint64_t frameSubmitted();
+  // Destroys everything queued while recording frames up to and including completedFrame
+  void collect(uint64_t completedFrame);
+  // Destroys everything, the caller must make sure the device is idle
+  void flush();
+
+  uint64_t currentFrame() { return frame; }
+  const Stats &stats() { return stats_; }
+
+ private:
+  struct Entry {
+    VkObjectType type;
+    uint64_t handle;
+    uint64_t frame;
+  };
+
+  void push(VkObjectType type, uint64_t handle);
+  void destroy(const Entry &entry);
+
+  VkDevice device;
+  LveMemoryBudget *memoryBudget;
+  std::mutex mutex;
+  std::deque<Entry> entries;
+  uint64_t frame = 1;
+  Stats stats_;
+};
+
+}  // namespace lve
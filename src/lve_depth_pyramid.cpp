@@ -0,0 +1,299 @@
+#include "lve_depth_pyramid.hpp"
+
+#include "lve_shader_module.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+constexpr uint32_t WORKGROUP_SIZE = 8;  // local_size_x and local_size_y in depth_pyramid.glsl
+constexpr VkFormat PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+
+struct PushConstants {
+  uint32_t sourceSize[2];
+  uint32_t destinationSize[2];
+  uint32_t samples;
+};
+
+VkPipeline createComputePipeline(
+    LveDevice &device, VkPipelineLayout pipelineLayout, const std::string &filepath) {
+  // only needed while the pipeline is created
+  LveShaderModule shaderModule{device, filepath};
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = shaderModule.module();
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = pipelineLayout;
+
+  VkPipeline pipeline;
+  if (vkCreateComputePipelines(
+          device.device(),
+          device.pipelineCache(),
+          1,
+          &pipelineInfo,
+          nullptr,
+          &pipeline) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create depth pyramid pipeline!");
+  }
+  return pipeline;
+}
+
+}  // namespace
+
+LveDepthPyramid::LveDepthPyramid(
+    LveDevice &device,
+    VkImageView depthView,
+    VkExtent2D depthExtent,
+    VkSampleCountFlagBits depthSamples)
+    : lveDevice{device},
+      depthExtent_{depthExtent},
+      depthSamples{static_cast<uint32_t>(depthSamples)} {
+  createImage();
+  createPipelines(depthSamples);
+  createDescriptorSets(depthView);
+}
+
+LveDepthPyramid::~LveDepthPyramid() {
+  auto &deletionQueue = lveDevice.deletionQueue();
+  for (auto &level : levels) {
+    deletionQueue.destroyImageView(level.view);
+  }
+  deletionQueue.destroyImageView(pyramidView);
+  deletionQueue.destroyImage(image);
+  deletionQueue.freeMemory(imageMemory);
+  deletionQueue.destroySampler(sampler_);
+  if (firstLevelPipeline != pipeline) {
+    deletionQueue.destroyPipeline(firstLevelPipeline);
+  }
+  deletionQueue.destroyPipeline(pipeline);
+  deletionQueue.destroyPipelineLayout(pipelineLayout);
+}
+
+bool LveDepthPyramid::isSupported(
+    LveDevice &device, VkFormat depthFormat, VkSampleCountFlagBits depthSamples) {
+  if (!device.isFormatSupported(
+          depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+    return false;
+  }
+  return (device.properties.limits.sampledImageDepthSampleCounts & depthSamples) != 0;
+}
+
+void LveDepthPyramid::createImage() {
+  VkExtent2D extent{
+      std::max(depthExtent_.width / 2, 1u),
+      std::max(depthExtent_.height / 2, 1u)};
+  levelCount_ = 1;
+  while ((std::max(extent.width, extent.height) >> levelCount_) > 0) {
+    levelCount_++;
+  }
+
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = extent.width;
+  imageInfo.extent.height = extent.height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = levelCount_;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = PYRAMID_FORMAT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  lveDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = PYRAMID_FORMAT;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.baseMipLevel = 0;
+  viewInfo.subresourceRange.levelCount = levelCount_;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+  if (vkCreateImageView(lveDevice.device(), &viewInfo, nullptr, &pyramidView) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create depth pyramid image view!");
+  }
+
+  levels.resize(levelCount_);
+  for (uint32_t i = 0; i < levelCount_; i++) {
+    levels[i].extent = {std::max(extent.width >> i, 1u), std::max(extent.height >> i, 1u)};
+    viewInfo.subresourceRange.baseMipLevel = i;
+    viewInfo.subresourceRange.levelCount = 1;
+    if (vkCreateImageView(lveDevice.device(), &viewInfo, nullptr, &levels[i].view) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to create depth pyramid level view!");
+    }
+  }
+
+  // texels are fetched, never filtered
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_NEAREST;
+  samplerInfo.minFilter = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+  if (vkCreateSampler(lveDevice.device(), &samplerInfo, nullptr, &sampler_) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create depth pyramid sampler!");
+  }
+}
+
+void LveDepthPyramid::createPipelines(VkSampleCountFlagBits depthSamples) {
+  setLayout =
+      LveDescriptorSetLayout::Builder(lveDevice)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+          .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+          .build();
+
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(PushConstants);
+
+  VkDescriptorSetLayout descriptorSetLayout = setLayout->getDescriptorSetLayout();
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create depth pyramid pipeline layout!");
+  }
+
+  pipeline = createComputePipeline(lveDevice, pipelineLayout, "depth_pyramid.comp.spv");
+  firstLevelPipeline =
+      depthSamples == VK_SAMPLE_COUNT_1_BIT
+          ? pipeline
+          : createComputePipeline(lveDevice, pipelineLayout, "depth_pyramid_ms.comp.spv");
+}
+
+void LveDepthPyramid::createDescriptorSets(VkImageView depthView) {
+  descriptorPool = LveDescriptorPool::Builder(lveDevice)
+                       .setMaxSets(levelCount_)
+                       .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, levelCount_)
+                       .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, levelCount_)
+                       .build();
+
+  for (uint32_t i = 0; i < levelCount_; i++) {
+    // every level reads the one above it, the first one reads the attachment
+    VkDescriptorImageInfo sourceInfo{};
+    sourceInfo.sampler = sampler_;
+    if (i == 0) {
+      sourceInfo.imageView = depthView;
+      sourceInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    } else {
+      sourceInfo.imageView = levels[i - 1].view;
+      sourceInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+    VkDescriptorImageInfo destinationInfo{};
+    destinationInfo.imageView = levels[i].view;
+    destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    bool allocated = LveDescriptorWriter(*setLayout, *descriptorPool)
+                         .writeImage(0, &sourceInfo)
+                         .writeImage(1, &destinationInfo)
+                         .build(levels[i].descriptorSet);
+    if (!allocated) {
+      throw std::runtime_error("failed to allocate depth pyramid descriptor set!");
+    }
+  }
+}
+
+void LveDepthPyramid::build(VkCommandBuffer commandBuffer) {
+  // The previous contents are discarded, only the culling that read them has to be done
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount_, 0, 1};
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &barrier);
+
+  VkExtent2D sourceExtent = depthExtent_;
+  for (uint32_t i = 0; i < levelCount_; i++) {
+    const Level &level = levels[i];
+    if (i <= 1) {
+      vkCmdBindPipeline(
+          commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, i == 0 ? firstLevelPipeline : pipeline);
+      lveDevice.frameStats().pipelineBound();
+    }
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        pipelineLayout,
+        0,
+        1,
+        &level.descriptorSet,
+        0,
+        nullptr);
+
+    PushConstants push{};
+    push.sourceSize[0] = sourceExtent.width;
+    push.sourceSize[1] = sourceExtent.height;
+    push.destinationSize[0] = level.extent.width;
+    push.destinationSize[1] = level.extent.height;
+    push.samples = depthSamples;
+    vkCmdPushConstants(
+        commandBuffer,
+        pipelineLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        0,
+        sizeof(PushConstants),
+        &push);
+    vkCmdDispatch(
+        commandBuffer,
+        (level.extent.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+        (level.extent.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+        1);
+
+    // read by the next level and by culling
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.subresourceRange.baseMipLevel = i;
+    barrier.subresourceRange.levelCount = 1;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier);
+
+    sourceExtent = level.extent;
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+namespace lve {
+
+// Mip chain of the farthest depth in each texel, reduced from a depth attachment by a compute
+// shader for occlusion culling (see LveMeshletCuller). Level 0 is half the attachment's size
+// rounded down, texels of level n cover 2^(n+1) attachment pixels per axis, with the last row
+// and column also covering what odd sizes leave over. Multisampled attachments are reduced over
+// all of their samples.
+class LveDepthPyramid {
+ public:
+  // depthView is read in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL by every build()
+  LveDepthPyramid(
+      LveDevice &device,
+      VkImageView depthView,
+      VkExtent2D depthExtent,
+      VkSampleCountFlagBits depthSamples);
+  ~LveDepthPyramid();
+
+  LveDepthPyramid(const LveDepthPyramid &) = delete;
+  LveDepthPyramid &operator=(const LveDepthPyramid &) = delete;
+
+  // Whether attachments of this format and sample count can be read by the reduction
+  static bool isSupported(
+      LveDevice &device, VkFormat depthFormat, VkSampleCountFlagBits depthSamples);
+
+  // Leaves the pyramid in VK_IMAGE_LAYOUT_GENERAL, readable by compute shaders
+  void build(VkCommandBuffer commandBuffer);
+
+  // All levels, sampled with texelFetch
+  VkImageView imageView() const { return pyramidView; }
+  VkSampler sampler() const { return sampler_; }
+  uint32_t levelCount() const { return levelCount_; }
+  VkExtent2D depthExtent() const { return depthExtent_; }
+
+ private:
+  struct Level {
+    VkExtent2D extent;
+    VkImageView view;
+    VkDescriptorSet descriptorSet;
+  };
+
+  void createImage();
+  void createPipelines(VkSampleCountFlagBits depthSamples);
+  void createDescriptorSets(VkImageView depthView);
+
+  LveDevice &lveDevice;
+  VkExtent2D depthExtent_;
+  uint32_t depthSamples;
+  uint32_t levelCount_;
+
+  VkImage image;
+  VkDeviceMemory imageMemory;
+  VkImageView pyramidView;
+  VkSampler sampler_;
+  std::vector<Level> levels;
+
+  std::unique_ptr<LveDescriptorSetLayout> setLayout;
+  std::unique_ptr<LveDescriptorPool> descriptorPool;
+  VkPipelineLayout pipelineLayout;
+  // the first level is read from the attachment, which needs its own shader when multisampled
+  VkPipeline firstLevelPipeline;
+  VkPipeline pipeline;
+};
+
+}  // namespace lve
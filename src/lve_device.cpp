@@ -1,6 +1,10 @@
 #include "lve_device.hpp"
 
+#include "lve_gpu_timer.hpp"
+#include "lve_trace.hpp"
+
 // std headers
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -47,16 +51,32 @@ void DestroyDebugUtilsMessengerEXT(
 }
 
 // class member functions
-LveDevice::LveDevice(LveWindow &window) : window{window} {
+LveDevice::LveDevice(LveWindow &window) : window{&window} { init(); }
+
+LveDevice::LveDevice() { init(); }
+
+void LveDevice::init() {
   createInstance();
   setupDebugMessenger();
-  createSurface();
+  if (window) {
+    createSurface();
+  }
   pickPhysicalDevice();
   createLogicalDevice();
   createCommandPool();
+  createPipelineCache();
+  memoryBudget_ = std::make_unique<LveMemoryBudget>(
+      physicalDevice, isExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME));
+  deletionQueue_ = std::make_unique<LveDeletionQueue>(device_, memoryBudget_.get());
+  singleTimeTimer_ = std::make_unique<LveGpuTimer>(*this, 1);
 }
 
 LveDevice::~LveDevice() {
+  vkDeviceWaitIdle(device_);
+  singleTimeTimer_.reset();
+  deletionQueue_.reset();
+
+  vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
   vkDestroyCommandPool(device_, commandPool, nullptr);
   vkDestroyDevice(device_, nullptr);
 
@@ -64,7 +84,9 @@ LveDevice::~LveDevice() {
     DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
   }
 
-  vkDestroySurfaceKHR(instance, surface_, nullptr);
+  if (surface_ != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(instance, surface_, nullptr);
+  }
   vkDestroyInstance(instance, nullptr);
 }
 
@@ -79,7 +101,16 @@ void LveDevice::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+
+  // vkEnumerateInstanceVersion only exists on 1.1+ loaders
+  auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+      vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+  if (enumerateInstanceVersion != nullptr) {
+    uint32_t instanceVersion = VK_API_VERSION_1_0;
+    enumerateInstanceVersion(&instanceVersion);
+    apiVersion_ = std::min(instanceVersion, static_cast<uint32_t>(VK_API_VERSION_1_3));
+  }
+  appInfo.apiVersion = apiVersion_;
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -131,6 +162,9 @@ void LveDevice::pickPhysicalDevice() {
 
   vkGetPhysicalDeviceProperties(physicalDevice, &properties);
   std::cout << "Physical device: " << properties.deviceName << std::endl;
+
+  // the device may support less than the instance, only use what both understand
+  apiVersion_ = std::min(apiVersion_, properties.apiVersion);
 }
 
 void LveDevice::createLogicalDevice() {
@@ -149,8 +183,141 @@ void LveDevice::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
-  VkPhysicalDeviceFeatures deviceFeatures = {};
-  deviceFeatures.samplerAnisotropy = VK_TRUE;
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(
+      physicalDevice,
+      nullptr,
+      &extensionCount,
+      availableExtensions.data());
+
+  std::unordered_set<std::string> available;
+  for (const auto &extension : availableExtensions) {
+    available.insert(extension.extensionName);
+  }
+
+  std::vector<const char *> extensions = getRequiredDeviceExtensions();
+  for (const char *extension : optionalDeviceExtensions) {
+    if (available.count(extension)) {
+      extensions.push_back(extension);
+    }
+  }
+
+  VkPhysicalDeviceFeatures2 deviceFeatures = {};
+  deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  deviceFeatures.features.samplerAnisotropy = VK_TRUE;
+
+  VkPhysicalDeviceFeatures supportedCoreFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedCoreFeatures);
+  deviceFeatures.features.multiDrawIndirect = supportedCoreFeatures.multiDrawIndirect;
+  multiDrawIndirect_ = supportedCoreFeatures.multiDrawIndirect == VK_TRUE;
+  deviceFeatures.features.pipelineStatisticsQuery = supportedCoreFeatures.pipelineStatisticsQuery;
+  pipelineStatisticsQuery_ = supportedCoreFeatures.pipelineStatisticsQuery == VK_TRUE;
+
+  // optional features are queried through vkGetPhysicalDeviceFeatures2 which needs 1.1
+  VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {};
+  presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+  VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {};
+  presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+  VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+  dynamicRenderingFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+  VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features = {};
+  synchronization2Features.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+
+  // both depend on the swap chain extension
+  bool presentWaitAvailable = window && apiVersion_ >= VK_API_VERSION_1_1 &&
+                              available.count(VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+                              available.count(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+  // core in 1.3, before that the extension and the extensions it depends on
+  bool dynamicRenderingAvailable =
+      apiVersion_ >= VK_API_VERSION_1_3 ||
+      (apiVersion_ >= VK_API_VERSION_1_1 &&
+       available.count(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) &&
+       available.count(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME) &&
+       available.count(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME));
+  bool synchronization2Available =
+      apiVersion_ >= VK_API_VERSION_1_3 ||
+      (apiVersion_ >= VK_API_VERSION_1_1 &&
+       available.count(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME));
+
+  // feature structs may only be chained for extensions the device supports
+  auto chain = [](void *&head, auto &features) {
+    features.pNext = head;
+    head = &features;
+  };
+
+  if (presentWaitAvailable || dynamicRenderingAvailable || synchronization2Available) {
+    void *supportedChain = nullptr;
+    if (presentWaitAvailable) {
+      chain(supportedChain, presentIdFeatures);
+      chain(supportedChain, presentWaitFeatures);
+    }
+    if (dynamicRenderingAvailable) {
+      chain(supportedChain, dynamicRenderingFeatures);
+    }
+    if (synchronization2Available) {
+      chain(supportedChain, synchronization2Features);
+    }
+
+    VkPhysicalDeviceFeatures2 supported = {};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supported.pNext = supportedChain;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+    presentWaitAvailable = presentWaitAvailable && presentIdFeatures.presentId &&
+                           presentWaitFeatures.presentWait;
+    dynamicRenderingAvailable =
+        dynamicRenderingAvailable && dynamicRenderingFeatures.dynamicRendering;
+    synchronization2Available =
+        synchronization2Available && synchronization2Features.synchronization2;
+  }
+
+  auto disableExtensions = [&extensions](std::initializer_list<const char *> names) {
+    extensions.erase(
+        std::remove_if(
+            extensions.begin(),
+            extensions.end(),
+            [names](const char *extension) {
+              for (const char *name : names) {
+                if (strcmp(extension, name) == 0) return true;
+              }
+              return false;
+            }),
+        extensions.end());
+  };
+
+  void *enabledChain = nullptr;
+  if (presentWaitAvailable) {
+    chain(enabledChain, presentIdFeatures);
+    chain(enabledChain, presentWaitFeatures);
+  } else {
+    disableExtensions({VK_KHR_PRESENT_ID_EXTENSION_NAME, VK_KHR_PRESENT_WAIT_EXTENSION_NAME});
+  }
+  if (dynamicRenderingAvailable) {
+    chain(enabledChain, dynamicRenderingFeatures);
+  } else {
+    disableExtensions(
+        {VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+         VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+         VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME});
+  }
+  if (synchronization2Available) {
+    chain(enabledChain, synchronization2Features);
+  } else {
+    disableExtensions({VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME});
+  }
+  // queried through vkGetPhysicalDeviceMemoryProperties2
+  if (apiVersion_ < VK_API_VERSION_1_1) {
+    disableExtensions({VK_EXT_MEMORY_BUDGET_EXTENSION_NAME});
+  }
+  if (apiVersion_ < VK_API_VERSION_1_1 ||
+      !available.count(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) ||
+      !hasCalibrateableTraceClock()) {
+    disableExtensions({VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME});
+  }
+  deviceFeatures.pNext = enabledChain;
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -158,9 +325,14 @@ void LveDevice::createLogicalDevice() {
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-  createInfo.pEnabledFeatures = &deviceFeatures;
-  createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  if (apiVersion_ >= VK_API_VERSION_1_1) {
+    createInfo.pNext = &deviceFeatures;
+    createInfo.pEnabledFeatures = nullptr;
+  } else {
+    createInfo.pEnabledFeatures = &deviceFeatures.features;
+  }
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+  createInfo.ppEnabledExtensionNames = extensions.data();
 
   // might not really be necessary anymore because device specific validation layers
   // have been deprecated
@@ -177,6 +349,36 @@ void LveDevice::createLogicalDevice() {
 
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+  for (const char *extension : extensions) {
+    enabledDeviceExtensions.insert(extension);
+  }
+
+  if (isExtensionEnabled(VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+    vkWaitForPresentKHR_ = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+        vkGetDeviceProcAddr(device_, "vkWaitForPresentKHR"));
+  }
+
+  if (dynamicRenderingAvailable) {
+    bool core = apiVersion_ >= VK_API_VERSION_1_3;
+    vkCmdBeginRenderingKHR_ = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(
+        device_, core ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR"));
+    vkCmdEndRenderingKHR_ = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(
+        device_, core ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR"));
+  }
+
+  if (synchronization2Available) {
+    vkCmdPipelineBarrier2KHR_ = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(
+        vkGetDeviceProcAddr(
+            device_,
+            apiVersion_ >= VK_API_VERSION_1_3 ? "vkCmdPipelineBarrier2"
+                                              : "vkCmdPipelineBarrier2KHR"));
+  }
+
+  if (isExtensionEnabled(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME)) {
+    vkGetCalibratedTimestampsEXT_ = reinterpret_cast<PFN_vkGetCalibratedTimestampsEXT>(
+        vkGetDeviceProcAddr(device_, "vkGetCalibratedTimestampsEXT"));
+  }
 }
 
 void LveDevice::createCommandPool() {
@@ -193,15 +395,25 @@ void LveDevice::createCommandPool() {
   }
 }
 
-void LveDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+void LveDevice::createPipelineCache() {
+  VkPipelineCacheCreateInfo cacheInfo = {};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+  if (vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline cache!");
+  }
+}
+
+void LveDevice::createSurface() { window->createWindowSurface(instance, &surface_); }
 
 bool LveDevice::isDeviceSuitable(VkPhysicalDevice device) {
   QueueFamilyIndices indices = findQueueFamilies(device);
 
   bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  // nothing is presented without a window
+  bool swapChainAdequate = window == nullptr;
+  if (extensionsSupported && window) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
   }
@@ -261,11 +473,13 @@ bool LveDevice::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> LveDevice::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions;
+  if (window) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -308,7 +522,8 @@ bool LveDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
       &extensionCount,
       availableExtensions.data());
 
-  std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+  auto required = getRequiredDeviceExtensions();
+  std::set<std::string> requiredExtensions(required.begin(), required.end());
 
   for (const auto &extension : availableExtensions) {
     requiredExtensions.erase(extension.extensionName);
@@ -317,6 +532,36 @@ bool LveDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+std::vector<const char *> LveDevice::getRequiredDeviceExtensions() {
+  if (window == nullptr) {
+    return {};
+  }
+  return deviceExtensions;
+}
+
+// Whether the device can sample its timestamps together with the clock LveTrace::now() reads,
+// std::chrono::steady_clock is CLOCK_MONOTONIC on Linux
+bool LveDevice::hasCalibrateableTraceClock() {
+  auto getTimeDomains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(
+      vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"));
+  if (getTimeDomains == nullptr) {
+    return false;
+  }
+
+  uint32_t domainCount = 0;
+  getTimeDomains(physicalDevice, &domainCount, nullptr);
+  std::vector<VkTimeDomainEXT> domains(domainCount);
+  getTimeDomains(physicalDevice, &domainCount, domains.data());
+
+  bool device = false;
+  bool monotonic = false;
+  for (VkTimeDomainEXT domain : domains) {
+    device = device || domain == VK_TIME_DOMAIN_DEVICE_EXT;
+    monotonic = monotonic || domain == VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+  }
+  return device && monotonic;
+}
+
 QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
   QueueFamilyIndices indices;
 
@@ -332,8 +577,11 @@ QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
       indices.graphicsFamily = i;
       indices.graphicsFamilyHasValue = true;
     }
-    VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    // headless, the graphics queue stands in for the present queue
+    VkBool32 presentSupport = window == nullptr;
+    if (window) {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    }
     if (queueFamily.queueCount > 0 && presentSupport) {
       indices.presentFamily = i;
       indices.presentFamilyHasValue = true;
@@ -377,30 +625,79 @@ SwapChainSupportDetails LveDevice::querySwapChainSupport(VkPhysicalDevice device
 VkFormat LveDevice::findSupportedFormat(
     const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
   for (VkFormat format : candidates) {
-    VkFormatProperties props;
-    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
-
-    if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features) {
-      return format;
-    } else if (
-        tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features) {
+    if (isFormatSupported(format, tiling, features)) {
       return format;
     }
   }
   throw std::runtime_error("failed to find supported format!");
 }
 
+bool LveDevice::isFormatSupported(
+    VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features) {
+  VkFormatProperties props;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+
+  if (tiling == VK_IMAGE_TILING_LINEAR) {
+    return (props.linearTilingFeatures & features) == features;
+  }
+  return (props.optimalTilingFeatures & features) == features;
+}
+
+VkSampleCountFlagBits LveDevice::getMaxUsableSampleCount() {
+  VkSampleCountFlags counts = properties.limits.framebufferColorSampleCounts &
+                              properties.limits.framebufferDepthSampleCounts;
+  for (VkSampleCountFlagBits samples :
+       {VK_SAMPLE_COUNT_64_BIT,
+        VK_SAMPLE_COUNT_32_BIT,
+        VK_SAMPLE_COUNT_16_BIT,
+        VK_SAMPLE_COUNT_8_BIT,
+        VK_SAMPLE_COUNT_4_BIT,
+        VK_SAMPLE_COUNT_2_BIT}) {
+    if (counts & samples) {
+      return samples;
+    }
+  }
+
+  return VK_SAMPLE_COUNT_1_BIT;
+}
+
 uint32_t LveDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+  uint32_t memoryTypeIndex;
+  if (tryFindMemoryType(typeFilter, properties, memoryTypeIndex)) {
+    return memoryTypeIndex;
+  }
+
+  throw std::runtime_error("failed to find suitable memory type!");
+}
+
+bool LveDevice::tryFindMemoryType(
+    uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t &memoryTypeIndex) {
   VkPhysicalDeviceMemoryProperties memProperties;
   vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
   for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
     if ((typeFilter & (1 << i)) &&
         (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-      return i;
+      memoryTypeIndex = i;
+      return true;
     }
   }
 
-  throw std::runtime_error("failed to find suitable memory type!");
+  return false;
+}
+
+VkResult LveDevice::allocateMemory(
+    const VkMemoryAllocateInfo &allocInfo, VkDeviceMemory &memory) {
+  VkResult result = vkAllocateMemory(device_, &allocInfo, nullptr, &memory);
+  if (result == VK_SUCCESS) {
+    memoryBudget_->allocated(memory, allocInfo.memoryTypeIndex, allocInfo.allocationSize);
+  }
+  return result;
+}
+
+void LveDevice::freeMemory(VkDeviceMemory memory) {
+  if (memory == VK_NULL_HANDLE) return;
+  memoryBudget_->freed(memory);
+  vkFreeMemory(device_, memory, nullptr);
 }
 
 void LveDevice::createBuffer(
@@ -409,6 +706,16 @@ void LveDevice::createBuffer(
     VkMemoryPropertyFlags properties,
     VkBuffer &buffer,
     VkDeviceMemory &bufferMemory) {
+  createBuffer(size, usage, properties, properties, buffer, bufferMemory);
+}
+
+bool LveDevice::createBuffer(
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags preferredProperties,
+    VkMemoryPropertyFlags properties,
+    VkBuffer &buffer,
+    VkDeviceMemory &bufferMemory) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
@@ -425,13 +732,25 @@ void LveDevice::createBuffer(
   VkMemoryAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
   allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+  bool usedPreferred = tryFindMemoryType(
+      memRequirements.memoryTypeBits,
+      preferredProperties,
+      allocInfo.memoryTypeIndex);
+  if (usedPreferred && !memoryBudget_->fits(allocInfo.memoryTypeIndex, memRequirements.size)) {
+    // the preferred heap is over budget, fall back before an allocation there fails
+    usedPreferred = false;
+  }
+  if (!usedPreferred) {
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+  }
+
+  if (allocateMemory(allocInfo, bufferMemory) != VK_SUCCESS) {
     throw std::runtime_error("failed to allocate vertex buffer memory!");
   }
 
   vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+  return usedPreferred;
 }
 
 VkCommandBuffer LveDevice::beginSingleTimeCommands() {
@@ -449,10 +768,13 @@ VkCommandBuffer LveDevice::beginSingleTimeCommands() {
   beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
   vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  singleTimeTimer_->begin(commandBuffer, 0);
   return commandBuffer;
 }
 
 void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
+  LVE_TRACE_SCOPE("endSingleTimeCommands");
+  singleTimeTimer_->end(commandBuffer, 0);
   vkEndCommandBuffer(commandBuffer);
 
   VkSubmitInfo submitInfo{};
@@ -462,6 +784,7 @@ void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
 
   vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
   vkQueueWaitIdle(graphicsQueue_);
+  singleTimeTimer_->collect(0, "single time commands", "graphics queue");
 
   vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 }
@@ -476,6 +799,7 @@ void LveDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize
   vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
   endSingleTimeCommands(commandBuffer);
+  frameStats_.uploaded(size);
 }
 
 void LveDevice::copyBufferToImage(
@@ -510,6 +834,15 @@ void LveDevice::createImageWithInfo(
     VkMemoryPropertyFlags properties,
     VkImage &image,
     VkDeviceMemory &imageMemory) {
+  createImageWithInfo(imageInfo, properties, properties, image, imageMemory);
+}
+
+bool LveDevice::createImageWithInfo(
+    const VkImageCreateInfo &imageInfo,
+    VkMemoryPropertyFlags preferredProperties,
+    VkMemoryPropertyFlags properties,
+    VkImage &image,
+    VkDeviceMemory &imageMemory) {
   if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
   }
@@ -520,15 +853,125 @@ void LveDevice::createImageWithInfo(
   VkMemoryAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
   allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+  bool usedPreferred = tryFindMemoryType(
+      memRequirements.memoryTypeBits,
+      preferredProperties,
+      allocInfo.memoryTypeIndex);
+  if (usedPreferred && !memoryBudget_->fits(allocInfo.memoryTypeIndex, memRequirements.size)) {
+    // the preferred heap is over budget, fall back before an allocation there fails
+    usedPreferred = false;
+  }
+  if (!usedPreferred) {
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+  }
+
+  if (allocateMemory(allocInfo, imageMemory) != VK_SUCCESS) {
     throw std::runtime_error("failed to allocate image memory!");
   }
 
   if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
     throw std::runtime_error("failed to bind image memory!");
   }
+
+  return usedPreferred;
+}
+
+uint64_t LveDevice::timestampToTraceTime(uint64_t timestamp) {
+  constexpr uint64_t RECALIBRATION_INTERVAL = 1000000000;  // 1s in nanoseconds
+
+  // the two clocks drift apart, recalibrate now and then when that is cheap
+  if (!timestampsCalibrated ||
+      (vkGetCalibratedTimestampsEXT_ != nullptr &&
+       LveTrace::now() - calibrationTraceTime > RECALIBRATION_INTERVAL)) {
+    calibrateTimestamps();
+  }
+
+  int64_t ticks = static_cast<int64_t>(timestamp - calibrationTimestamp);
+  double nanoseconds = static_cast<double>(ticks) * properties.limits.timestampPeriod;
+  return calibrationTraceTime + static_cast<int64_t>(nanoseconds);
+}
+
+void LveDevice::calibrateTimestamps() {
+  if (vkGetCalibratedTimestampsEXT_ != nullptr) {
+    VkCalibratedTimestampInfoEXT timestampInfos[2] = {};
+    timestampInfos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    timestampInfos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    timestampInfos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    timestampInfos[1].timeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+
+    uint64_t timestamps[2];
+    uint64_t maxDeviation;
+    if (vkGetCalibratedTimestampsEXT_(device_, 2, timestampInfos, timestamps, &maxDeviation) ==
+        VK_SUCCESS) {
+      calibrationTimestamp = timestamps[0];
+      calibrationTraceTime = timestamps[1];
+      timestampsCalibrated = true;
+      return;
+    }
+  }
+
+  // Without the extension: a timestamp written at the end of an empty submission, paired with
+  // the time the queue was seen idle. GPU events show up late by the wake up latency of that
+  // wait. Not through beginSingleTimeCommands, which would time itself.
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = 1;
+  VkQueryPool queryPool;
+  if (vkCreateQueryPool(device_, &poolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create timestamp query pool!");
+  }
+
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = commandPool;
+  allocInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer;
+  vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer);
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  vkCmdResetQueryPool(commandBuffer, queryPool, 0, 1);
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 0);
+  vkEndCommandBuffer(commandBuffer);
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
+  vkQueueWaitIdle(graphicsQueue_);
+  uint64_t traceTime = LveTrace::now();
+
+  uint64_t timestamp = 0;
+  vkGetQueryPoolResults(
+      device_,
+      queryPool,
+      0,
+      1,
+      sizeof(timestamp),
+      &timestamp,
+      sizeof(timestamp),
+      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+  vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+  vkDestroyQueryPool(device_, queryPool, nullptr);
+
+  calibrationTimestamp = timestamp;
+  calibrationTraceTime = traceTime;
+  timestampsCalibrated = true;
+}
+
+VkResult LveDevice::waitForPresent(
+    VkSwapchainKHR swapChain, uint64_t presentId, uint64_t timeout) {
+  if (vkWaitForPresentKHR_ == nullptr) {
+    return VK_ERROR_EXTENSION_NOT_PRESENT;
+  }
+  return vkWaitForPresentKHR_(device_, swapChain, presentId, timeout);
 }
 
 }  // namespace lve
@@ -1,11 +1,19 @@
 #pragma once
 
 #include "lve_window.hpp"
+#include "lve_deletion_queue.hpp"
+#include "lve_frame_stats.hpp"
+#include "lve_memory_budget.hpp"
 
+#include <memory>
+#include <string>
+#include <unordered_set>
 #include <vector>
 
 namespace lve {
 
+class LveGpuTimer;
+
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
   std::vector<VkSurfaceFormatKHR> formats;
@@ -29,6 +37,8 @@ class LveDevice {
 #endif
 
   LveDevice(LveWindow &window);
+  // Headless, for offscreen rendering: no surface, no swap chain and nothing to present to
+  LveDevice();
   ~LveDevice();
 
   // Not copyable or movable
@@ -40,14 +50,36 @@ class LveDevice {
   VkCommandPool getCommandPool() { return commandPool; }
   VkDevice device() { return device_; }
   VkSurfaceKHR surface() { return surface_; }
+  bool isHeadless() { return window == nullptr; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  uint32_t apiVersion() { return apiVersion_; }
+  LveDeletionQueue &deletionQueue() { return *deletionQueue_; }
+  // Usage per heap, fed by allocateMemory and the deletion queue freeing memory
+  LveMemoryBudget &memoryBudget() { return *memoryBudget_; }
+  // Workload of the frame being recorded, counted by the engine's helpers
+  LveFrameStats &frameStats() { return frameStats_; }
+  // Shared by every pipeline, safe to use from several threads at once
+  VkPipelineCache pipelineCache() { return pipelineCache_; }
+  bool isExtensionEnabled(const char *extensionName) {
+    return enabledDeviceExtensions.count(extensionName) > 0;
+  }
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+  // Highest sample count usable for both color and depth framebuffer attachments
+  VkSampleCountFlagBits getMaxUsableSampleCount();
+  bool tryFindMemoryType(
+      uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t &memoryTypeIndex);
   QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
   VkFormat findSupportedFormat(
       const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+  bool isFormatSupported(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features);
+
+  // vkAllocateMemory that is accounted in memoryBudget(). Free the memory through
+  // deletionQueue().freeMemory, or freeMemory once the GPU no longer uses it.
+  VkResult allocateMemory(const VkMemoryAllocateInfo &allocInfo, VkDeviceMemory &memory);
+  void freeMemory(VkDeviceMemory memory);
 
   // Buffer Helper Functions
   void createBuffer(
@@ -56,6 +88,15 @@ class LveDevice {
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
       VkDeviceMemory &bufferMemory);
+  // Uses preferredProperties if the buffer can live in such memory and its heap has budget left,
+  // otherwise properties. Returns whether the preferred properties were used.
+  bool createBuffer(
+      VkDeviceSize size,
+      VkBufferUsageFlags usage,
+      VkMemoryPropertyFlags preferredProperties,
+      VkMemoryPropertyFlags properties,
+      VkBuffer &buffer,
+      VkDeviceMemory &bufferMemory);
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
   void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -67,40 +108,115 @@ class LveDevice {
       VkMemoryPropertyFlags properties,
       VkImage &image,
       VkDeviceMemory &imageMemory);
+  // Uses preferredProperties if the image can live in such memory and its heap has budget left,
+  // otherwise properties. Returns whether the preferred properties were used.
+  bool createImageWithInfo(
+      const VkImageCreateInfo &imageInfo,
+      VkMemoryPropertyFlags preferredProperties,
+      VkMemoryPropertyFlags properties,
+      VkImage &image,
+      VkDeviceMemory &imageMemory);
+
+  // Blocks until the present with the given id has been displayed (VK_KHR_present_wait)
+  VkResult waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId, uint64_t timeout);
+  bool presentWaitEnabled() { return vkWaitForPresentKHR_ != nullptr; }
+
+  // Render pass-less rendering, Vulkan 1.3 core or VK_KHR_dynamic_rendering
+  bool dynamicRenderingEnabled() {
+    return vkCmdBeginRenderingKHR_ != nullptr && vkCmdEndRenderingKHR_ != nullptr;
+  }
+  void cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfoKHR &renderingInfo) {
+    vkCmdBeginRenderingKHR_(commandBuffer, &renderingInfo);
+  }
+  void cmdEndRendering(VkCommandBuffer commandBuffer) { vkCmdEndRenderingKHR_(commandBuffer); }
+
+  // Vulkan 1.3 core or VK_KHR_synchronization2
+  bool synchronization2Enabled() { return vkCmdPipelineBarrier2KHR_ != nullptr; }
+  void cmdPipelineBarrier2(
+      VkCommandBuffer commandBuffer, const VkDependencyInfoKHR &dependencyInfo) {
+    vkCmdPipelineBarrier2KHR_(commandBuffer, &dependencyInfo);
+  }
+
+  // Converts a timestamp query result to LveTrace::now() time. Calibrated with
+  // VK_EXT_calibrated_timestamps when the device can sample the same clock, otherwise once
+  // against a timestamp written by an empty submission.
+  uint64_t timestampToTraceTime(uint64_t timestamp);
+
+  // Several draws per vkCmdDraw*Indirect call, otherwise issue one call per draw
+  bool multiDrawIndirectEnabled() { return multiDrawIndirect_; }
+  // VK_QUERY_TYPE_PIPELINE_STATISTICS queries, see LvePipelineStatistics
+  bool pipelineStatisticsQueryEnabled() { return pipelineStatisticsQuery_; }
 
   VkPhysicalDeviceProperties properties;
 
  private:
+  void init();
   void createInstance();
   void setupDebugMessenger();
   void createSurface();
   void pickPhysicalDevice();
   void createLogicalDevice();
   void createCommandPool();
+  void createPipelineCache();
+  void calibrateTimestamps();
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
   std::vector<const char *> getRequiredExtensions();
+  std::vector<const char *> getRequiredDeviceExtensions();
   bool checkValidationLayerSupport();
   QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
   void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
+  bool hasCalibrateableTraceClock();
 
   VkInstance instance;
   VkDebugUtilsMessengerEXT debugMessenger;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-  LveWindow &window;
+  LveWindow *window = nullptr;
   VkCommandPool commandPool;
+  VkPipelineCache pipelineCache_;
 
   VkDevice device_;
-  VkSurfaceKHR surface_;
+  VkSurfaceKHR surface_ = VK_NULL_HANDLE;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  uint32_t apiVersion_ = VK_API_VERSION_1_0;
+  bool multiDrawIndirect_ = false;
+  bool pipelineStatisticsQuery_ = false;
+  LveFrameStats frameStats_;
+  std::unique_ptr<LveMemoryBudget> memoryBudget_;
+  std::unique_ptr<LveDeletionQueue> deletionQueue_;
+  // times every single time command submission while tracing
+  std::unique_ptr<LveGpuTimer> singleTimeTimer_;
+
+  // a timestamp and the LveTrace::now() time it was taken at
+  bool timestampsCalibrated = false;
+  uint64_t calibrationTimestamp = 0;
+  uint64_t calibrationTraceTime = 0;
+
+  PFN_vkWaitForPresentKHR vkWaitForPresentKHR_ = nullptr;
+  PFN_vkCmdBeginRenderingKHR vkCmdBeginRenderingKHR_ = nullptr;
+  PFN_vkCmdEndRenderingKHR vkCmdEndRenderingKHR_ = nullptr;
+  PFN_vkCmdPipelineBarrier2KHR vkCmdPipelineBarrier2KHR_ = nullptr;
+  PFN_vkGetCalibratedTimestampsEXT vkGetCalibratedTimestampsEXT_ = nullptr;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
+  // only required with a window
   const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  // enabled only when the physical device supports them
+  const std::vector<const char *> optionalDeviceExtensions = {
+      VK_KHR_PRESENT_ID_EXTENSION_NAME,
+      VK_KHR_PRESENT_WAIT_EXTENSION_NAME,
+      VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+      VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+      VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,
+      VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
+      VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+      VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME};
+  std::unordered_set<std::string> enabledDeviceExtensions;
 };
 
 }  // namespace lve
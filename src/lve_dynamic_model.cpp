@@ -0,0 +1,111 @@
+#include "lve_dynamic_model.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace lve {
+
+LveDynamicModel::LveDynamicModel(LveDevice& device, uint32_t maxVertexCount, uint32_t frameCount)
+  : lveDevice(device),
+    maxVertexCount(maxVertexCount),
+    vertices(maxVertexCount),
+    frames(frameCount) {
+  assert(maxVertexCount > 0 && frameCount > 0 && "Dynamic model needs vertices and frames");
+  createVertexBuffer();
+}
+
+LveDynamicModel::~LveDynamicModel() {
+  vkUnmapMemory(lveDevice.device(), vertexBufferMemory);
+  lveDevice.deletionQueue().destroyBuffer(vertexBuffer);
+  lveDevice.deletionQueue().freeMemory(vertexBufferMemory);
+}
+
+void LveDynamicModel::createVertexBuffer() {
+  VkDeviceSize atomSize = lveDevice.properties.limits.nonCoherentAtomSize;
+  frameStride = (sizeof(Vertex) * maxVertexCount + atomSize - 1) / atomSize * atomSize;
+
+  hostCoherent = lveDevice.createBuffer(
+    frameStride * frames.size(),
+    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+    vertexBuffer,
+    vertexBufferMemory
+  );
+
+  void* data;
+  if (vkMapMemory(lveDevice.device(), vertexBufferMemory, 0, VK_WHOLE_SIZE, 0, &data) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to map dynamic vertex buffer memory!");
+  }
+  mapped = static_cast<char*>(data);
+}
+
+void LveDynamicModel::update(uint32_t firstVertex, uint32_t count, const FillFunction& fill) {
+  assert(firstVertex + count <= maxVertexCount && "Dynamic model update out of range");
+  if (count == 0) return;
+
+  fill(vertices.data() + firstVertex);
+  for (auto& frame : frames) {
+    if (frame.dirtyBegin >= frame.dirtyEnd) {
+      frame.dirtyBegin = firstVertex;
+      frame.dirtyEnd = firstVertex + count;
+    } else {
+      frame.dirtyBegin = std::min(frame.dirtyBegin, firstVertex);
+      frame.dirtyEnd = std::max(frame.dirtyEnd, firstVertex + count);
+    }
+  }
+}
+
+void LveDynamicModel::setVertexCount(uint32_t count) {
+  assert(count <= maxVertexCount && "Dynamic model vertex count exceeds its capacity");
+  vertexCount = count;
+}
+
+void LveDynamicModel::upload(uint32_t frameIndex) {
+  auto& frame = frames[frameIndex];
+  frame.vertexCount = vertexCount;
+  if (frame.dirtyBegin >= frame.dirtyEnd) return;
+
+  VkDeviceSize offset = frameStride * frameIndex + sizeof(Vertex) * frame.dirtyBegin;
+  VkDeviceSize size = sizeof(Vertex) * (frame.dirtyEnd - frame.dirtyBegin);
+  memcpy(mapped + offset, vertices.data() + frame.dirtyBegin, static_cast<size_t>(size));
+  if (!hostCoherent) {
+    flush(offset, size);
+  }
+  lveDevice.frameStats().uploaded(size);
+
+  frame.dirtyBegin = frame.dirtyEnd = 0;
+}
+
+void LveDynamicModel::flush(VkDeviceSize offset, VkDeviceSize size) {
+  // widened to whole atoms, frameStride keeps the end inside this frame's copy
+  VkDeviceSize atomSize = lveDevice.properties.limits.nonCoherentAtomSize;
+  VkDeviceSize begin = offset / atomSize * atomSize;
+  VkDeviceSize end = (offset + size + atomSize - 1) / atomSize * atomSize;
+
+  VkMappedMemoryRange range{};
+  range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+  range.memory = vertexBufferMemory;
+  range.offset = begin;
+  range.size = end - begin;
+  vkFlushMappedMemoryRanges(lveDevice.device(), 1, &range);
+}
+
+void LveDynamicModel::bind(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+  VkBuffer buffers[] = {vertexBuffer};
+  VkDeviceSize offsets[] = {frameStride * frameIndex};
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+}
+
+void LveDynamicModel::draw(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+  uint32_t count = frames[frameIndex].vertexCount;
+  if (count == 0) return;
+  vkCmdDraw(commandBuffer, count, 1, 0, 0);
+  lveDevice.frameStats().draw(1, count / 3);
+}
+
+} // namespace lve
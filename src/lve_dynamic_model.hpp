@@ -0,0 +1,72 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_model.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <vector>
+
+namespace lve {
+// Vertex buffer for geometry the CPU rewrites every frame (debug lines, deformation,
+// visualisation). One buffer holds a copy per frame in flight and stays mapped, so writing the
+// next frame never touches vertices the GPU may still be reading and nothing is allocated after
+// construction.
+//
+// update() writes into a host side copy and marks the range dirty for every frame copy.
+// upload() brings one frame's copy up to date with only what changed since its last upload and
+// flushes that range when the memory isn't host coherent, so a partial update costs its own
+// size per frame, not the whole model.
+class LveDynamicModel {
+  public:
+    using Vertex = LveModel::Vertex;
+    using FillFunction = LveModel::FillFunction;
+
+    LveDynamicModel(
+      LveDevice& device,
+      uint32_t maxVertexCount,
+      uint32_t frameCount = LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+    ~LveDynamicModel();
+
+    LveDynamicModel(const LveDynamicModel&) = delete;
+    LveDynamicModel &operator=(const LveDynamicModel&) = delete;
+
+    // fill writes vertices [firstVertex, firstVertex + count), the rest keep their contents
+    void update(uint32_t firstVertex, uint32_t count, const FillFunction& fill);
+    // Vertices drawn from the next upload on, at most maxVertexCount
+    void setVertexCount(uint32_t count);
+
+    // Call once the GPU is done with frameIndex's previous submission, before recording it
+    void upload(uint32_t frameIndex);
+    void bind(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    void draw(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+    uint32_t getVertexCount() const { return vertexCount; }
+    uint32_t getMaxVertexCount() const { return maxVertexCount; }
+    bool isHostCoherent() const { return hostCoherent; }
+
+  private:
+    struct Frame {
+      // dirty vertex range not yet uploaded to this frame's copy, empty when begin >= end
+      uint32_t dirtyBegin = 0;
+      uint32_t dirtyEnd = 0;
+      uint32_t vertexCount = 0;
+    };
+
+    LveDevice& lveDevice;
+    VkBuffer vertexBuffer;
+    VkDeviceMemory vertexBufferMemory;
+    char* mapped;
+    // distance between frame copies, a multiple of nonCoherentAtomSize so flushes stay aligned
+    VkDeviceSize frameStride;
+    bool hostCoherent;
+
+    uint32_t maxVertexCount;
+    uint32_t vertexCount = 0;
+    std::vector<Vertex> vertices;
+    std::vector<Frame> frames;
+
+    void createVertexBuffer();
+    void flush(VkDeviceSize offset, VkDeviceSize size);
+};
+}  // namespace lve
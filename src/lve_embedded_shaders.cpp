@@ -0,0 +1,18 @@
+#include "lve_embedded_shaders.hpp"
+
+// std
+#include <cstring>
+
+namespace lve {
+
+  const LveEmbeddedShader *findEmbeddedShader(const std::string &filepath) {
+    size_t separator = filepath.find_last_of("/\\");
+    const char *name = filepath.c_str() + (separator == std::string::npos ? 0 : separator + 1);
+
+    for (const LveEmbeddedShader *shader = embeddedShaders; shader->name; shader++) {
+      if (std::strcmp(shader->name, name) == 0)
+        return shader;
+    }
+    return nullptr;
+  }
+}
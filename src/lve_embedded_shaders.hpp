@@ -0,0 +1,21 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace lve {
+  // SPIR-V compiled into the executable by cmake/embed_shaders.cmake
+  struct LveEmbeddedShader {
+    const char *name;
+    const uint32_t *code;
+    size_t size;  // in bytes
+  };
+
+  // Table generated at build time, terminated by an entry with a null name
+  extern const LveEmbeddedShader embeddedShaders[];
+
+  // Looks a shader up by file name, any directory in filepath is ignored. nullptr if not embedded
+  const LveEmbeddedShader *findEmbeddedShader(const std::string &filepath);
+}
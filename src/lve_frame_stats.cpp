@@ -0,0 +1,68 @@
+#include "lve_frame_stats.hpp"
+
+// std
+#include <iomanip>
+#include <iostream>
+
+namespace lve {
+
+LveFrameStats::Counters &LveFrameStats::Counters::operator+=(const Counters &other) {
+  drawCalls += other.drawCalls;
+  instances += other.instances;
+  triangles += other.triangles;
+  pipelineBinds += other.pipelineBinds;
+  bytesUploaded += other.bytesUploaded;
+  descriptorUpdates += other.descriptorUpdates;
+  return *this;
+}
+
+void LveFrameStats::endFrame() {
+  Counters frame;
+  frame.drawCalls = current.drawCalls.exchange(0, std::memory_order_relaxed);
+  frame.instances = current.instances.exchange(0, std::memory_order_relaxed);
+  frame.triangles = current.triangles.exchange(0, std::memory_order_relaxed);
+  frame.pipelineBinds = current.pipelineBinds.exchange(0, std::memory_order_relaxed);
+  frame.bytesUploaded = current.bytesUploaded.exchange(0, std::memory_order_relaxed);
+  frame.descriptorUpdates = current.descriptorUpdates.exchange(0, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock{mutex};
+  last = frame;
+  total += frame;
+  frames++;
+}
+
+LveFrameStats::Counters LveFrameStats::lastFrame() {
+  std::lock_guard<std::mutex> lock{mutex};
+  return last;
+}
+
+LveFrameStats::Counters LveFrameStats::totals() {
+  std::lock_guard<std::mutex> lock{mutex};
+  return total;
+}
+
+uint64_t LveFrameStats::frameCount() {
+  std::lock_guard<std::mutex> lock{mutex};
+  return frames;
+}
+
+void LveFrameStats::printStats() {
+  Counters sum = totals();
+  uint64_t count = frameCount();
+  if (count == 0) return;
+
+  auto perFrame = [count](uint64_t value) { return static_cast<double>(value) / count; };
+  std::ios_base::fmtflags flags = std::cout.flags();
+  std::streamsize precision = std::cout.precision();
+  std::cout << "Frame stats over " << count << " frames: " << std::fixed << std::setprecision(1)
+            << perFrame(sum.drawCalls) << " draw calls, " << perFrame(sum.instances)
+            << " instances, " << perFrame(sum.triangles) << " triangles, "
+            << perFrame(sum.pipelineBinds) << " pipeline binds, "
+            << perFrame(sum.descriptorUpdates) << " descriptor updates and "
+            << perFrame(sum.bytesUploaded) / 1024.0 << " KiB uploaded per frame ("
+            << sum.bytesUploaded / 1024.0 / 1024.0 << " MiB in total)" << std::endl;
+  std::cout.flags(flags);
+  std::cout.precision(precision);
+}
+
+}  // namespace lve
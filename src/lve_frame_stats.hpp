@@ -0,0 +1,77 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace lve {
+
+// What each frame asked of the GPU, to put frame times next to the work behind them. The engine's
+// draw, bind, upload and descriptor helpers count into the frame being recorded and endFrame()
+// closes it. Safe to count from several threads, uploads and descriptor writes made between
+// frames, e.g. while loading, count towards the next one.
+class LveFrameStats {
+ public:
+  struct Counters {
+    // draw commands recorded, a multi draw indirect call counts once
+    uint64_t drawCalls = 0;
+    // instances and triangles of direct draws, indirect ones are only known on the GPU
+    uint64_t instances = 0;
+    uint64_t triangles = 0;
+    uint64_t pipelineBinds = 0;
+    // copies through LveDevice::copyBuffer and host writes into buffers the GPU reads
+    uint64_t bytesUploaded = 0;
+    // descriptor writes, each covering one binding
+    uint64_t descriptorUpdates = 0;
+
+    Counters &operator+=(const Counters &other);
+  };
+
+  LveFrameStats() = default;
+
+  LveFrameStats(const LveFrameStats &) = delete;
+  LveFrameStats &operator=(const LveFrameStats &) = delete;
+
+  void draw(uint32_t instanceCount, uint64_t triangleCount) {
+    add(current.drawCalls, 1);
+    add(current.instances, instanceCount);
+    add(current.triangles, triangleCount * instanceCount);
+  }
+  void drawIndirect() { add(current.drawCalls, 1); }
+  void pipelineBound() { add(current.pipelineBinds, 1); }
+  void uploaded(uint64_t bytes) { add(current.bytesUploaded, bytes); }
+  void descriptorsUpdated(uint32_t count) { add(current.descriptorUpdates, count); }
+
+  // Once the frame's command buffers are recorded
+  void endFrame();
+
+  Counters lastFrame();
+  Counters totals();
+  uint64_t frameCount();
+  // Per frame averages over every frame ended so far
+  void printStats();
+
+ private:
+  struct AtomicCounters {
+    std::atomic<uint64_t> drawCalls{0};
+    std::atomic<uint64_t> instances{0};
+    std::atomic<uint64_t> triangles{0};
+    std::atomic<uint64_t> pipelineBinds{0};
+    std::atomic<uint64_t> bytesUploaded{0};
+    std::atomic<uint64_t> descriptorUpdates{0};
+  };
+
+  static void add(std::atomic<uint64_t> &counter, uint64_t value) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  AtomicCounters current;
+
+  std::mutex mutex;
+  Counters last;
+  Counters total;
+  uint64_t frames = 0;
+};
+
+}  // namespace lve
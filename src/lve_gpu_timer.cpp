@@ -0,0 +1,69 @@
+#include "lve_gpu_timer.hpp"
+
+#include "lve_trace.hpp"
+
+// std
+#include <stdexcept>
+
+namespace lve {
+
+LveGpuTimer::LveGpuTimer(LveDevice &device, uint32_t slotCount)
+    : lveDevice{device}, slots(slotCount, SlotState::Idle) {
+  if (device.properties.limits.timestampComputeAndGraphics != VK_TRUE) return;
+
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = 2 * slotCount;
+  if (vkCreateQueryPool(device.device(), &poolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create timestamp query pool!");
+  }
+}
+
+LveGpuTimer::~LveGpuTimer() {
+  if (queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(lveDevice.device(), queryPool, nullptr);
+  }
+}
+
+void LveGpuTimer::begin(VkCommandBuffer commandBuffer, uint32_t slot) {
+  slots[slot] = SlotState::Idle;
+  if (queryPool == VK_NULL_HANDLE || !LveTrace::enabled()) return;
+
+  vkCmdResetQueryPool(commandBuffer, queryPool, 2 * slot, 2);
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 2 * slot);
+  slots[slot] = SlotState::Begun;
+}
+
+void LveGpuTimer::end(VkCommandBuffer commandBuffer, uint32_t slot) {
+  if (slots[slot] != SlotState::Begun) return;
+
+  vkCmdWriteTimestamp(
+      commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 2 * slot + 1);
+  slots[slot] = SlotState::Ended;
+}
+
+void LveGpuTimer::collect(uint32_t slot, const char *name, const char *track) {
+  if (slots[slot] != SlotState::Ended) return;
+  slots[slot] = SlotState::Idle;
+
+  uint64_t timestamps[2];
+  if (vkGetQueryPoolResults(
+          lveDevice.device(),
+          queryPool,
+          2 * slot,
+          2,
+          sizeof(timestamps),
+          timestamps,
+          sizeof(uint64_t),
+          VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+    return;
+  }
+  LveTrace::gpuEvent(
+      name,
+      track,
+      lveDevice.timestampToTraceTime(timestamps[0]),
+      lveDevice.timestampToTraceTime(timestamps[1]));
+}
+
+}  // namespace lve
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Timestamp ranges around GPU work, handed to LveTrace on the CPU clock once the work finished.
+// Each slot holds one range in flight, e.g. one per frame in flight. Records nothing while
+// tracing is off or when the device can't write timestamps on the graphics queue.
+class LveGpuTimer {
+ public:
+  LveGpuTimer(LveDevice &device, uint32_t slotCount);
+  ~LveGpuTimer();
+
+  LveGpuTimer(const LveGpuTimer &) = delete;
+  LveGpuTimer &operator=(const LveGpuTimer &) = delete;
+
+  // Both into the same command buffer, outside a render pass
+  void begin(VkCommandBuffer commandBuffer, uint32_t slot);
+  void end(VkCommandBuffer commandBuffer, uint32_t slot);
+  // Once the submission of the slot's command buffer completed, e.g. after its fence signaled.
+  // Emits the range as name on the trace's track row.
+  void collect(uint32_t slot, const char *name, const char *track);
+
+ private:
+  enum class SlotState : uint8_t { Idle, Begun, Ended };
+
+  LveDevice &lveDevice;
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  std::vector<SlotState> slots;
+};
+
+}  // namespace lve
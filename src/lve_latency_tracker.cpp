@@ -0,0 +1,107 @@
+#include "lve_latency_tracker.hpp"
+
+// std
+#include <algorithm>
+#include <iostream>
+
+namespace lve {
+
+LveLatencyTracker::LveLatencyTracker(
+    size_t framesInFlight, bool presentTiming, const std::string &logFilepath)
+    : maxPendingFrames{framesInFlight * 4}, presentTiming{presentTiming} {
+  if (!logFilepath.empty()) {
+    log.open(logFilepath, std::ios::trunc);
+    log << "frame,input_to_submit_ms,input_to_gpu_done_ms,input_to_present_ms,source\n";
+  }
+  lastSummary = Clock::now();
+}
+
+void LveLatencyTracker::inputSampled(Clock::time_point time) {
+  pendingInput = time;
+  pendingInputValid = true;
+}
+
+void LveLatencyTracker::frameSubmitted(uint64_t frameId, size_t frameSlot) {
+  if (!pendingInputValid) return;
+
+  PendingFrame frame{};
+  frame.id = frameId;
+  frame.slot = frameSlot;
+  frame.input = pendingInput;
+  frame.submit = Clock::now();
+  pendingFrames.push_back(frame);
+  pendingInputValid = false;
+
+  // presents that never get waited for (swap chain recreated, window minimized) are dropped
+  while (pendingFrames.size() > maxPendingFrames) {
+    const auto &oldest = pendingFrames.front();
+    if (oldest.gpuDoneValid) {
+      report(oldest, oldest.gpuDone, false);
+    }
+    pendingFrames.pop_front();
+  }
+}
+
+void LveLatencyTracker::frameSlotCompleted(size_t frameSlot) {
+  auto now = Clock::now();
+  for (auto it = pendingFrames.begin(); it != pendingFrames.end();) {
+    if (it->slot != frameSlot || it->gpuDoneValid) {
+      ++it;
+      continue;
+    }
+
+    it->gpuDone = now;
+    it->gpuDoneValid = true;
+    if (presentTiming) {
+      ++it;
+    } else {
+      report(*it, now, false);
+      it = pendingFrames.erase(it);
+    }
+  }
+}
+
+void LveLatencyTracker::framePresented(uint64_t frameId) {
+  auto now = Clock::now();
+
+  // presents complete in order, anything older than frameId was displayed already
+  while (!pendingFrames.empty() && pendingFrames.front().id <= frameId) {
+    const auto &frame = pendingFrames.front();
+    if (frame.id == frameId) {
+      report(frame, now, true);
+    } else if (frame.gpuDoneValid) {
+      report(frame, frame.gpuDone, false);
+    }
+    pendingFrames.pop_front();
+  }
+}
+
+void LveLatencyTracker::report(const PendingFrame &frame, Clock::time_point end, bool measured) {
+  lastLatency = toMs(end - frame.input);
+  latencySum += lastLatency;
+  latencyMax = std::max(latencyMax, lastLatency);
+  reportedFrames++;
+
+  if (log.is_open()) {
+    log << frame.id << ',' << toMs(frame.submit - frame.input) << ','
+        << (frame.gpuDoneValid ? toMs(frame.gpuDone - frame.input) : 0.f) << ',' << lastLatency
+        << ',' << (measured ? "present_wait" : "fence") << '\n';
+  }
+
+  auto now = Clock::now();
+  if (now - lastSummary >= std::chrono::seconds(1)) {
+    std::cout << "Input-to-present latency: avg " << latencySum / reportedFrames << " ms, max "
+              << latencyMax << " ms over " << reportedFrames << " frames ("
+              << (presentTiming ? "measured" : "estimated") << ")" << std::endl;
+    latencySum = 0.f;
+    latencyMax = 0.f;
+    reportedFrames = 0;
+    lastSummary = now;
+  }
+}
+
+float LveLatencyTracker::toMs(Clock::duration duration) {
+  return std::chrono::duration<float, std::milli>(duration).count();
+}
+
+}  // namespace lve
@@ -0,0 +1,61 @@
+#pragma once
+
+// std
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// Estimates input-to-present latency per frame. The start of a frame is the moment its input
+// was sampled, the end is the present reported by VK_KHR_present_wait when available, otherwise
+// the moment the CPU observed the frame's fence being signaled.
+class LveLatencyTracker {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  LveLatencyTracker(size_t framesInFlight, bool presentTiming, const std::string &logFilepath);
+
+  LveLatencyTracker(const LveLatencyTracker &) = delete;
+  LveLatencyTracker &operator=(const LveLatencyTracker &) = delete;
+
+  // time is when the frame's input was read, which may have been on another thread
+  void inputSampled(Clock::time_point time);
+  void frameSubmitted(uint64_t frameId, size_t frameSlot);
+  void frameSlotCompleted(size_t frameSlot);
+  void framePresented(uint64_t frameId);
+
+  bool measuresPresent() { return presentTiming; }
+  float lastLatencyMs() { return lastLatency; }
+
+ private:
+  struct PendingFrame {
+    uint64_t id;
+    size_t slot;
+    Clock::time_point input;
+    Clock::time_point submit;
+    Clock::time_point gpuDone;
+    bool gpuDoneValid = false;
+  };
+
+  void report(const PendingFrame &frame, Clock::time_point end, bool measured);
+  static float toMs(Clock::duration duration);
+
+  size_t maxPendingFrames;
+  bool presentTiming;
+  Clock::time_point pendingInput;
+  bool pendingInputValid = false;
+  std::deque<PendingFrame> pendingFrames;
+  std::ofstream log;
+
+  float lastLatency = 0.f;
+  float latencySum = 0.f;
+  float latencyMax = 0.f;
+  uint32_t reportedFrames = 0;
+  Clock::time_point lastSummary;
+};
+
+}  // namespace lve
@@ -0,0 +1,35 @@
+#include "lve_lod_selector.hpp"
+
+// std
+#include <algorithm>
+
+namespace lve {
+
+float LveLodSelector::pixelsPerUnit(
+    const glm::mat4 &projection, float viewDepth, float viewportHeight) {
+  // clip space y spans 2 units over the viewport, projection[1][1] scales view space y into it
+  return 0.5f * viewportHeight * projection[1][1] / std::max(viewDepth, 1e-6f);
+}
+
+uint32_t LveLodSelector::select(
+    const LveModel &model, float pixelsPerUnit, uint32_t currentLod) const {
+  uint32_t lodCount = model.getLodCount();
+  currentLod = std::min(currentLod, lodCount - 1);
+
+  // errors grow with the level, search from the coarse end
+  auto coarsestWithin = [&](float pixelError) {
+    uint32_t lod = lodCount - 1;
+    while (lod > 0 && model.getLodError(lod) * pixelsPerUnit > pixelError) lod--;
+    return lod;
+  };
+
+  uint32_t coarser = coarsestWithin(maxPixelError * (1.f - hysteresis));
+  if (coarser > currentLod) return coarser;
+
+  if (model.getLodError(currentLod) * pixelsPerUnit > maxPixelError) {
+    return coarsestWithin(maxPixelError);
+  }
+  return currentLod;
+}
+
+}  // namespace lve
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "lve_model.hpp"
+
+namespace lve {
+
+// Picks a model's level of detail from how large its simplification error appears on screen.
+// The coarsest level whose error covers at most maxPixelError pixels is used. Moving to a
+// coarser level needs the error to fit within (1 - hysteresis) of that, so an object resting
+// near a threshold doesn't switch levels every frame.
+struct LveLodSelector {
+  float maxPixelError = 1.f;
+  float hysteresis = 0.25f;
+
+  // Pixels covered by one unit of length at viewDepth in front of the camera. Pass a viewDepth
+  // of 1 for orthographic projections, or with no projection at all.
+  static float pixelsPerUnit(const glm::mat4 &projection, float viewDepth, float viewportHeight);
+
+  uint32_t select(const LveModel &model, float pixelsPerUnit, uint32_t currentLod) const;
+};
+
+}  // namespace lve
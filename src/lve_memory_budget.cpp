@@ -0,0 +1,161 @@
+#include "lve_memory_budget.hpp"
+
+// std
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+namespace lve {
+
+LveMemoryBudget::LveMemoryBudget(VkPhysicalDevice physicalDevice, bool budgetExtension)
+    : physicalDevice{physicalDevice}, budgetExtension{budgetExtension} {
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+  heaps_.resize(memoryProperties.memoryHeapCount);
+  driverUsage.resize(memoryProperties.memoryHeapCount, 0);
+  allocatedAtQuery.resize(memoryProperties.memoryHeapCount, 0);
+  for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+    heaps_[i].size = memoryProperties.memoryHeaps[i].size;
+    heaps_[i].flags = memoryProperties.memoryHeaps[i].flags;
+    heaps_[i].budget = static_cast<VkDeviceSize>(heaps_[i].size * DEFAULT_BUDGET_RATIO);
+  }
+
+  std::lock_guard<std::mutex> lock{mutex};
+  queryDriver();
+}
+
+void LveMemoryBudget::allocated(
+    VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size) {
+  std::lock_guard<std::mutex> lock{mutex};
+  uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+  allocations[memory] = {heapIndex, size};
+  heaps_[heapIndex].allocated += size;
+  heaps_[heapIndex].allocations++;
+}
+
+void LveMemoryBudget::freed(VkDeviceMemory memory) {
+  std::lock_guard<std::mutex> lock{mutex};
+  auto it = allocations.find(memory);
+  if (it == allocations.end()) return;
+
+  Heap &heap = heaps_[it->second.heap];
+  heap.allocated -= it->second.size;
+  heap.allocations--;
+  allocations.erase(it);
+}
+
+void LveMemoryBudget::queryDriver() {
+  if (!budgetExtension) return;
+
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+  budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+  VkPhysicalDeviceMemoryProperties2 properties{};
+  properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+  properties.pNext = &budgetProperties;
+  vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties);
+
+  for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+    driverUsage[i] = budgetProperties.heapUsage[i];
+    allocatedAtQuery[i] = heaps_[i].allocated;
+    // some drivers report 0 for heaps they don't track
+    if (budgetProperties.heapBudget[i] > 0) heaps_[i].budget = budgetProperties.heapBudget[i];
+  }
+}
+
+LveMemoryBudget::Heap LveMemoryBudget::snapshot(uint32_t heapIndex) {
+  Heap heap = heaps_[heapIndex];
+  if (!budgetExtension) {
+    heap.usage = heap.allocated;
+    return heap;
+  }
+
+  // the driver's usage plus whatever was allocated or freed since it was queried
+  VkDeviceSize usage = driverUsage[heapIndex] + heap.allocated;
+  heap.usage = usage > allocatedAtQuery[heapIndex] ? usage - allocatedAtQuery[heapIndex] : 0;
+  return heap;
+}
+
+void LveMemoryBudget::update() {
+  struct Crossing {
+    ThresholdCallback callback;
+    uint32_t heapIndex;
+    Heap heap;
+    bool over;
+  };
+  std::vector<Crossing> crossings;
+
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    queryDriver();
+
+    for (auto &threshold : thresholds) {
+      for (uint32_t i = 0; i < heaps_.size(); i++) {
+        Heap current = snapshot(i);
+        bool over = current.usageRatio() > threshold.ratio;
+        if (over != threshold.over[i]) {
+          threshold.over[i] = over;
+          crossings.push_back({threshold.callback, i, current, over});
+        }
+      }
+    }
+  }
+
+  // without the lock, so callbacks can free memory
+  for (const auto &crossing : crossings) {
+    crossing.callback(crossing.heapIndex, crossing.heap, crossing.over);
+  }
+}
+
+bool LveMemoryBudget::fits(uint32_t memoryTypeIndex, VkDeviceSize size) {
+  std::lock_guard<std::mutex> lock{mutex};
+  Heap current = snapshot(memoryProperties.memoryTypes[memoryTypeIndex].heapIndex);
+  return current.usage + size <= current.budget;
+}
+
+uint32_t LveMemoryBudget::addThresholdCallback(float ratio, ThresholdCallback callback) {
+  std::lock_guard<std::mutex> lock{mutex};
+  uint32_t id = nextThresholdId++;
+  thresholds.push_back({id, ratio, std::move(callback), std::vector<bool>(heaps_.size(), false)});
+  return id;
+}
+
+void LveMemoryBudget::removeThresholdCallback(uint32_t id) {
+  std::lock_guard<std::mutex> lock{mutex};
+  thresholds.erase(
+      std::remove_if(
+          thresholds.begin(),
+          thresholds.end(),
+          [id](const Threshold &threshold) { return threshold.id == id; }),
+      thresholds.end());
+}
+
+std::vector<LveMemoryBudget::Heap> LveMemoryBudget::heaps() {
+  std::lock_guard<std::mutex> lock{mutex};
+  std::vector<Heap> result;
+  for (uint32_t i = 0; i < heaps_.size(); i++) {
+    result.push_back(snapshot(i));
+  }
+  return result;
+}
+
+void LveMemoryBudget::printStats() {
+  constexpr double MIB = 1024.0 * 1024.0;
+  auto current = heaps();
+
+  std::ios_base::fmtflags flags = std::cout.flags();
+  std::streamsize precision = std::cout.precision();
+  std::cout << "Memory budget" << (budgetExtension ? "" : " (estimated)") << ":" << std::fixed
+            << std::setprecision(1);
+  for (uint32_t i = 0; i < current.size(); i++) {
+    const Heap &heap = current[i];
+    std::cout << (i > 0 ? "," : "") << " heap " << i
+              << (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT ? " device" : " host") << " "
+              << heap.usage / MIB << "/" << heap.budget / MIB << " MiB ("
+              << heap.usageRatio() * 100.f << "%, " << heap.allocations << " allocations)";
+  }
+  std::cout << std::endl;
+  std::cout.flags(flags);
+  std::cout.precision(precision);
+}
+
+}  // namespace lve
@@ -0,0 +1,95 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+
+// Tracks device memory use against a budget per memory heap, so callers can free memory before
+// vkAllocateMemory fails instead of after. With VK_EXT_memory_budget, usage and budget come from
+// the driver and cover the whole process. update() refreshes them, and allocations made through
+// allocated()/freed() since then are added on top. Without the extension, usage is only what
+// went through allocated()/freed() and the budget is a fixed share of the heap size.
+// Safe to use from several threads.
+class LveMemoryBudget {
+ public:
+  struct Heap {
+    VkDeviceSize size = 0;
+    VkDeviceSize budget = 0;
+    VkDeviceSize usage = 0;
+    // the part of usage allocated through this tracker
+    VkDeviceSize allocated = 0;
+    uint32_t allocations = 0;
+    VkMemoryHeapFlags flags = 0;
+
+    float usageRatio() const { return budget ? static_cast<float>(usage) / budget : 0.f; }
+  };
+
+  // over is true when the heap's usage rose above the threshold, false when it dropped back
+  using ThresholdCallback = std::function<void(uint32_t heapIndex, const Heap &heap, bool over)>;
+
+  // Share of a heap assumed to be available without VK_EXT_memory_budget
+  static constexpr float DEFAULT_BUDGET_RATIO = 0.8f;
+
+  LveMemoryBudget(VkPhysicalDevice physicalDevice, bool budgetExtension);
+
+  LveMemoryBudget(const LveMemoryBudget &) = delete;
+  LveMemoryBudget &operator=(const LveMemoryBudget &) = delete;
+
+  void allocated(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size);
+  void freed(VkDeviceMemory memory);
+
+  // Queries the driver's numbers and runs the threshold callbacks of heaps that crossed them.
+  // Meant to be called once per frame, callbacks run on the calling thread.
+  void update();
+
+  // Whether size more bytes from the memory type would stay within its heap's budget
+  bool fits(uint32_t memoryTypeIndex, VkDeviceSize size);
+
+  // ratio is a share of the budget, e.g. 0.9f. Returns an id for removeThresholdCallback.
+  uint32_t addThresholdCallback(float ratio, ThresholdCallback callback);
+  void removeThresholdCallback(uint32_t id);
+
+  std::vector<Heap> heaps();
+  bool usesBudgetExtension() const { return budgetExtension; }
+  void printStats();
+
+ private:
+  struct Allocation {
+    uint32_t heap;
+    VkDeviceSize size;
+  };
+
+  struct Threshold {
+    uint32_t id;
+    float ratio;
+    ThresholdCallback callback;
+    std::vector<bool> over;  // per heap
+  };
+
+  // both expect the mutex to be held
+  void queryDriver();
+  Heap snapshot(uint32_t heapIndex);
+
+  VkPhysicalDevice physicalDevice;
+  const bool budgetExtension;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+
+  std::mutex mutex;
+  std::vector<Heap> heaps_;
+  // the driver's usage at the last query, and what this tracker had allocated at that point
+  std::vector<VkDeviceSize> driverUsage;
+  std::vector<VkDeviceSize> allocatedAtQuery;
+  std::unordered_map<VkDeviceMemory, Allocation> allocations;
+  std::vector<Threshold> thresholds;
+  uint32_t nextThresholdId = 1;
+};
+
+}  // namespace lve
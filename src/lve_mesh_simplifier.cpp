@@ -0,0 +1,262 @@
+#include "lve_mesh_simplifier.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+
+namespace lve {
+
+namespace {
+
+uint64_t edgeKey(uint32_t a, uint32_t b) {
+  if (a > b) std::swap(a, b);
+  return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+struct PositionHash {
+  size_t operator()(const glm::vec3 &position) const {
+    uint32_t bits[3];
+    std::memcpy(bits, &position, sizeof(bits));
+    size_t seed = 0;
+    for (uint32_t value : bits) {
+      seed ^= std::hash<uint32_t>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+    return seed;
+  }
+};
+
+}  // namespace
+
+void LveMeshSimplifier::Quadric::addPlane(const glm::dvec3 &normal, double distance) {
+  a2 += normal.x * normal.x;
+  ab += normal.x * normal.y;
+  ac += normal.x * normal.z;
+  ad += normal.x * distance;
+  b2 += normal.y * normal.y;
+  bc += normal.y * normal.z;
+  bd += normal.y * distance;
+  c2 += normal.z * normal.z;
+  cd += normal.z * distance;
+  d2 += distance * distance;
+}
+
+void LveMeshSimplifier::Quadric::add(const Quadric &other) {
+  a2 += other.a2;
+  ab += other.ab;
+  ac += other.ac;
+  ad += other.ad;
+  b2 += other.b2;
+  bc += other.bc;
+  bd += other.bd;
+  c2 += other.c2;
+  cd += other.cd;
+  d2 += other.d2;
+}
+
+double LveMeshSimplifier::Quadric::evaluate(const glm::dvec3 &p) const {
+  // p^T A p + 2 b.p + c, the summed squared distance of p to every plane
+  double result = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x +
+                  b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y + c2 * p.z * p.z +
+                  2 * cd * p.z + d2;
+  return std::max(result, 0.0);
+}
+
+LveMeshSimplifier::LveMeshSimplifier(
+    const std::vector<glm::vec3> &vertexPositionData, const std::vector<uint32_t> &indices) {
+  assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3");
+
+  std::unordered_map<glm::vec3, uint32_t, PositionHash> welded;
+  vertexPositions.resize(vertexPositionData.size());
+  for (uint32_t vertex = 0; vertex < vertexPositionData.size(); vertex++) {
+    auto result =
+        welded.emplace(vertexPositionData[vertex], static_cast<uint32_t>(positions.size()));
+    if (result.second) {
+      positions.push_back(glm::dvec3{vertexPositionData[vertex]});
+      positionVertices.push_back(vertex);
+    }
+    vertexPositions[vertex] = result.first->second;
+  }
+
+  size_t positionCount = positions.size();
+  quadrics.resize(positionCount);
+  positionTriangles.resize(positionCount);
+  versions.assign(positionCount, 0);
+  alive.assign(positionCount, true);
+
+  std::unordered_map<uint64_t, uint32_t> edgeUses;
+  triangles.reserve(indices.size() / 3);
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    Triangle triangle{{indices[i], indices[i + 1], indices[i + 2]}};
+    uint32_t p0 = positionOf(triangle.vertices[0]);
+    uint32_t p1 = positionOf(triangle.vertices[1]);
+    uint32_t p2 = positionOf(triangle.vertices[2]);
+    if (p0 == p1 || p1 == p2 || p2 == p0) continue;
+
+    glm::dvec3 normal = glm::cross(positions[p1] - positions[p0], positions[p2] - positions[p0]);
+    double length = glm::length(normal);
+    if (length == 0.0) continue;
+    normal /= length;
+
+    Quadric quadric;
+    quadric.addPlane(normal, -glm::dot(normal, positions[p0]));
+    uint32_t triangleIndex = static_cast<uint32_t>(triangles.size());
+    for (uint32_t position : {p0, p1, p2}) {
+      quadrics[position].add(quadric);
+      positionTriangles[position].push_back(triangleIndex);
+    }
+    edgeUses[edgeKey(p0, p1)]++;
+    edgeUses[edgeKey(p1, p2)]++;
+    edgeUses[edgeKey(p2, p0)]++;
+    triangles.push_back(triangle);
+  }
+  liveTriangles = triangles.size();
+
+  // boundary planes contain the open edge and the face normal
+  for (const auto &triangle : triangles) {
+    uint32_t corners[3] = {
+        positionOf(triangle.vertices[0]),
+        positionOf(triangle.vertices[1]),
+        positionOf(triangle.vertices[2])};
+    glm::dvec3 faceNormal = glm::normalize(glm::cross(
+        positions[corners[1]] - positions[corners[0]],
+        positions[corners[2]] - positions[corners[0]]));
+    for (int i = 0; i < 3; i++) {
+      uint32_t a = corners[i];
+      uint32_t b = corners[(i + 1) % 3];
+      if (edgeUses[edgeKey(a, b)] != 1) continue;
+
+      glm::dvec3 normal = glm::cross(positions[b] - positions[a], faceNormal);
+      double length = glm::length(normal);
+      if (length == 0.0) continue;
+      normal /= length;
+
+      Quadric quadric;
+      quadric.addPlane(normal, -glm::dot(normal, positions[a]));
+      quadrics[a].add(quadric);
+      quadrics[b].add(quadric);
+    }
+  }
+
+  for (const auto &entry : edgeUses) {
+    pushEdge(static_cast<uint32_t>(entry.first >> 32), static_cast<uint32_t>(entry.first));
+  }
+}
+
+void LveMeshSimplifier::pushEdge(uint32_t a, uint32_t b) {
+  Quadric combined = quadrics[a];
+  combined.add(quadrics[b]);
+
+  // endpoints only, so no new vertices are needed
+  double costToB = combined.evaluate(positions[b]);
+  double costToA = combined.evaluate(positions[a]);
+  if (costToA < costToB) std::swap(a, b);
+  queue.push({std::min(costToA, costToB), a, b, versions[a], versions[b]});
+}
+
+bool LveMeshSimplifier::flipsTriangle(uint32_t from, uint32_t to) const {
+  for (uint32_t triangleIndex : positionTriangles[from]) {
+    const auto &triangle = triangles[triangleIndex];
+    if (triangle.removed) continue;
+
+    glm::dvec3 before[3];
+    glm::dvec3 after[3];
+    bool collapses = false;
+    for (int i = 0; i < 3; i++) {
+      uint32_t position = positionOf(triangle.vertices[i]);
+      collapses |= position == to;
+      before[i] = positions[position];
+      after[i] = position == from ? positions[to] : before[i];
+    }
+    // the triangles on the collapsed edge disappear
+    if (collapses) continue;
+
+    glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+    glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+    if (glm::dot(normalBefore, normalAfter) <= 0.0) return true;
+  }
+  return false;
+}
+
+void LveMeshSimplifier::collapse(uint32_t from, uint32_t to) {
+  alive[from] = false;
+  quadrics[to].add(quadrics[from]);
+
+  for (uint32_t triangleIndex : positionTriangles[from]) {
+    auto &triangle = triangles[triangleIndex];
+    if (triangle.removed) continue;
+
+    bool collapses = false;
+    for (uint32_t vertex : triangle.vertices) collapses |= positionOf(vertex) == to;
+    if (collapses) {
+      triangle.removed = true;
+      liveTriangles--;
+      continue;
+    }
+
+    for (auto &vertex : triangle.vertices) {
+      if (positionOf(vertex) == from) vertex = positionVertices[to];
+    }
+    positionTriangles[to].push_back(triangleIndex);
+  }
+  positionTriangles[from].clear();
+  positionTriangles[from].shrink_to_fit();
+
+  // every edge of `to` changed cost, stale queue entries are recognised by the version
+  auto &toTriangles = positionTriangles[to];
+  toTriangles.erase(
+      std::remove_if(
+          toTriangles.begin(),
+          toTriangles.end(),
+          [this](uint32_t triangleIndex) { return triangles[triangleIndex].removed; }),
+      toTriangles.end());
+  versions[to]++;
+
+  std::vector<uint32_t> neighbours;
+  for (uint32_t triangleIndex : toTriangles) {
+    for (uint32_t vertex : triangles[triangleIndex].vertices) {
+      uint32_t position = positionOf(vertex);
+      if (position != to) neighbours.push_back(position);
+    }
+  }
+  std::sort(neighbours.begin(), neighbours.end());
+  neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+  for (uint32_t neighbour : neighbours) pushEdge(neighbour, to);
+}
+
+void LveMeshSimplifier::simplify(size_t targetTriangleCount, float maxError) {
+  double maxCost = static_cast<double>(maxError) * maxError;
+
+  while (liveTriangles > targetTriangleCount && !queue.empty()) {
+    Collapse candidate = queue.top();
+    if (!alive[candidate.from] || !alive[candidate.to] ||
+        versions[candidate.from] != candidate.fromVersion ||
+        versions[candidate.to] != candidate.toVersion) {
+      queue.pop();
+      continue;
+    }
+    // left queued, a later call with a larger maxError picks it up
+    if (candidate.cost > maxCost) break;
+
+    queue.pop();
+    if (flipsTriangle(candidate.from, candidate.to)) continue;
+
+    collapse(candidate.from, candidate.to);
+    error_ = std::max(error_, static_cast<float>(std::sqrt(candidate.cost)));
+  }
+}
+
+std::vector<uint32_t> LveMeshSimplifier::indices() const {
+  std::vector<uint32_t> result;
+  result.reserve(liveTriangles * 3);
+  for (const auto &triangle : triangles) {
+    if (triangle.removed) continue;
+    result.insert(result.end(), std::begin(triangle.vertices), std::end(triangle.vertices));
+  }
+  return result;
+}
+
+}  // namespace lve
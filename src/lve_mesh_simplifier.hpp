@@ -0,0 +1,85 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+namespace lve {
+
+// Quadric error metric edge collapse (Garland & Heckbert). Vertices are only ever moved onto an
+// existing vertex, so every simplified level indexes the original vertex buffer and a chain of
+// levels can share it.
+//
+// Connectivity is taken from positions, vertices that only differ in other attributes (color
+// seams) collapse together and take the attributes of the vertex they collapse onto. Open
+// edges get a plane perpendicular to the surface through them, which keeps outlines and holes
+// in place and gives flat meshes, where every face quadric is zero in the plane, a real error.
+class LveMeshSimplifier {
+ public:
+  LveMeshSimplifier(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices);
+
+  LveMeshSimplifier(const LveMeshSimplifier &) = delete;
+  LveMeshSimplifier &operator=(const LveMeshSimplifier &) = delete;
+
+  // Collapses edges until at most targetTriangleCount remain or the cheapest collapse would
+  // move the surface further than maxError. Calling it again with a lower target continues
+  // from the current mesh, which is how LOD chains are built.
+  void simplify(size_t targetTriangleCount, float maxError);
+
+  std::vector<uint32_t> indices() const;
+  size_t triangleCount() const { return liveTriangles; }
+  // Largest collapse error so far, an upper bound on the distance moved in position units
+  float error() const { return error_; }
+
+ private:
+  struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+    void addPlane(const glm::dvec3 &normal, double distance);
+    void add(const Quadric &other);
+    double evaluate(const glm::dvec3 &point) const;
+  };
+
+  struct Triangle {
+    uint32_t vertices[3];
+    bool removed = false;
+  };
+
+  struct Collapse {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+    uint32_t fromVersion;
+    uint32_t toVersion;
+
+    bool operator>(const Collapse &other) const { return cost > other.cost; }
+  };
+
+  uint32_t positionOf(uint32_t vertex) const { return vertexPositions[vertex]; }
+  void pushEdge(uint32_t a, uint32_t b);
+  bool flipsTriangle(uint32_t from, uint32_t to) const;
+  void collapse(uint32_t from, uint32_t to);
+
+  // welded positions, indexed by position id
+  std::vector<glm::dvec3> positions;
+  std::vector<uint32_t> positionVertices;  // vertex a collapsed corner is redirected to
+  std::vector<Quadric> quadrics;
+  std::vector<std::vector<uint32_t>> positionTriangles;
+  std::vector<uint32_t> versions;
+  std::vector<bool> alive;
+
+  std::vector<uint32_t> vertexPositions;
+  std::vector<Triangle> triangles;
+  size_t liveTriangles = 0;
+  float error_ = 0.f;
+
+  std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+};
+
+}  // namespace lve
@@ -0,0 +1,388 @@
+#include "lve_meshlet_culler.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+constexpr uint32_t WORKGROUP_SIZE = 64;  // local_size_x of both culling shaders
+constexpr uint32_t COUNTER_COUNT = 4;
+
+// std430 layout of Meshlet in meshlet_cull.glsl
+struct GpuMeshlet {
+  glm::vec4 sphere;
+  glm::vec4 coneApex;
+  glm::vec4 coneAxis;
+  uint32_t firstIndex;
+  uint32_t indexCount;
+  uint32_t padding[2];
+};
+static_assert(sizeof(GpuMeshlet) == 64, "GpuMeshlet must match the shader layout");
+
+// Push in meshlet_cull.glsl, phase values match LveMeshletCuller::Phase
+struct PushConstants {
+  glm::mat4 modelViewProjection;
+  glm::vec4 camera;
+  uint32_t meshletCount;
+  uint32_t backfaceCulling;
+  uint32_t phase;
+  uint32_t pyramidLevels;
+  uint32_t depthSize[2];
+};
+static_assert(sizeof(PushConstants) <= 128, "push constants beyond the guaranteed minimum");
+
+VkPipelineLayout createPipelineLayout(LveDevice &device, VkDescriptorSetLayout setLayout) {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(PushConstants);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &setLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  VkPipelineLayout pipelineLayout;
+  if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create meshlet cull pipeline layout!");
+  }
+  return pipelineLayout;
+}
+
+VkPipeline createComputePipeline(
+    LveDevice &device, VkPipelineLayout pipelineLayout, const std::string &filepath) {
+  // only needed while the pipeline is created
+  LveShaderModule shaderModule{device, filepath};
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = shaderModule.module();
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = pipelineLayout;
+
+  VkPipeline pipeline;
+  if (vkCreateComputePipelines(
+          device.device(),
+          device.pipelineCache(),
+          1,
+          &pipelineInfo,
+          nullptr,
+          &pipeline) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create meshlet cull pipeline!");
+  }
+  return pipeline;
+}
+
+void memoryBarrier(
+    VkCommandBuffer commandBuffer,
+    VkPipelineStageFlags srcStage,
+    VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStage,
+    VkAccessFlags dstAccess) {
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstAccessMask = dstAccess;
+  vkCmdPipelineBarrier(
+      commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void *mapBuffer(LveDevice &device, VkDeviceMemory memory) {
+  void *data;
+  if (vkMapMemory(device.device(), memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+    throw std::runtime_error("failed to map meshlet buffer memory!");
+  }
+  return data;
+}
+
+}  // namespace
+
+LveMeshletCuller::LveMeshletCuller(
+    LveDevice &device, const LveMeshlets &meshlets, uint32_t frameCount)
+    : lveDevice{device},
+      meshletCount_{static_cast<uint32_t>(meshlets.meshlets.size())},
+      frames(frameCount) {
+  if (meshletCount_ == 0) {
+    throw std::runtime_error("meshlet culler needs at least one meshlet");
+  }
+  createBuffers(meshlets);
+  createPipelines();
+  createDescriptorSets();
+}
+
+LveMeshletCuller::~LveMeshletCuller() {
+  auto &deletionQueue = lveDevice.deletionQueue();
+  for (auto &frame : frames) {
+    vkUnmapMemory(lveDevice.device(), frame.counterBufferMemory);
+    for (int i = 0; i < 2; i++) {
+      deletionQueue.destroyBuffer(frame.drawBuffers[i]);
+      deletionQueue.freeMemory(frame.drawBufferMemory[i]);
+    }
+    deletionQueue.destroyBuffer(frame.counterBuffer);
+    deletionQueue.freeMemory(frame.counterBufferMemory);
+  }
+  deletionQueue.destroyBuffer(meshletBuffer);
+  deletionQueue.freeMemory(meshletBufferMemory);
+  deletionQueue.destroyBuffer(indexBuffer);
+  deletionQueue.freeMemory(indexBufferMemory);
+  deletionQueue.destroyBuffer(visibilityBuffer);
+  deletionQueue.freeMemory(visibilityBufferMemory);
+  deletionQueue.destroyPipeline(pipeline);
+  deletionQueue.destroyPipeline(latePipeline);
+  deletionQueue.destroyPipelineLayout(pipelineLayout);
+  deletionQueue.destroyPipelineLayout(latePipelineLayout);
+}
+
+void LveMeshletCuller::createBuffers(const LveMeshlets &meshlets) {
+  constexpr VkMemoryPropertyFlags hostVisible =
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+  std::vector<GpuMeshlet> gpuMeshlets(meshletCount_);
+  for (uint32_t i = 0; i < meshletCount_; i++) {
+    const auto &meshlet = meshlets.meshlets[i];
+    auto &gpuMeshlet = gpuMeshlets[i];
+    gpuMeshlet.sphere = glm::vec4{meshlet.center, meshlet.radius};
+    gpuMeshlet.coneApex = glm::vec4{meshlet.coneApex, 0.f};
+    gpuMeshlet.coneAxis = glm::vec4{meshlet.coneAxis, meshlet.coneCutoff};
+    gpuMeshlet.firstIndex = meshlet.firstIndex;
+    gpuMeshlet.indexCount = meshlet.triangleCount * 3;
+  }
+
+  VkDeviceSize meshletSize = sizeof(GpuMeshlet) * gpuMeshlets.size();
+  lveDevice.createBuffer(
+      meshletSize,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      hostVisible,
+      meshletBuffer,
+      meshletBufferMemory);
+  memcpy(mapBuffer(lveDevice, meshletBufferMemory), gpuMeshlets.data(), meshletSize);
+  vkUnmapMemory(lveDevice.device(), meshletBufferMemory);
+
+  VkDeviceSize indexSize = sizeof(uint32_t) * meshlets.indices.size();
+  lveDevice.createBuffer(
+      indexSize,
+      VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+      hostVisible,
+      indexBuffer,
+      indexBufferMemory);
+  memcpy(mapBuffer(lveDevice, indexBufferMemory), meshlets.indices.data(), indexSize);
+  vkUnmapMemory(lveDevice.device(), indexBufferMemory);
+
+  // cleared by the first cull
+  lveDevice.createBuffer(
+      sizeof(uint32_t) * meshletCount_,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      visibilityBuffer,
+      visibilityBufferMemory);
+
+  for (auto &frame : frames) {
+    for (int i = 0; i < 2; i++) {
+      lveDevice.createBuffer(
+          sizeof(VkDrawIndexedIndirectCommand) * meshletCount_,
+          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+          frame.drawBuffers[i],
+          frame.drawBufferMemory[i]);
+    }
+    // read back on the host, stays mapped
+    lveDevice.createBuffer(
+        sizeof(uint32_t) * COUNTER_COUNT,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        hostVisible,
+        frame.counterBuffer,
+        frame.counterBufferMemory);
+    frame.counters = static_cast<uint32_t *>(mapBuffer(lveDevice, frame.counterBufferMemory));
+    memset(frame.counters, 0, sizeof(uint32_t) * COUNTER_COUNT);
+  }
+}
+
+void LveMeshletCuller::createPipelines() {
+  setLayout = LveDescriptorSetLayout::Builder(lveDevice)
+                  .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                  .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                  .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                  .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                  .build();
+  lateSetLayout =
+      LveDescriptorSetLayout::Builder(lveDevice)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+          .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+          .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+          .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+          .addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+          .build();
+
+  pipelineLayout = createPipelineLayout(lveDevice, setLayout->getDescriptorSetLayout());
+  latePipelineLayout = createPipelineLayout(lveDevice, lateSetLayout->getDescriptorSetLayout());
+  pipeline = createComputePipeline(lveDevice, pipelineLayout, "meshlet_cull.comp.spv");
+  latePipeline =
+      createComputePipeline(lveDevice, latePipelineLayout, "meshlet_occlusion_cull.comp.spv");
+}
+
+void LveMeshletCuller::createDescriptorSets() {
+  uint32_t frameCount = static_cast<uint32_t>(frames.size());
+  descriptorPool = LveDescriptorPool::Builder(lveDevice)
+                       .setMaxSets(frameCount * 2)
+                       .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frameCount * 8)
+                       .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount)
+                       .build();
+
+  for (auto &frame : frames) {
+    VkDescriptorBufferInfo meshletInfo{meshletBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo drawInfo{frame.drawBuffers[0], 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo lateDrawInfo{frame.drawBuffers[1], 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo counterInfo{frame.counterBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo visibilityInfo{visibilityBuffer, 0, VK_WHOLE_SIZE};
+    bool allocated = LveDescriptorWriter(*setLayout, *descriptorPool)
+                         .writeBuffer(0, &meshletInfo)
+                         .writeBuffer(1, &drawInfo)
+                         .writeBuffer(2, &counterInfo)
+                         .writeBuffer(3, &visibilityInfo)
+                         .build(frame.descriptorSet);
+    // the depth pyramid is written once the frame is culled with one
+    allocated = allocated && LveDescriptorWriter(*lateSetLayout, *descriptorPool)
+                                 .writeBuffer(0, &meshletInfo)
+                                 .writeBuffer(1, &lateDrawInfo)
+                                 .writeBuffer(2, &counterInfo)
+                                 .writeBuffer(3, &visibilityInfo)
+                                 .build(frame.lateDescriptorSet);
+    if (!allocated) {
+      throw std::runtime_error("failed to allocate meshlet cull descriptor set!");
+    }
+  }
+}
+
+void LveMeshletCuller::cull(
+    VkCommandBuffer commandBuffer,
+    uint32_t frameIndex,
+    const View &view,
+    Phase phase,
+    const LveDepthPyramid *depthPyramid) {
+  auto &frame = frames[frameIndex];
+
+  PushConstants push{};
+  push.modelViewProjection = view.modelViewProjection;
+  push.camera = view.camera;
+  push.meshletCount = meshletCount_;
+  push.backfaceCulling = view.backfaceCulling ? 1 : 0;
+  push.phase = static_cast<uint32_t>(phase);
+
+  VkPipeline phasePipeline = pipeline;
+  VkPipelineLayout phasePipelineLayout = pipelineLayout;
+  VkDescriptorSet descriptorSet = frame.descriptorSet;
+  if (phase == Phase::Late) {
+    assert(depthPyramid && "Late culling needs the depth pyramid of the early draws");
+    push.pyramidLevels = depthPyramid->levelCount();
+    push.depthSize[0] = depthPyramid->depthExtent().width;
+    push.depthSize[1] = depthPyramid->depthExtent().height;
+
+    // the frame's previous submission has completed, its set is free to update
+    if (frame.depthPyramidView != depthPyramid->imageView()) {
+      VkDescriptorImageInfo pyramidInfo{};
+      pyramidInfo.sampler = depthPyramid->sampler();
+      pyramidInfo.imageView = depthPyramid->imageView();
+      pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+      LveDescriptorWriter(*lateSetLayout, *descriptorPool)
+          .writeImage(4, &pyramidInfo)
+          .overwrite(frame.lateDescriptorSet);
+      frame.depthPyramidView = depthPyramid->imageView();
+    }
+
+    phasePipeline = latePipeline;
+    phasePipelineLayout = latePipelineLayout;
+    descriptorSet = frame.lateDescriptorSet;
+
+    // counters and visibility as the early phase left them
+    memoryBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+  } else {
+    vkCmdFillBuffer(commandBuffer, frame.counterBuffer, 0, VK_WHOLE_SIZE, 0);
+    if (!visibilityCleared) {
+      vkCmdFillBuffer(commandBuffer, visibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+      visibilityCleared = true;
+    }
+    // also orders the previous frame's late phase before this one reads visibility
+    memoryBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+  }
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, phasePipeline);
+  lveDevice.frameStats().pipelineBound();
+  vkCmdBindDescriptorSets(
+      commandBuffer,
+      VK_PIPELINE_BIND_POINT_COMPUTE,
+      phasePipelineLayout,
+      0,
+      1,
+      &descriptorSet,
+      0,
+      nullptr);
+  vkCmdPushConstants(
+      commandBuffer,
+      phasePipelineLayout,
+      VK_SHADER_STAGE_COMPUTE_BIT,
+      0,
+      sizeof(PushConstants),
+      &push);
+  vkCmdDispatch(commandBuffer, (meshletCount_ + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+  // draws are consumed by this frame's rendering, counters by the host after the fence
+  memoryBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_ACCESS_SHADER_WRITE_BIT,
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+      VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT);
+}
+
+void LveMeshletCuller::draw(VkCommandBuffer commandBuffer, uint32_t frameIndex, Phase phase) {
+  VkBuffer drawBuffer = frames[frameIndex].drawBuffers[phase == Phase::Late ? 1 : 0];
+  vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+  constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+  uint32_t maxDraws = lveDevice.multiDrawIndirectEnabled()
+                          ? std::max(1u, lveDevice.properties.limits.maxDrawIndirectCount)
+                          : 1u;
+  for (uint32_t first = 0; first < meshletCount_; first += maxDraws) {
+    uint32_t count = std::min(maxDraws, meshletCount_ - first);
+    vkCmdDrawIndexedIndirect(
+        commandBuffer,
+        drawBuffer,
+        static_cast<VkDeviceSize>(first) * stride,
+        count,
+        stride);
+    lveDevice.frameStats().drawIndirect();
+  }
+}
+
+LveMeshletCuller::Stats LveMeshletCuller::readStats(uint32_t frameIndex) {
+  const uint32_t *counters = frames[frameIndex].counters;
+  Stats stats;
+  stats.meshlets = meshletCount_;
+  stats.drawn = counters[0];
+  stats.frustumCulled = counters[1];
+  stats.backfaceCulled = counters[2];
+  stats.occlusionCulled = counters[3];
+  return stats;
+}
+
+}  // namespace lve
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "lve_depth_pyramid.hpp"
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+#include "lve_meshlets.hpp"
+#include "lve_shader_module.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+namespace lve {
+
+// Culls meshlets against the view frustum and their backface cones in a compute shader and
+// draws the survivors with indexed indirect draws, one per meshlet. Works without mesh shader
+// support, the meshlets are plain index ranges over the model's vertex buffer.
+//
+// Occlusion culling runs in two phases around a depth pyramid of the current frame:
+//   cull(Early) + draw(Early)  draws what passed the occlusion test last frame
+//   LveDepthPyramid::build     reduces the depth those draws left behind
+//   cull(Late) + draw(Late)    tests every meshlet against the pyramid, draws the visible ones
+//                              Early skipped and remembers the result for the next frame
+// Occluders are whatever was visible last frame, so nothing visible is ever skipped, at worst
+// newly disoccluded meshlets are drawn late.
+class LveMeshletCuller {
+ public:
+  enum class Phase {
+    All,  // frustum and backface culling only
+    Early,
+    Late,
+  };
+
+  // Counted by the GPU, readable once the frame's fence has signalled. With occlusion culling
+  // drawn covers both phases, the culled counts come from the late one.
+  struct Stats {
+    uint32_t meshlets = 0;
+    uint32_t drawn = 0;
+    uint32_t frustumCulled = 0;
+    uint32_t backfaceCulled = 0;
+    uint32_t occlusionCulled = 0;
+  };
+
+  struct View {
+    // model to clip space, the frustum is tested in model space
+    glm::mat4 modelViewProjection{1.f};
+    // w = 1: camera position in model space, w = 0: view direction of an orthographic camera
+    glm::vec4 camera{0.f, 0.f, 1.f, 0.f};
+    // only correct when the pipeline culls back faces, the cones assume counter-clockwise
+    // front faces in model space
+    bool backfaceCulling = false;
+  };
+
+  LveMeshletCuller(
+      LveDevice &device,
+      const LveMeshlets &meshlets,
+      uint32_t frameCount = LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+  ~LveMeshletCuller();
+
+  LveMeshletCuller(const LveMeshletCuller &) = delete;
+  LveMeshletCuller &operator=(const LveMeshletCuller &) = delete;
+
+  // Recorded outside of rendering, before draw() of the same phase and frame. Late needs the
+  // pyramid built from this frame's early draws, the other phases ignore it.
+  void cull(
+      VkCommandBuffer commandBuffer,
+      uint32_t frameIndex,
+      const View &view,
+      Phase phase = Phase::All,
+      const LveDepthPyramid *depthPyramid = nullptr);
+  // Binds the meshlet index buffer over the vertex buffer that is already bound
+  void draw(VkCommandBuffer commandBuffer, uint32_t frameIndex, Phase phase = Phase::All);
+
+  Stats readStats(uint32_t frameIndex);
+  uint32_t meshletCount() const { return meshletCount_; }
+
+ private:
+  // The late phase writes its own draws, the early ones may still be read by the draw calls
+  struct Frame {
+    VkBuffer drawBuffers[2];
+    VkDeviceMemory drawBufferMemory[2];
+    VkBuffer counterBuffer;
+    VkDeviceMemory counterBufferMemory;
+    uint32_t *counters;
+    VkDescriptorSet descriptorSet;
+    VkDescriptorSet lateDescriptorSet;
+    // pyramid the late set points at, rewritten when the frame is recorded with another one
+    VkImageView depthPyramidView = VK_NULL_HANDLE;
+  };
+
+  void createBuffers(const LveMeshlets &meshlets);
+  void createPipelines();
+  void createDescriptorSets();
+
+  LveDevice &lveDevice;
+  uint32_t meshletCount_;
+
+  VkBuffer meshletBuffer;
+  VkDeviceMemory meshletBufferMemory;
+  VkBuffer indexBuffer;
+  VkDeviceMemory indexBufferMemory;
+  // shared by all frames, the queue orders the late phase of one before the early of the next
+  VkBuffer visibilityBuffer;
+  VkDeviceMemory visibilityBufferMemory;
+  bool visibilityCleared = false;
+  std::vector<Frame> frames;
+
+  std::unique_ptr<LveDescriptorSetLayout> setLayout;
+  std::unique_ptr<LveDescriptorSetLayout> lateSetLayout;
+  std::unique_ptr<LveDescriptorPool> descriptorPool;
+  VkPipelineLayout pipelineLayout;
+  VkPipelineLayout latePipelineLayout;
+  VkPipeline pipeline;
+  VkPipeline latePipeline;
+};
+
+}  // namespace lve
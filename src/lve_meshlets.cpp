@@ -0,0 +1,171 @@
+#include "lve_meshlets.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace lve {
+
+namespace {
+
+// below this the normals spread over more than a hemisphere and the cone culls nothing
+constexpr float MIN_CONE_SPREAD = 0.1f;
+constexpr float NEVER_CULL = 2.f;
+
+void computeBounds(
+    LveMeshlet &meshlet,
+    const std::vector<glm::vec3> &positions,
+    const uint32_t *indices,
+    const std::vector<uint32_t> &vertices) {
+  glm::vec3 center{0.f};
+  for (uint32_t vertex : vertices) center += positions[vertex];
+  center /= static_cast<float>(vertices.size());
+
+  float radius = 0.f;
+  for (uint32_t vertex : vertices) {
+    radius = std::max(radius, glm::length(positions[vertex] - center));
+  }
+  meshlet.center = center;
+  meshlet.radius = radius;
+
+  struct Plane {
+    glm::vec3 point;
+    glm::vec3 normal;
+  };
+  std::vector<Plane> planes;
+  planes.reserve(meshlet.triangleCount);
+  glm::vec3 axis{0.f};
+  for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++) {
+    const uint32_t *corners = indices + triangle * 3;
+    glm::vec3 p0 = positions[corners[0]];
+    glm::vec3 normal = glm::cross(positions[corners[1]] - p0, positions[corners[2]] - p0);
+    float length = glm::length(normal);
+    if (length == 0.f) continue;
+    planes.push_back({p0, normal / length});
+    axis += planes.back().normal;
+  }
+
+  meshlet.coneApex = center;
+  meshlet.coneAxis = glm::vec3{0.f, 0.f, 1.f};
+  meshlet.coneCutoff = NEVER_CULL;
+  float axisLength = glm::length(axis);
+  if (planes.empty() || axisLength == 0.f) return;
+  axis /= axisLength;
+
+  float minDot = 1.f;
+  for (const auto &plane : planes) minDot = std::min(minDot, glm::dot(axis, plane.normal));
+  meshlet.coneAxis = axis;
+  if (minDot < MIN_CONE_SPREAD) return;
+
+  // apex behind every triangle plane, seen from it all triangles face away at once
+  float maxT = 0.f;
+  for (const auto &plane : planes) {
+    float t = glm::dot(center - plane.point, plane.normal) / glm::dot(axis, plane.normal);
+    maxT = std::max(maxT, t);
+  }
+  meshlet.coneApex = center - axis * maxT;
+  meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+}
+
+}  // namespace
+
+LveMeshlets LveMeshlets::build(
+    const std::vector<glm::vec3> &positions,
+    const std::vector<uint32_t> &indices,
+    uint32_t maxVertices,
+    uint32_t maxTriangles) {
+  assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3");
+  assert(maxVertices >= 3 && maxTriangles >= 1 && "Meshlet limits too small");
+
+  uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+  uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+
+  // vertex to triangle adjacency, compressed rows
+  std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+  for (uint32_t index : indices) adjacencyOffsets[index + 1]++;
+  for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+    adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+  }
+  std::vector<uint32_t> adjacency(indices.size());
+  {
+    std::vector<uint32_t> next(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+      for (int corner = 0; corner < 3; corner++) {
+        adjacency[next[indices[triangle * 3 + corner]]++] = triangle;
+      }
+    }
+  }
+
+  LveMeshlets result;
+  result.indices.reserve(indices.size());
+
+  std::vector<bool> emitted(triangleCount, false);
+  // meshlet + 1 the vertex was last added to, 0 for none
+  std::vector<uint32_t> vertexMeshlet(vertexCount, 0);
+  std::vector<uint32_t> meshletVertices;
+  std::vector<uint32_t> candidates;
+  uint32_t nextSeed = 0;
+
+  auto newVertices = [&](uint32_t triangle, uint32_t meshletId) {
+    uint32_t count = 0;
+    for (int corner = 0; corner < 3; corner++) {
+      count += vertexMeshlet[indices[triangle * 3 + corner]] != meshletId;
+    }
+    return count;
+  };
+
+  while (true) {
+    while (nextSeed < triangleCount && emitted[nextSeed]) nextSeed++;
+    if (nextSeed == triangleCount) break;
+
+    LveMeshlet meshlet{};
+    meshlet.firstIndex = static_cast<uint32_t>(result.indices.size());
+    uint32_t meshletId = static_cast<uint32_t>(result.meshlets.size()) + 1;
+    meshletVertices.clear();
+    candidates.clear();
+
+    uint32_t triangle = nextSeed;
+    while (true) {
+      emitted[triangle] = true;
+      for (int corner = 0; corner < 3; corner++) {
+        uint32_t vertex = indices[triangle * 3 + corner];
+        result.indices.push_back(vertex);
+        if (vertexMeshlet[vertex] == meshletId) continue;
+
+        vertexMeshlet[vertex] = meshletId;
+        meshletVertices.push_back(vertex);
+        for (uint32_t i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; i++) {
+          if (!emitted[adjacency[i]]) candidates.push_back(adjacency[i]);
+        }
+      }
+      meshlet.triangleCount++;
+      if (meshlet.triangleCount == maxTriangles) break;
+
+      // best neighbour that still fits, dropping candidates emitted in the meantime
+      uint32_t best = UINT32_MAX;
+      uint32_t bestNew = 4;
+      size_t kept = 0;
+      for (uint32_t candidate : candidates) {
+        if (emitted[candidate]) continue;
+        candidates[kept++] = candidate;
+        uint32_t added = newVertices(candidate, meshletId);
+        if (added < bestNew && meshletVertices.size() + added <= maxVertices) {
+          best = candidate;
+          bestNew = added;
+        }
+      }
+      candidates.resize(kept);
+      if (best == UINT32_MAX) break;
+      triangle = best;
+    }
+
+    meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+    computeBounds(
+        meshlet, positions, result.indices.data() + meshlet.firstIndex, meshletVertices);
+    result.meshlets.push_back(meshlet);
+  }
+  return result;
+}
+
+}  // namespace lve
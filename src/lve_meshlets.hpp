@@ -0,0 +1,48 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+struct LveMeshlet {
+  // triangles [firstIndex / 3, firstIndex / 3 + triangleCount) of LveMeshlets::indices
+  uint32_t firstIndex;
+  uint32_t triangleCount;
+  uint32_t vertexCount;
+
+  glm::vec3 center;
+  float radius;
+  // Every triangle faces away from a camera at c when
+  // dot(normalize(coneApex - c), coneAxis) >= coneCutoff. A cutoff above 1 never culls.
+  glm::vec3 coneApex;
+  glm::vec3 coneAxis;
+  float coneCutoff;
+};
+
+// An indexed mesh split into small clusters that can be culled on their own. Triangles are
+// reordered so each meshlet is a contiguous index range and can be drawn with a plain indexed
+// draw, no mesh shader support needed.
+struct LveMeshlets {
+  static constexpr uint32_t MAX_VERTICES = 64;
+  static constexpr uint32_t MAX_TRIANGLES = 124;
+
+  std::vector<LveMeshlet> meshlets;
+  std::vector<uint32_t> indices;
+
+  // Meshlets are grown greedily from neighbouring triangles, preferring the ones that add the
+  // fewest new vertices, so clusters stay compact and their bounds tight
+  static LveMeshlets build(
+      const std::vector<glm::vec3> &positions,
+      const std::vector<uint32_t> &indices,
+      uint32_t maxVertices = MAX_VERTICES,
+      uint32_t maxTriangles = MAX_TRIANGLES);
+};
+
+}  // namespace lve
@@ -1,26 +1,135 @@
 #include "lve_model.hpp"
+#include "lve_mesh_simplifier.hpp"
 #include "vulkan/vulkan_core.h"
 
 // std
 #include <cassert>
 #include <cstddef>
 #include <cstring>
+#include <functional>
+#include <unordered_map>
+#include <utility>
 
 namespace lve {
 
-LveModel::LveModel(LveDevice& device, const std::vector<Vertex>& vertices) : lveDevice(device) {
-  createVertexBuffers(vertices);
+namespace {
+  // Vertex is plain floats without padding, hashed and compared bitwise
+  struct VertexHash {
+    size_t operator()(const LveModel::Vertex& vertex) const {
+      uint32_t bits[sizeof(LveModel::Vertex) / sizeof(uint32_t)];
+      memcpy(bits, &vertex, sizeof(bits));
+      size_t seed = 0;
+      for (uint32_t value : bits) {
+        seed ^= std::hash<uint32_t>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+      }
+      return seed;
+    }
+  };
+
+  struct VertexEqual {
+    bool operator()(const LveModel::Vertex& a, const LveModel::Vertex& b) const {
+      return memcmp(&a, &b, sizeof(LveModel::Vertex)) == 0;
+    }
+  };
+}
+
+LveModel::LveModel(LveDevice& device, const std::vector<Vertex>& vertices)
+  : LveModel(device, static_cast<uint32_t>(vertices.size()), [&vertices](Vertex* data) {
+      memcpy(data, vertices.data(), sizeof(Vertex) * vertices.size());
+    }) {}
+
+LveModel::LveModel(LveDevice& device, uint32_t vertexCount, const FillFunction& fill)
+  : lveDevice(device) {
+  createVertexBuffers(vertexCount, fill);
+}
+
+LveModel::LveModel(
+  LveDevice& device, const std::vector<Vertex>& vertices, const LodSettings& lodSettings)
+  : lveDevice(device) {
+  std::vector<Vertex> uniqueVertices;
+  std::vector<uint32_t> indices;
+  weld(vertices, uniqueVertices, indices);
+  createIndexedModel(uniqueVertices, std::move(indices), lodSettings);
+}
+
+LveModel::LveModel(
+  LveDevice& device,
+  const std::vector<Vertex>& vertices,
+  const std::vector<uint32_t>& indices,
+  const LodSettings& lodSettings)
+  : lveDevice(device) {
+  createIndexedModel(vertices, indices, lodSettings);
+}
+
+void LveModel::weld(
+  const std::vector<Vertex>& vertices,
+  std::vector<Vertex>& uniqueVertices,
+  std::vector<uint32_t>& indices) {
+  uniqueVertices.clear();
+  indices.clear();
+  indices.reserve(vertices.size());
+  std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual> welded;
+  for (const auto& vertex : vertices) {
+    auto result = welded.emplace(vertex, static_cast<uint32_t>(uniqueVertices.size()));
+    if (result.second) {
+      uniqueVertices.push_back(vertex);
+    }
+    indices.push_back(result.first->second);
+  }
+}
+
+std::vector<glm::vec3> LveModel::getPositions(const std::vector<Vertex>& vertices) {
+  std::vector<glm::vec3> positions;
+  positions.reserve(vertices.size());
+  for (const auto& vertex : vertices) {
+    positions.emplace_back(vertex.position, 0.f);
+  }
+  return positions;
+}
+
+void LveModel::createIndexedModel(
+  const std::vector<Vertex>& vertices,
+  std::vector<uint32_t> indices,
+  const LodSettings& lodSettings) {
+  lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.f});
+  if (lodSettings.maxLevels > 1) {
+    LveMeshSimplifier simplifier{getPositions(vertices), indices};
+    while (lods.size() < lodSettings.maxLevels) {
+      size_t previousTriangles = lods.back().indexCount / 3;
+      auto target = static_cast<size_t>(previousTriangles * lodSettings.reduction);
+      if (target == 0) break;
+
+      simplifier.simplify(target, lodSettings.maxError);
+      if (simplifier.triangleCount() >= previousTriangles) break;
+
+      std::vector<uint32_t> levelIndices = simplifier.indices();
+      lods.push_back({
+        static_cast<uint32_t>(indices.size()),
+        static_cast<uint32_t>(levelIndices.size()),
+        simplifier.error()});
+      indices.insert(indices.end(), levelIndices.begin(), levelIndices.end());
+    }
+  }
+
+  createVertexBuffers(static_cast<uint32_t>(vertices.size()), [&](Vertex* data) {
+    memcpy(data, vertices.data(), sizeof(Vertex) * vertices.size());
+  });
+  createIndexBuffer(indices);
 }
 
 LveModel::~LveModel() {
-  vkDestroyBuffer(lveDevice.device(), vertexBuffer, nullptr);
-  vkFreeMemory(lveDevice.device(), vertexBufferMemory, nullptr);
+  lveDevice.deletionQueue().destroyBuffer(vertexBuffer);
+  lveDevice.deletionQueue().freeMemory(vertexBufferMemory);
+  if (indexBuffer != VK_NULL_HANDLE) {
+    lveDevice.deletionQueue().destroyBuffer(indexBuffer);
+    lveDevice.deletionQueue().freeMemory(indexBufferMemory);
+  }
 }
 
-void LveModel::createVertexBuffers(const std::vector<Vertex>& vertices) {
-  vertexCount = static_cast<uint32_t>(vertices.size());
+void LveModel::createVertexBuffers(uint32_t count, const FillFunction& fill) {
+  vertexCount = count;
   assert(vertexCount >= 3 && "Vertex count must be at least 3");
-  VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
+  VkDeviceSize bufferSize = sizeof(Vertex) * vertexCount;
   lveDevice.createBuffer(
     bufferSize,
     VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
@@ -31,18 +140,46 @@ void LveModel::createVertexBuffers(const std::vector<Vertex>& vertices) {
 
   void* data;
   vkMapMemory(lveDevice.device(), vertexBufferMemory, 0, bufferSize, 0, &data);
-  memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
+  fill(static_cast<Vertex*>(data));
   vkUnmapMemory(lveDevice.device(), vertexBufferMemory);
+  lveDevice.frameStats().uploaded(bufferSize);
+}
+
+void LveModel::createIndexBuffer(const std::vector<uint32_t>& indices) {
+  VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+  lveDevice.createBuffer(
+    bufferSize,
+    VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    indexBuffer,
+    indexBufferMemory
+  );
+
+  void* data;
+  vkMapMemory(lveDevice.device(), indexBufferMemory, 0, bufferSize, 0, &data);
+  memcpy(data, indices.data(), static_cast<size_t>(bufferSize));
+  vkUnmapMemory(lveDevice.device(), indexBufferMemory);
+  lveDevice.frameStats().uploaded(bufferSize);
 }
 
 void LveModel::bind(VkCommandBuffer commandBuffer) {
   VkBuffer buffers[] = {vertexBuffer};
   VkDeviceSize offsets[] = {0};
   vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+  if (indexBuffer != VK_NULL_HANDLE) {
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+  }
 }
 
-void LveModel::draw(VkCommandBuffer commandBuffer) {
-  vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+void LveModel::draw(VkCommandBuffer commandBuffer, uint32_t lod) {
+  if (lods.empty()) {
+    vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+    lveDevice.frameStats().draw(1, vertexCount / 3);
+    return;
+  }
+  assert(lod < lods.size() && "LOD does not exist");
+  vkCmdDrawIndexed(commandBuffer, lods[lod].indexCount, 1, lods[lod].firstIndex, 0, 0);
+  lveDevice.frameStats().draw(1, lods[lod].indexCount / 3);
 }
 
 std::vector<VkVertexInputBindingDescription> LveModel::Vertex::getBindingDescriptipons() {
@@ -8,6 +8,7 @@
 #include <glm/glm.hpp>
 
 // std
+#include <functional>
 #include <vector>
 
 namespace lve {
@@ -21,22 +22,75 @@ class LveModel {
       static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
     };
 
+    using FillFunction = std::function<void(Vertex* vertices)>;
+
+    // Simplified versions of the mesh, stored back to back in one index buffer over the shared
+    // vertex buffer
+    struct Lod {
+      uint32_t firstIndex;
+      uint32_t indexCount;
+      // how far the level may deviate from the full mesh, in model units
+      float error;
+    };
+
+    struct LodSettings {
+      uint32_t maxLevels = 4;
+      // triangle count of each level relative to the previous one
+      float reduction = 0.5f;
+      // levels that would deviate further than this are not generated
+      float maxError = 1.f;
+    };
+
     LveModel(LveDevice& device, const std::vector<Vertex>& vertices);
+    // Welds identical vertices and simplifies the mesh into up to lodSettings.maxLevels levels
+    LveModel(
+      LveDevice& device, const std::vector<Vertex>& vertices, const LodSettings& lodSettings);
+    // Already indexed, e.g. welded with weld() to build meshlets over the same vertices
+    LveModel(
+      LveDevice& device,
+      const std::vector<Vertex>& vertices,
+      const std::vector<uint32_t>& indices,
+      const LodSettings& lodSettings);
+    // fill writes all vertexCount vertices straight into the mapped vertex buffer
+    LveModel(LveDevice& device, uint32_t vertexCount, const FillFunction& fill);
     ~LveModel();
 
     LveModel(const LveModel&) = delete;
     LveModel &operator=(const LveModel&) = delete;
 
+    // Merges bitwise identical vertices into an indexed mesh
+    static void weld(
+      const std::vector<Vertex>& vertices,
+      std::vector<Vertex>& uniqueVertices,
+      std::vector<uint32_t>& indices);
+    // Positions in model space, z = 0
+    static std::vector<glm::vec3> getPositions(const std::vector<Vertex>& vertices);
+
     void bind(VkCommandBuffer commandBuffer);
-    void draw(VkCommandBuffer commandBuffer);
+    void draw(VkCommandBuffer commandBuffer, uint32_t lod = 0);
+
+    uint32_t getLodCount() const { return lods.empty() ? 1 : static_cast<uint32_t>(lods.size()); }
+    float getLodError(uint32_t lod) const { return lods.empty() ? 0.f : lods[lod].error; }
+    uint32_t getTriangleCount(uint32_t lod = 0) const {
+      return (lods.empty() ? vertexCount : lods[lod].indexCount) / 3;
+    }
 
   private:
     LveDevice& lveDevice;
     VkBuffer vertexBuffer;
     VkDeviceMemory vertexBufferMemory;
     uint32_t vertexCount;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory indexBufferMemory = VK_NULL_HANDLE;
+    // empty for models drawn without an index buffer
+    std::vector<Lod> lods;
 
-    void createVertexBuffers(const std::vector<Vertex>& vertices);
+    void createVertexBuffers(uint32_t count, const FillFunction& fill);
+    void createIndexedModel(
+      const std::vector<Vertex>& vertices,
+      std::vector<uint32_t> indices,
+      const LodSettings& lodSettings);
+    void createIndexBuffer(const std::vector<uint32_t>& indices);
 };
 }  // namespace lve
 
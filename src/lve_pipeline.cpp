@@ -2,51 +2,75 @@
 #include "lve_model.hpp"
 
 // std
-#include <fstream>
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 #include <iostream>
 #include <cassert>
 
 namespace lve {
 
+  void SpecializationConstants::write(uint32_t constantId, const void *value, size_t size) {
+    // Entries stay sorted by id with their data packed in the same order, so the same constants
+    // set in any order produce identical entries and data, and with them the same pipeline key
+    auto entry = std::lower_bound(
+      entries.begin(),
+      entries.end(),
+      constantId,
+      [](const VkSpecializationMapEntry &entry, uint32_t id) { return entry.constantID < id; });
+
+    if (entry != entries.end() && entry->constantID == constantId) {
+      if (entry->size != size)
+        throw std::runtime_error("specialization constant redefined with a different size");
+      memcpy(data.data() + entry->offset, value, size);
+      return;
+    }
+
+    uint32_t offset = entry != entries.end() ? entry->offset : static_cast<uint32_t>(data.size());
+    auto *bytes = static_cast<const uint8_t*>(value);
+    data.insert(data.begin() + offset, bytes, bytes + size);
+    for (auto later = entry; later != entries.end(); ++later)
+      later->offset += static_cast<uint32_t>(size);
+
+    VkSpecializationMapEntry newEntry{};
+    newEntry.constantID = constantId;
+    newEntry.offset = offset;
+    newEntry.size = size;
+    entries.insert(entry, newEntry);
+  }
+
+  void SpecializationConstants::fill(VkSpecializationInfo &info) const {
+    info.mapEntryCount = static_cast<uint32_t>(entries.size());
+    info.pMapEntries = entries.data();
+    info.dataSize = data.size();
+    info.pData = data.data();
+  }
+
   LvePipeline::LvePipeline(
     LveDevice &device,
     const std::string &vertFilepath,
     const std::string &fragFilepath,
     const PipelineConfigInfo &configInfo
-  ) : lveDevice{device} {
-    createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
-  }
+  ) : LvePipeline{
+        device,
+        std::make_shared<LveShaderModule>(device, vertFilepath),
+        std::make_shared<LveShaderModule>(device, fragFilepath),
+        configInfo} {}
 
-  LvePipeline::~LvePipeline() {
-    vkDestroyShaderModule(lveDevice.device(), vertShaderModule, nullptr);
-    vkDestroyShaderModule(lveDevice.device(), fragShaderModule, nullptr);
-    vkDestroyPipeline(lveDevice.device(), graphicsPipeline, nullptr);
+  LvePipeline::LvePipeline(
+    LveDevice &device,
+    std::shared_ptr<LveShaderModule> vertShader,
+    std::shared_ptr<LveShaderModule> fragShader,
+    const PipelineConfigInfo &configInfo
+  ) : lveDevice{device}, vertShaderModule{std::move(vertShader)}, fragShaderModule{std::move(fragShader)} {
+    createGraphicsPipeline(configInfo);
   }
 
-  std::vector<char> LvePipeline::readFile(const std::string &filepath) {
-    std::ifstream file{ filepath, std::ios::ate | std::ios::binary };
-
-    if (!file.is_open()) {
-      throw std::runtime_error("failed to open file: " + filepath);
-    }
-
-    // The end of the file means the size of it
-    size_t fileSize = static_cast<size_t>(file.tellg());
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
-
-    return buffer;
+  LvePipeline::~LvePipeline() {
+    lveDevice.deletionQueue().destroyPipeline(graphicsPipeline);
   }
 
-  void LvePipeline::createGraphicsPipeline(
-      const std::string &vertFilepath,
-      const std::string &fragFilepath,
-      const PipelineConfigInfo &configInfo
-  ) {
+  void LvePipeline::createGraphicsPipeline(const PipelineConfigInfo &configInfo) {
 
     assert(
         configInfo.pipelineLayout != VK_NULL_HANDLE &&
@@ -54,32 +78,33 @@ namespace lve {
     );
 
     assert(
-        configInfo.pipelineLayout != VK_NULL_HANDLE &&
-        "Cannot create graphics pipeline:: no renderPass provided in configInfo"
+        (configInfo.renderPass != VK_NULL_HANDLE ||
+         configInfo.colorAttachmentFormat != VK_FORMAT_UNDEFINED) &&
+        "Cannot create graphics pipeline:: no renderPass or attachment formats provided in configInfo"
     );
 
-    auto vertCode = readFile(vertFilepath);
-    auto fragCode = readFile(fragFilepath);
-
-    createShaderModule(vertCode, &vertShaderModule);
-    createShaderModule(fragCode, &fragShaderModule);
-
     VkPipelineShaderStageCreateInfo shaderStages[2];
     shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].module = vertShaderModule->module();
     shaderStages[0].pName = "main";
     shaderStages[0].flags = 0;
     shaderStages[0].pNext = nullptr;
-    shaderStages[0].pSpecializationInfo = nullptr;
+    VkSpecializationInfo vertSpecializationInfo{};
+    configInfo.vertSpecialization.fill(vertSpecializationInfo);
+    shaderStages[0].pSpecializationInfo =
+        configInfo.vertSpecialization.empty() ? nullptr : &vertSpecializationInfo;
 
     shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].module = fragShaderModule->module();
     shaderStages[1].pName = "main";
     shaderStages[1].flags = 0;
     shaderStages[1].pNext = nullptr;
-    shaderStages[1].pSpecializationInfo = nullptr;
+    VkSpecializationInfo fragSpecializationInfo{};
+    configInfo.fragSpecialization.fill(fragSpecializationInfo);
+    shaderStages[1].pSpecializationInfo =
+        configInfo.fragSpecialization.empty() ? nullptr : &fragSpecializationInfo;
 
     auto attributeDescriptions = LveModel::Vertex::getAttributeDescriptions();
     auto bindingDescriptions = LveModel::Vertex::getBindingDescriptipons();
@@ -107,27 +132,26 @@ namespace lve {
     pipelineInfo.renderPass = configInfo.renderPass;
     pipelineInfo.subpass = configInfo.subpass;
 
+    // Without a render pass the attachment formats come from the config (dynamic rendering)
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &configInfo.colorAttachmentFormat;
+    renderingInfo.depthAttachmentFormat = configInfo.depthAttachmentFormat;
+    if (configInfo.renderPass == VK_NULL_HANDLE)
+      pipelineInfo.pNext = &renderingInfo;
+
     pipelineInfo.basePipelineIndex = -1;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(lveDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(lveDevice.device(), lveDevice.pipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
       throw std::runtime_error("failed to create graphics pipeline");
     }
   }
 
-  void LvePipeline::createShaderModule(const std::vector<char> &code, VkShaderModule *shaderModule) {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-    if (vkCreateShaderModule(lveDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create shader module");
-    }
-  }
-
   void LvePipeline::bind(VkCommandBuffer commandBuffer) {
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+    lveDevice.frameStats().pipelineBound();
   };
 
   void LvePipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
@@ -199,5 +223,28 @@ namespace lve {
     configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
     configInfo.dynamicStateInfo.flags = 0;
   }
-};
 
+  void LvePipeline::copyPipelineConfigInfo(const PipelineConfigInfo& src, PipelineConfigInfo& dst) {
+    dst.viewportInfo = src.viewportInfo;
+    dst.inputAssemblyInfo = src.inputAssemblyInfo;
+    dst.rasterizationInfo = src.rasterizationInfo;
+    dst.multisampleInfo = src.multisampleInfo;
+    dst.colorBlendAttachment = src.colorBlendAttachment;
+    dst.colorBlendInfo = src.colorBlendInfo;
+    dst.depthStencilInfo = src.depthStencilInfo;
+    dst.dynamicStateEnables = src.dynamicStateEnables;
+    dst.dynamicStateInfo = src.dynamicStateInfo;
+    dst.pipelineLayout = src.pipelineLayout;
+    dst.renderPass = src.renderPass;
+    dst.subpass = src.subpass;
+    dst.colorAttachmentFormat = src.colorAttachmentFormat;
+    dst.depthAttachmentFormat = src.depthAttachmentFormat;
+    dst.vertSpecialization = src.vertSpecialization;
+    dst.fragSpecialization = src.fragSpecialization;
+
+    if (src.colorBlendInfo.pAttachments == &src.colorBlendAttachment)
+      dst.colorBlendInfo.pAttachments = &dst.colorBlendAttachment;
+    if (src.dynamicStateInfo.pDynamicStates == src.dynamicStateEnables.data())
+      dst.dynamicStateInfo.pDynamicStates = dst.dynamicStateEnables.data();
+  }
+};
@@ -1,11 +1,46 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include "lve_device.hpp"
+#include "lve_shader_module.hpp"
 
 namespace lve {
+  // Typed specialization constants for one shader stage. Disabled feature paths become
+  // constants the driver can strip instead of runtime branches or duplicated shaders.
+  class SpecializationConstants {
+    public:
+      template <typename T>
+      void set(uint32_t constantId, const T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "constants must be plain data");
+        write(constantId, &value, sizeof(T));
+      }
+
+      // SPIR-V booleans are 32 bit
+      void set(uint32_t constantId, bool value) {
+        VkBool32 boolValue = value ? VK_TRUE : VK_FALSE;
+        write(constantId, &boolValue, sizeof(boolValue));
+      }
+
+      bool empty() const { return entries.empty(); }
+      const std::vector<VkSpecializationMapEntry> &mapEntries() const { return entries; }
+      const std::vector<uint8_t> &bytes() const { return data; }
+      // Points into this object, which has to outlive the pipeline creation using it
+      void fill(VkSpecializationInfo &info) const;
+
+    private:
+      void write(uint32_t constantId, const void *value, size_t size);
+
+      std::vector<VkSpecializationMapEntry> entries;
+      std::vector<uint8_t> data;
+  };
+
   struct PipelineConfigInfo {
+    PipelineConfigInfo() = default;
     PipelineConfigInfo(const PipelineConfigInfo&) = delete;
     PipelineConfigInfo& operator=(const PipelineConfigInfo&) = delete;
 
@@ -21,6 +56,12 @@ namespace lve {
     VkPipelineLayout pipelineLayout = nullptr;
     VkRenderPass renderPass = nullptr;
     uint32_t subpass = 0;
+    // Used instead of renderPass when it is null, for dynamic rendering into LveRenderGraph
+    // attachments, see FirstApp::renderScenePass
+    VkFormat colorAttachmentFormat = VK_FORMAT_UNDEFINED;
+    VkFormat depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+    SpecializationConstants vertSpecialization;
+    SpecializationConstants fragSpecialization;
   };
 
   class LvePipeline {
@@ -31,6 +72,12 @@ namespace lve {
           const std::string &fragFilepath,
           const PipelineConfigInfo &configInfo
       );
+      LvePipeline(
+          LveDevice &device,
+          std::shared_ptr<LveShaderModule> vertShader,
+          std::shared_ptr<LveShaderModule> fragShader,
+          const PipelineConfigInfo &configInfo
+      );
       ~LvePipeline();
 
       LvePipeline(const LvePipeline&) = delete;
@@ -39,21 +86,16 @@ namespace lve {
       void bind(VkCommandBuffer commandBuffer);
 
       static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
+      // Member-wise copy that repoints dst's internal pointers at dst's own members
+      static void copyPipelineConfigInfo(const PipelineConfigInfo& src, PipelineConfigInfo& dst);
 
     private:
-      static std::vector<char> readFile(const std::string &filepath);
       LveDevice &lveDevice;
       VkPipeline graphicsPipeline;
-      VkShaderModule vertShaderModule;
-      VkShaderModule fragShaderModule;
-
-      void createGraphicsPipeline(
-          const std::string &vertFilepath,
-          const std::string &fragFilepath,
-          const PipelineConfigInfo &configInfo
-      );
+      std::shared_ptr<LveShaderModule> vertShaderModule;
+      std::shared_ptr<LveShaderModule> fragShaderModule;
 
-      void createShaderModule(const std::vector<char> &code, VkShaderModule *shaderModule);
+      void createGraphicsPipeline(const PipelineConfigInfo &configInfo);
   };
 }
 
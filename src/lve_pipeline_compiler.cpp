@@ -0,0 +1,90 @@
+#include "lve_pipeline_compiler.hpp"
+
+#include "lve_trace.hpp"
+
+// std
+#include <exception>
+
+namespace lve {
+
+LvePipelineCompiler::LvePipelineCompiler(
+    LveDevice &device, LveThreadPool &threadPool, LvePipelineRegistry *registry)
+    : lveDevice{device}, threadPool{threadPool}, registry{registry} {}
+
+LvePipelineCompiler::~LvePipelineCompiler() { waitIdle(); }
+
+LvePipelineRequest LvePipelineCompiler::compile(
+    const std::string &vertFilepath,
+    const std::string &fragFilepath,
+    const PipelineConfigInfo &configInfo) {
+  LvePipelineRequest request;
+  request.state = std::make_shared<LvePipelineRequest::State>();
+
+  std::string key;
+  std::shared_ptr<LveShaderModule> vertShader;
+  std::shared_ptr<LveShaderModule> fragShader;
+  if (registry) {
+    key = LvePipelineRegistry::pipelineKey(vertFilepath, fragFilepath, configInfo);
+    if (auto pipeline = registry->findPipeline(key)) {
+      request.state->pipeline = std::move(pipeline);
+      request.state->ready.store(true, std::memory_order_release);
+      return request;
+    }
+    try {
+      vertShader = registry->getShaderModule(vertFilepath);
+      fragShader = registry->getShaderModule(fragFilepath);
+    } catch (const std::exception &e) {
+      request.state->error = e.what();
+      request.state->failed.store(true, std::memory_order_release);
+      return request;
+    }
+  }
+
+  auto config = std::make_shared<PipelineConfigInfo>();
+  LvePipeline::copyPipelineConfigInfo(configInfo, *config);
+
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    pending++;
+  }
+
+  auto state = request.state;
+  threadPool.submit([this, state, config, key, vertShader, fragShader, vertFilepath,
+                     fragFilepath] {
+    LVE_TRACE_SCOPE("compilePipeline");
+    try {
+      if (registry) {
+        state->pipeline = registry->addPipeline(
+            key, std::make_shared<LvePipeline>(lveDevice, vertShader, fragShader, *config));
+      } else {
+        state->pipeline =
+            std::make_shared<LvePipeline>(lveDevice, vertFilepath, fragFilepath, *config);
+      }
+    } catch (const std::exception &e) {
+      state->error = e.what();
+      state->failed.store(true, std::memory_order_release);
+    }
+    if (state->pipeline) {
+      state->ready.store(true, std::memory_order_release);
+    }
+
+    // notify under the lock, the compiler may be destroyed as soon as pending reaches zero
+    std::lock_guard<std::mutex> lock{mutex};
+    pending--;
+    idle.notify_all();
+  });
+
+  return request;
+}
+
+size_t LvePipelineCompiler::pendingCount() {
+  std::lock_guard<std::mutex> lock{mutex};
+  return pending;
+}
+
+void LvePipelineCompiler::waitIdle() {
+  std::unique_lock<std::mutex> lock{mutex};
+  idle.wait(lock, [this] { return pending == 0; });
+}
+
+}  // namespace lve
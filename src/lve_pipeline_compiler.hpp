@@ -0,0 +1,76 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_pipeline_registry.hpp"
+#include "lve_thread_pool.hpp"
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace lve {
+
+// Future-like handle to a pipeline being compiled on a worker thread. get() never blocks, it
+// returns nullptr until the pipeline is ready so callers can skip draws or use a fallback.
+class LvePipelineRequest {
+ public:
+  LvePipelineRequest() = default;
+
+  bool valid() const { return state != nullptr; }
+  bool isReady() const { return state && state->ready.load(std::memory_order_acquire); }
+  bool hasFailed() const { return state && state->failed.load(std::memory_order_acquire); }
+  LvePipeline *get() const { return isReady() ? state->pipeline.get() : nullptr; }
+  const std::string &error() const { return state->error; }
+
+ private:
+  friend class LvePipelineCompiler;
+
+  struct State {
+    std::atomic<bool> ready{false};
+    std::atomic<bool> failed{false};
+    std::shared_ptr<LvePipeline> pipeline;
+    std::string error;
+  };
+
+  std::shared_ptr<State> state;
+};
+
+// Compiles pipelines on a worker pool. All pipelines share the device's VkPipelineCache, which
+// Vulkan synchronizes internally, so variants compiled in parallel still reuse each other's work.
+class LvePipelineCompiler {
+ public:
+  // With a registry, identical requests resolve immediately and finished pipelines are registered
+  LvePipelineCompiler(
+      LveDevice &device, LveThreadPool &threadPool, LvePipelineRegistry *registry = nullptr);
+  // Waits for compiles that are still running, they reference the device and config copies
+  ~LvePipelineCompiler();
+
+  LvePipelineCompiler(const LvePipelineCompiler &) = delete;
+  LvePipelineCompiler &operator=(const LvePipelineCompiler &) = delete;
+
+  // configInfo is copied, the caller's config does not need to outlive the request
+  LvePipelineRequest compile(
+      const std::string &vertFilepath,
+      const std::string &fragFilepath,
+      const PipelineConfigInfo &configInfo);
+
+  size_t pendingCount();
+  // Blocks until every compile submitted so far has finished, call it before destroying the
+  // pipeline layouts or render passes that pending requests were configured with
+  void waitIdle();
+
+ private:
+  LveDevice &lveDevice;
+  LveThreadPool &threadPool;
+  LvePipelineRegistry *registry;
+
+  std::mutex mutex;
+  std::condition_variable idle;
+  size_t pending = 0;
+};
+
+}  // namespace lve
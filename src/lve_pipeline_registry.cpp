@@ -0,0 +1,225 @@
+#include "lve_pipeline_registry.hpp"
+
+// std
+#include <iostream>
+#include <type_traits>
+
+namespace lve {
+
+  namespace {
+    // Fields are appended one by one, the create info structs hold pointers and padding
+    template <typename T>
+    void append(std::string &key, const T &value) {
+      static_assert(std::is_trivially_copyable<T>::value, "only plain values can be keyed");
+      key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void append(std::string &key, const std::string &value) {
+      append(key, static_cast<uint64_t>(value.size()));
+      key.append(value);
+    }
+
+    // The constants themselves, a digest could collide and hand out the wrong variant
+    void append(std::string &key, const SpecializationConstants &constants) {
+      append(key, static_cast<uint64_t>(constants.mapEntries().size()));
+      for (const auto &entry : constants.mapEntries()) {
+        append(key, entry.constantID);
+        append(key, entry.offset);
+        append(key, static_cast<uint64_t>(entry.size));
+      }
+      const auto &bytes = constants.bytes();
+      append(key, static_cast<uint64_t>(bytes.size()));
+      key.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+  }
+
+  LvePipelineRegistry::LvePipelineRegistry(LveDevice &device) : lveDevice{device} {}
+
+  std::shared_ptr<LveShaderModule> LvePipelineRegistry::getShaderModule(const std::string &filepath) {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto &entry = shaderModules[filepath];
+    if (auto shaderModule = entry.lock()) {
+      stats_.shaderModuleHits++;
+      return shaderModule;
+    }
+
+    stats_.shaderModuleMisses++;
+    auto shaderModule = std::make_shared<LveShaderModule>(lveDevice, filepath);
+    entry = shaderModule;
+    return shaderModule;
+  }
+
+  std::shared_ptr<LvePipeline> LvePipelineRegistry::getPipeline(
+      const std::string &vertFilepath,
+      const std::string &fragFilepath,
+      const PipelineConfigInfo &configInfo) {
+    auto key = pipelineKey(vertFilepath, fragFilepath, configInfo);
+    if (auto pipeline = findPipeline(key))
+      return pipeline;
+
+    auto pipeline = std::make_shared<LvePipeline>(
+        lveDevice,
+        getShaderModule(vertFilepath),
+        getShaderModule(fragFilepath),
+        configInfo);
+    return addPipeline(key, std::move(pipeline));
+  }
+
+  std::shared_ptr<LvePipeline> LvePipelineRegistry::findPipeline(const std::string &key) {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto it = pipelines.find(key);
+    if (it == pipelines.end()) {
+      stats_.pipelineMisses++;
+      return nullptr;
+    }
+
+    stats_.pipelineHits++;
+    return it->second;
+  }
+
+  std::shared_ptr<LvePipeline> LvePipelineRegistry::addPipeline(
+      const std::string &key, std::shared_ptr<LvePipeline> pipeline) {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto result = pipelines.emplace(key, std::move(pipeline));
+    return result.first->second;
+  }
+
+  void LvePipelineRegistry::releaseUnused() {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    for (auto it = pipelines.begin(); it != pipelines.end();) {
+      if (it->second.use_count() == 1)
+        it = pipelines.erase(it);
+      else
+        ++it;
+    }
+
+    for (auto it = shaderModules.begin(); it != shaderModules.end();) {
+      if (it->second.expired())
+        it = shaderModules.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  LvePipelineRegistry::Stats LvePipelineRegistry::stats() {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    Stats stats = stats_;
+    stats.uniquePipelines = pipelines.size();
+    stats.uniqueShaderModules = 0;
+    for (const auto &entry : shaderModules) {
+      if (!entry.second.expired())
+        stats.uniqueShaderModules++;
+    }
+    return stats;
+  }
+
+  void LvePipelineRegistry::printStats() {
+    Stats current = stats();
+    std::cout << "Pipeline registry: " << current.uniquePipelines << " unique pipelines, "
+              << current.pipelineHits << " hits / " << current.pipelineMisses << " misses ("
+              << current.pipelineHitRatio() * 100.f << "%), " << current.uniqueShaderModules
+              << " shader modules, " << current.shaderModuleHits << " hits / "
+              << current.shaderModuleMisses << " misses ("
+              << current.shaderModuleHitRatio() * 100.f << "%)" << std::endl;
+  }
+
+  std::string LvePipelineRegistry::pipelineKey(
+      const std::string &vertFilepath,
+      const std::string &fragFilepath,
+      const PipelineConfigInfo &configInfo) {
+    std::string key;
+    key.reserve(512);
+
+    append(key, vertFilepath);
+    append(key, fragFilepath);
+    append(key, configInfo.vertSpecialization);
+    append(key, configInfo.fragSpecialization);
+
+    const auto &viewport = configInfo.viewportInfo;
+    append(key, viewport.viewportCount);
+    append(key, viewport.scissorCount);
+    if (viewport.pViewports) {
+      for (uint32_t i = 0; i < viewport.viewportCount; i++)
+        append(key, viewport.pViewports[i]);
+    }
+    if (viewport.pScissors) {
+      for (uint32_t i = 0; i < viewport.scissorCount; i++)
+        append(key, viewport.pScissors[i]);
+    }
+
+    const auto &inputAssembly = configInfo.inputAssemblyInfo;
+    append(key, inputAssembly.topology);
+    append(key, inputAssembly.primitiveRestartEnable);
+
+    const auto &rasterization = configInfo.rasterizationInfo;
+    append(key, rasterization.depthClampEnable);
+    append(key, rasterization.rasterizerDiscardEnable);
+    append(key, rasterization.polygonMode);
+    append(key, rasterization.cullMode);
+    append(key, rasterization.frontFace);
+    append(key, rasterization.depthBiasEnable);
+    append(key, rasterization.depthBiasConstantFactor);
+    append(key, rasterization.depthBiasClamp);
+    append(key, rasterization.depthBiasSlopeFactor);
+    append(key, rasterization.lineWidth);
+
+    const auto &multisample = configInfo.multisampleInfo;
+    append(key, multisample.rasterizationSamples);
+    append(key, multisample.sampleShadingEnable);
+    append(key, multisample.minSampleShading);
+    append(key, multisample.alphaToCoverageEnable);
+    append(key, multisample.alphaToOneEnable);
+    if (multisample.pSampleMask) {
+      uint32_t words = (static_cast<uint32_t>(multisample.rasterizationSamples) + 31) / 32;
+      for (uint32_t i = 0; i < words; i++)
+        append(key, multisample.pSampleMask[i]);
+    }
+
+    const auto &colorBlend = configInfo.colorBlendInfo;
+    append(key, colorBlend.logicOpEnable);
+    append(key, colorBlend.logicOp);
+    append(key, colorBlend.attachmentCount);
+    for (uint32_t i = 0; i < colorBlend.attachmentCount; i++) {
+      const auto &attachment = colorBlend.pAttachments[i];
+      append(key, attachment.blendEnable);
+      append(key, attachment.srcColorBlendFactor);
+      append(key, attachment.dstColorBlendFactor);
+      append(key, attachment.colorBlendOp);
+      append(key, attachment.srcAlphaBlendFactor);
+      append(key, attachment.dstAlphaBlendFactor);
+      append(key, attachment.alphaBlendOp);
+      append(key, attachment.colorWriteMask);
+    }
+    for (float constant : colorBlend.blendConstants)
+      append(key, constant);
+
+    const auto &depthStencil = configInfo.depthStencilInfo;
+    append(key, depthStencil.depthTestEnable);
+    append(key, depthStencil.depthWriteEnable);
+    append(key, depthStencil.depthCompareOp);
+    append(key, depthStencil.depthBoundsTestEnable);
+    append(key, depthStencil.stencilTestEnable);
+    append(key, depthStencil.front);
+    append(key, depthStencil.back);
+    append(key, depthStencil.minDepthBounds);
+    append(key, depthStencil.maxDepthBounds);
+
+    const auto &dynamicState = configInfo.dynamicStateInfo;
+    append(key, dynamicState.dynamicStateCount);
+    for (uint32_t i = 0; i < dynamicState.dynamicStateCount; i++)
+      append(key, dynamicState.pDynamicStates[i]);
+
+    append(key, configInfo.pipelineLayout);
+    append(key, configInfo.renderPass);
+    append(key, configInfo.subpass);
+    append(key, configInfo.colorAttachmentFormat);
+    append(key, configInfo.depthAttachmentFormat);
+
+    return key;
+  }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_shader_module.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace lve {
+  // Deduplicates pipelines and shader modules. Pipelines are keyed by every piece of state that
+  // reaches vkCreateGraphicsPipelines, so an identical request costs a hash lookup instead of a
+  // driver compile. Shader modules are shared per file and released when no pipeline uses them.
+  // Safe to use from several threads.
+  class LvePipelineRegistry {
+    public:
+      struct Stats {
+        uint64_t pipelineHits = 0;
+        uint64_t pipelineMisses = 0;
+        uint64_t shaderModuleHits = 0;
+        uint64_t shaderModuleMisses = 0;
+        size_t uniquePipelines = 0;
+        size_t uniqueShaderModules = 0;
+
+        float pipelineHitRatio() const {
+          uint64_t total = pipelineHits + pipelineMisses;
+          return total ? static_cast<float>(pipelineHits) / total : 0.f;
+        }
+        float shaderModuleHitRatio() const {
+          uint64_t total = shaderModuleHits + shaderModuleMisses;
+          return total ? static_cast<float>(shaderModuleHits) / total : 0.f;
+        }
+      };
+
+      explicit LvePipelineRegistry(LveDevice &device);
+
+      LvePipelineRegistry(const LvePipelineRegistry&) = delete;
+      LvePipelineRegistry& operator=(const LvePipelineRegistry&) = delete;
+
+      std::shared_ptr<LveShaderModule> getShaderModule(const std::string &filepath);
+      // Returns the shared pipeline for this state, compiling it on the calling thread on a miss
+      std::shared_ptr<LvePipeline> getPipeline(
+          const std::string &vertFilepath,
+          const std::string &fragFilepath,
+          const PipelineConfigInfo &configInfo);
+
+      // Lookup and insertion split apart for callers that compile elsewhere (LvePipelineCompiler).
+      // addPipeline returns the pipeline already registered if another thread won the race.
+      std::shared_ptr<LvePipeline> findPipeline(const std::string &key);
+      std::shared_ptr<LvePipeline> addPipeline(
+          const std::string &key, std::shared_ptr<LvePipeline> pipeline);
+
+      // Drops pipelines nobody outside the registry holds, e.g. ones built for a stale render pass
+      void releaseUnused();
+
+      Stats stats();
+      void printStats();
+
+      // Byte key covering shader identity and all fixed-function state
+      static std::string pipelineKey(
+          const std::string &vertFilepath,
+          const std::string &fragFilepath,
+          const PipelineConfigInfo &configInfo);
+
+    private:
+      LveDevice &lveDevice;
+
+      std::mutex mutex;
+      std::unordered_map<std::string, std::weak_ptr<LveShaderModule>> shaderModules;
+      std::unordered_map<std::string, std::shared_ptr<LvePipeline>> pipelines;
+      Stats stats_;
+  };
+}
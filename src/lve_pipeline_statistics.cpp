@@ -0,0 +1,104 @@
+#include "lve_pipeline_statistics.hpp"
+
+// std
+#include <cassert>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace lve {
+
+LvePipelineStatistics::Result &LvePipelineStatistics::Result::operator+=(const Result &other) {
+  inputAssemblyPrimitives += other.inputAssemblyPrimitives;
+  vertexShaderInvocations += other.vertexShaderInvocations;
+  clippingInvocations += other.clippingInvocations;
+  clippingPrimitives += other.clippingPrimitives;
+  fragmentShaderInvocations += other.fragmentShaderInvocations;
+  computeShaderInvocations += other.computeShaderInvocations;
+  return *this;
+}
+
+LvePipelineStatistics::LvePipelineStatistics(LveDevice &device, uint32_t slotCount)
+    : lveDevice{device}, pending(slotCount, false) {
+  assert(
+      device.pipelineStatisticsQueryEnabled() &&
+      "Pipeline statistics queries need the pipelineStatisticsQuery feature");
+
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+  poolInfo.queryCount = slotCount;
+  // must match the order of Result's members
+  poolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+                                VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+                                VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+                                VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+                                VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+                                VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+  if (vkCreateQueryPool(device.device(), &poolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline statistics query pool!");
+  }
+}
+
+LvePipelineStatistics::~LvePipelineStatistics() {
+  vkDestroyQueryPool(lveDevice.device(), queryPool, nullptr);
+}
+
+void LvePipelineStatistics::begin(VkCommandBuffer commandBuffer, uint32_t slot) {
+  vkCmdResetQueryPool(commandBuffer, queryPool, slot, 1);
+  vkCmdBeginQuery(commandBuffer, queryPool, slot, 0);
+  pending[slot] = false;
+}
+
+void LvePipelineStatistics::end(VkCommandBuffer commandBuffer, uint32_t slot) {
+  vkCmdEndQuery(commandBuffer, queryPool, slot);
+  pending[slot] = true;
+}
+
+bool LvePipelineStatistics::collect(uint32_t slot) {
+  if (!pending[slot]) return false;
+  pending[slot] = false;
+
+  uint64_t values[STATISTIC_COUNT];
+  if (vkGetQueryPoolResults(
+          lveDevice.device(),
+          queryPool,
+          slot,
+          1,
+          sizeof(values),
+          values,
+          sizeof(values),
+          VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+    return false;
+  }
+
+  last.inputAssemblyPrimitives = values[0];
+  last.vertexShaderInvocations = values[1];
+  last.clippingInvocations = values[2];
+  last.clippingPrimitives = values[3];
+  last.fragmentShaderInvocations = values[4];
+  last.computeShaderInvocations = values[5];
+  total += last;
+  ranges++;
+  return true;
+}
+
+void LvePipelineStatistics::printStats() const {
+  if (ranges == 0) return;
+
+  auto perRange = [this](uint64_t value) { return static_cast<double>(value) / ranges; };
+  std::ios_base::fmtflags flags = std::cout.flags();
+  std::streamsize precision = std::cout.precision();
+  std::cout << "Pipeline statistics over " << ranges << " frames: " << std::fixed
+            << std::setprecision(0) << perRange(total.inputAssemblyPrimitives)
+            << " primitives assembled, " << perRange(total.clippingInvocations)
+            << " reached clipping, " << perRange(total.clippingPrimitives) << " output by it, "
+            << perRange(total.vertexShaderInvocations) << " vertex, "
+            << perRange(total.fragmentShaderInvocations) << " fragment and "
+            << perRange(total.computeShaderInvocations) << " compute invocations per frame"
+            << std::endl;
+  std::cout.flags(flags);
+  std::cout.precision(precision);
+}
+
+}  // namespace lve
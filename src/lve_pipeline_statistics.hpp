@@ -0,0 +1,61 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Pipeline statistics queries around a range of a command buffer: primitives assembled and
+// clipped, and vertex, fragment and compute shader invocations. Each slot holds one range in
+// flight, e.g. one per frame in flight. Needs the pipelineStatisticsQuery feature, see
+// LveDevice::pipelineStatisticsQueryEnabled().
+class LvePipelineStatistics {
+ public:
+  // In the order Vulkan writes them, by statistic bit
+  struct Result {
+    uint64_t inputAssemblyPrimitives = 0;
+    uint64_t vertexShaderInvocations = 0;
+    uint64_t clippingInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentShaderInvocations = 0;
+    uint64_t computeShaderInvocations = 0;
+
+    Result &operator+=(const Result &other);
+  };
+
+  LvePipelineStatistics(LveDevice &device, uint32_t slotCount);
+  ~LvePipelineStatistics();
+
+  LvePipelineStatistics(const LvePipelineStatistics &) = delete;
+  LvePipelineStatistics &operator=(const LvePipelineStatistics &) = delete;
+
+  // Both into the same command buffer, outside a render pass
+  void begin(VkCommandBuffer commandBuffer, uint32_t slot);
+  void end(VkCommandBuffer commandBuffer, uint32_t slot);
+  // Once the submission of the slot's command buffer completed, e.g. after its fence signaled.
+  // Returns false if the slot holds no finished range.
+  bool collect(uint32_t slot);
+
+  const Result &lastResult() const { return last; }
+  const Result &totals() const { return total; }
+  uint64_t rangeCount() const { return ranges; }
+  // Per range averages over every range collected so far
+  void printStats() const;
+
+ private:
+  static constexpr uint32_t STATISTIC_COUNT = sizeof(Result) / sizeof(uint64_t);
+
+  LveDevice &lveDevice;
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  // whether each slot's query was begun and ended since it was last collected
+  std::vector<bool> pending;
+
+  Result last;
+  Result total;
+  uint64_t ranges = 0;
+};
+
+}  // namespace lve
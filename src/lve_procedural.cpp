@@ -0,0 +1,99 @@
+#include "lve_procedural.hpp"
+
+// std
+#include <cassert>
+
+namespace lve {
+
+namespace {
+
+// 3^depth triangles of three vertices, depth 19 is the last one that fits 32 bits
+constexpr uint32_t MAX_SIERPINSKI_DEPTH = 19;
+// Below this many triangles splitting costs more than it saves
+constexpr uint32_t MIN_PARALLEL_TRIANGLES = 3 * 3 * 3 * 3 * 3 * 3;
+// Subtrees per thread, so a thread that got descheduled doesn't hold up the others
+constexpr uint32_t SUBTREES_PER_THREAD = 4;
+
+uint32_t pow3(uint32_t exponent) {
+  uint32_t result = 1;
+  for (uint32_t i = 0; i < exponent; i++) result *= 3;
+  return result;
+}
+
+struct Triangle {
+  glm::vec2 left;
+  glm::vec2 right;
+  glm::vec2 top;
+
+  Triangle child(uint32_t index) const {
+    auto leftTop = 0.5f * (left + top);
+    auto rightTop = 0.5f * (right + top);
+    auto leftRight = 0.5f * (left + right);
+    switch (index) {
+      case 0:
+        return {left, leftRight, leftTop};
+      case 1:
+        return {leftRight, right, rightTop};
+      default:
+        return {leftTop, rightTop, top};
+    }
+  }
+};
+
+// https://pastebin.com/0bu2a2ZP, returns one past the last vertex written
+LveModel::Vertex *generateSubtree(LveModel::Vertex *out, uint32_t depth, const Triangle &triangle) {
+  if (depth == 0) {
+    out[0] = {triangle.top, {1.f, 0.f, 0.f}};
+    out[1] = {triangle.right, {0.f, 1.f, 0.f}};
+    out[2] = {triangle.left, {0.f, 0.f, 1.f}};
+    return out + 3;
+  }
+  for (uint32_t i = 0; i < 3; i++) {
+    out = generateSubtree(out, depth - 1, triangle.child(i));
+  }
+  return out;
+}
+
+}  // namespace
+
+uint32_t LveSierpinski::vertexCount() const {
+  assert(depth <= MAX_SIERPINSKI_DEPTH && "Sierpinski depth overflows the vertex count");
+  return 3 * pow3(depth);
+}
+
+void LveSierpinski::generate(LveModel::Vertex *vertices, LveThreadPool *threadPool) const {
+  assert(depth <= MAX_SIERPINSKI_DEPTH && "Sierpinski depth overflows the vertex count");
+  Triangle root{left, right, top};
+
+  uint32_t triangles = pow3(depth);
+  if (threadPool == nullptr || threadPool->workerCount() == 0 ||
+      triangles < MIN_PARALLEL_TRIANGLES) {
+    generateSubtree(vertices, depth, root);
+    return;
+  }
+
+  // Shallowest level with enough subtrees to keep every thread busy
+  size_t threads = threadPool->workerCount() + 1;
+  uint32_t splitDepth = 0;
+  while (splitDepth < depth && pow3(splitDepth) < threads * SUBTREES_PER_THREAD) {
+    splitDepth++;
+  }
+
+  uint32_t subtrees = pow3(splitDepth);
+  uint32_t subtreeDepth = depth - splitDepth;
+  uint32_t subtreeVertices = 3 * pow3(subtreeDepth);
+
+  threadPool->parallelFor(subtrees, [&](size_t subtree) {
+    // base 3 digits of the subtree index, most significant first, are the children taken on
+    // the way down, which keeps the output order of the serial recursion
+    Triangle triangle = root;
+    uint32_t stride = subtrees / 3;
+    for (uint32_t level = 0; level < splitDepth; level++) {
+      triangle = triangle.child(static_cast<uint32_t>(subtree / stride % 3));
+      stride /= 3;
+    }
+    generateSubtree(vertices + subtree * subtreeVertices, subtreeDepth, triangle);
+  });
+}
+
+}  // namespace lve
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "lve_model.hpp"
+#include "lve_thread_pool.hpp"
+
+// std
+#include <cstdint>
+
+namespace lve {
+
+// Sierpinski triangle subdivided depth times. The vertex count is known before generating, so
+// callers allocate once (or hand in a mapped vertex buffer, see LveModel) and the generator
+// writes every vertex exactly once, in the same order as a plain depth first recursion.
+struct LveSierpinski {
+  uint32_t depth = 0;
+  glm::vec2 left;
+  glm::vec2 right;
+  glm::vec2 top;
+
+  uint32_t vertexCount() const;
+
+  // Fills vertices[0, vertexCount()). With a thread pool the recursion is cut a few levels
+  // down and the subtrees are generated in parallel into their disjoint ranges of vertices.
+  void generate(LveModel::Vertex *vertices, LveThreadPool *threadPool = nullptr) const;
+};
+
+}  // namespace lve
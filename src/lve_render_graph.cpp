@@ -0,0 +1,779 @@
+#include "lve_render_graph.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+struct UsageInfo {
+  VkPipelineStageFlags2KHR stage;
+  VkAccessFlags2KHR readAccess;
+  VkAccessFlags2KHR writeAccess;
+  VkImageLayout layout;
+  VkImageUsageFlags imageUsage;
+  VkBufferUsageFlags bufferUsage;
+};
+
+UsageInfo usageInfo(LveResourceUsage usage) {
+  switch (usage) {
+    case LveResourceUsage::ColorAttachment:
+      return {
+          VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+          VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR,
+          VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR,
+          VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+          VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+          0};
+    case LveResourceUsage::DepthAttachment:
+      // depth testing reads the attachment even when the pass only writes it
+      return {
+          VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR |
+              VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR,
+          VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR,
+          VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR |
+              VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR,
+          VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+          VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+          0};
+    case LveResourceUsage::SampledFragment:
+      return {
+          VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR,
+          VK_ACCESS_2_SHADER_READ_BIT_KHR,
+          0,
+          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+          VK_IMAGE_USAGE_SAMPLED_BIT,
+          0};
+    case LveResourceUsage::SampledCompute:
+      return {
+          VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR,
+          VK_ACCESS_2_SHADER_READ_BIT_KHR,
+          0,
+          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+          VK_IMAGE_USAGE_SAMPLED_BIT,
+          0};
+    case LveResourceUsage::Storage:
+      return {
+          VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR,
+          VK_ACCESS_2_SHADER_READ_BIT_KHR,
+          VK_ACCESS_2_SHADER_WRITE_BIT_KHR,
+          VK_IMAGE_LAYOUT_GENERAL,
+          VK_IMAGE_USAGE_STORAGE_BIT,
+          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT};
+    case LveResourceUsage::TransferSrc:
+      return {
+          VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR,
+          VK_ACCESS_2_TRANSFER_READ_BIT_KHR,
+          0,
+          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+          VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+          VK_BUFFER_USAGE_TRANSFER_SRC_BIT};
+    case LveResourceUsage::TransferDst:
+      return {
+          VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR,
+          0,
+          VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR,
+          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+          VK_BUFFER_USAGE_TRANSFER_DST_BIT};
+    case LveResourceUsage::VertexBuffer:
+      return {
+          VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT_KHR,
+          VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT_KHR,
+          0,
+          VK_IMAGE_LAYOUT_UNDEFINED,
+          0,
+          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT};
+    case LveResourceUsage::IndexBuffer:
+      return {
+          VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT_KHR,
+          VK_ACCESS_2_INDEX_READ_BIT_KHR,
+          0,
+          VK_IMAGE_LAYOUT_UNDEFINED,
+          0,
+          VK_BUFFER_USAGE_INDEX_BUFFER_BIT};
+    case LveResourceUsage::IndirectBuffer:
+      return {
+          VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT_KHR,
+          VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT_KHR,
+          0,
+          VK_IMAGE_LAYOUT_UNDEFINED,
+          0,
+          VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT};
+    case LveResourceUsage::UniformBuffer:
+      return {
+          VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR |
+              VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR,
+          VK_ACCESS_2_UNIFORM_READ_BIT_KHR,
+          0,
+          VK_IMAGE_LAYOUT_UNDEFINED,
+          0,
+          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT};
+  }
+  throw std::runtime_error("render graph: unknown resource usage");
+}
+
+VkImageAspectFlags aspectForFormat(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_S8_UINT:
+      return VK_IMAGE_ASPECT_STENCIL_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+      return VK_IMAGE_ASPECT_COLOR_BIT;
+  }
+}
+
+// One pass' combined use of a resource
+struct PassUse {
+  LveRenderGraph::Resource resource;
+  VkPipelineStageFlags2KHR stage;
+  VkAccessFlags2KHR access;
+  VkAccessFlags2KHR writeAccess;
+  VkImageLayout layout;
+  bool write;
+};
+
+}  // namespace
+
+void LveRenderGraph::PassBuilder::read(Resource resource, LveResourceUsage usage) {
+  graph.passes[pass].accesses.push_back({resource, usage, false});
+}
+
+void LveRenderGraph::PassBuilder::write(Resource resource, LveResourceUsage usage) {
+  graph.passes[pass].accesses.push_back({resource, usage, true});
+}
+
+void LveRenderGraph::PassBuilder::sideEffects() { graph.passes[pass].sideEffects = true; }
+
+LveRenderGraph::LveRenderGraph(LveDevice &device) : lveDevice{device} {}
+
+LveRenderGraph::~LveRenderGraph() { destroyTransientResources(); }
+
+LveRenderGraph::Resource LveRenderGraph::addResource(ResourceInfo info) {
+  assert(!compiled && "Cannot add resources to a compiled render graph");
+  resources.push_back(std::move(info));
+  return static_cast<Resource>(resources.size() - 1);
+}
+
+LveRenderGraph::Resource LveRenderGraph::importImage(
+    const std::string &name,
+    VkImage image,
+    VkImageView view,
+    VkImageAspectFlags aspect,
+    VkImageLayout initialLayout,
+    VkImageLayout finalLayout) {
+  ResourceInfo info{};
+  info.name = name;
+  info.isImage = true;
+  info.imported = true;
+  info.aspect = aspect;
+  info.initialLayout = initialLayout;
+  info.finalLayout = finalLayout;
+  info.image = image;
+  info.view = view;
+  return addResource(std::move(info));
+}
+
+LveRenderGraph::Resource LveRenderGraph::importBuffer(
+    const std::string &name, VkBuffer buffer, VkDeviceSize size) {
+  ResourceInfo info{};
+  info.name = name;
+  info.isImage = false;
+  info.imported = true;
+  info.size = size;
+  info.buffer = buffer;
+  return addResource(std::move(info));
+}
+
+void LveRenderGraph::setImage(Resource resource, VkImage image, VkImageView view) {
+  assert(resources[resource].imported && "Only imported images can be replaced");
+  resources[resource].image = image;
+  resources[resource].view = view;
+}
+
+void LveRenderGraph::setBuffer(Resource resource, VkBuffer buffer) {
+  assert(resources[resource].imported && "Only imported buffers can be replaced");
+  resources[resource].buffer = buffer;
+}
+
+LveRenderGraph::Resource LveRenderGraph::createImage(
+    const std::string &name, const ImageDesc &desc) {
+  ResourceInfo info{};
+  info.name = name;
+  info.isImage = true;
+  info.imported = false;
+  info.imageDesc = desc;
+  info.aspect = aspectForFormat(desc.format);
+  return addResource(std::move(info));
+}
+
+LveRenderGraph::Resource LveRenderGraph::createBuffer(const std::string &name, VkDeviceSize size) {
+  ResourceInfo info{};
+  info.name = name;
+  info.isImage = false;
+  info.imported = false;
+  info.size = size;
+  return addResource(std::move(info));
+}
+
+void LveRenderGraph::addPass(
+    const std::string &name, const SetupFunction &setup, ExecuteFunction execute) {
+  assert(!compiled && "Cannot add passes to a compiled render graph");
+  passes.push_back({});
+  passes.back().name = name;
+  passes.back().execute = std::move(execute);
+
+  PassBuilder builder{*this, passes.size() - 1};
+  setup(builder);
+
+  for (const auto &access : passes.back().accesses) {
+    if (access.resource >= resources.size()) {
+      throw std::runtime_error("render graph: pass " + name + " uses an unknown resource");
+    }
+    ResourceInfo &resource = resources[access.resource];
+    UsageInfo info = usageInfo(access.usage);
+    if ((access.write ? info.writeAccess : info.readAccess) == 0 ||
+        (resource.isImage ? info.imageUsage : info.bufferUsage) == 0) {
+      throw std::runtime_error(
+          "render graph: pass " + name + " uses " + resource.name + " in an unsupported way");
+    }
+    resource.imageUsage |= info.imageUsage;
+    resource.bufferUsage |= info.bufferUsage;
+  }
+}
+
+void LveRenderGraph::compile() {
+  assert(!compiled && "Render graph already compiled");
+
+  cullPasses();
+  computeLifetimes();
+  createTransientResources();
+  computeBarriers();
+  compiled = true;
+}
+
+void LveRenderGraph::cullPasses() {
+  // Walk backwards from everything that leaves the graph, a pass survives if something that
+  // survives reads what it writes
+  std::vector<bool> needed(resources.size(), false);
+  for (size_t i = 0; i < resources.size(); i++) {
+    needed[i] = resources[i].imported;
+  }
+
+  stats_.passes = static_cast<uint32_t>(passes.size());
+  stats_.culledPasses = 0;
+  for (auto pass = passes.rbegin(); pass != passes.rend(); ++pass) {
+    bool keep = pass->sideEffects;
+    for (const auto &access : pass->accesses) {
+      keep = keep || (access.write && needed[access.resource]);
+    }
+
+    pass->culled = !keep;
+    if (!keep) {
+      stats_.culledPasses++;
+      continue;
+    }
+    for (const auto &access : pass->accesses) {
+      if (!access.write) needed[access.resource] = true;
+    }
+  }
+}
+
+void LveRenderGraph::computeLifetimes() {
+  for (uint32_t i = 0; i < passes.size(); i++) {
+    if (passes[i].culled) continue;
+    for (const auto &access : passes[i].accesses) {
+      ResourceInfo &resource = resources[access.resource];
+      resource.firstPass = std::min(resource.firstPass, i);
+      resource.lastPass = std::max(resource.lastPass, i);
+    }
+  }
+}
+
+void LveRenderGraph::createTransientResources() {
+  std::vector<Resource> transients;
+  stats_.transientAttachments = 0;
+  stats_.lazilyAllocated = 0;
+  for (Resource i = 0; i < resources.size(); i++) {
+    ResourceInfo &resource = resources[i];
+    // transients only used by culled passes are never created
+    if (resource.imported || resource.firstPass == UINT32_MAX) continue;
+    transients.push_back(i);
+
+    if (resource.isImage) {
+      // Attachments whose contents never leave the pass they're used in can stay in tile memory
+      // on tilers, they're created as transient attachments like LveSwapChain's depth and MSAA
+      // color images
+      constexpr VkImageUsageFlags ATTACHMENT_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                                     VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                                     VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+      VkImageUsageFlags usage = resource.imageUsage;
+      bool transientAttachment =
+          (usage & ~ATTACHMENT_USAGE) == 0 && resource.firstPass == resource.lastPass;
+      if (transientAttachment) {
+        usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        stats_.transientAttachments++;
+      }
+
+      VkImageCreateInfo imageInfo{};
+      imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+      imageInfo.imageType = VK_IMAGE_TYPE_2D;
+      imageInfo.extent.width = resource.imageDesc.extent.width;
+      imageInfo.extent.height = resource.imageDesc.extent.height;
+      imageInfo.extent.depth = 1;
+      imageInfo.mipLevels = 1;
+      imageInfo.arrayLayers = 1;
+      imageInfo.format = resource.imageDesc.format;
+      imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+      imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+      imageInfo.usage = usage;
+      imageInfo.samples = resource.imageDesc.samples;
+      imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+      if (vkCreateImage(lveDevice.device(), &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+        throw std::runtime_error("render graph: failed to create image " + resource.name);
+      }
+      vkGetImageMemoryRequirements(lveDevice.device(), resource.image, &resource.requirements);
+
+      uint32_t memoryTypeIndex;
+      resource.lazilyAllocated =
+          transientAttachment &&
+          lveDevice.tryFindMemoryType(
+              resource.requirements.memoryTypeBits,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+              memoryTypeIndex);
+      if (resource.lazilyAllocated) stats_.lazilyAllocated++;
+    } else {
+      VkBufferCreateInfo bufferInfo{};
+      bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+      bufferInfo.size = resource.size;
+      bufferInfo.usage = resource.bufferUsage;
+      bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+      if (vkCreateBuffer(lveDevice.device(), &bufferInfo, nullptr, &resource.buffer) !=
+          VK_SUCCESS) {
+        throw std::runtime_error("render graph: failed to create buffer " + resource.name);
+      }
+      vkGetBufferMemoryRequirements(lveDevice.device(), resource.buffer, &resource.requirements);
+    }
+  }
+
+  assignMemoryBlocks(transients);
+
+  stats_.transientResources = static_cast<uint32_t>(transients.size());
+  stats_.memoryBlocks = static_cast<uint32_t>(memoryBlocks.size());
+  stats_.transientMemory = 0;
+  stats_.unaliasedMemory = 0;
+  for (Resource i : transients) {
+    stats_.unaliasedMemory += resources[i].requirements.size;
+  }
+
+  for (auto &block : memoryBlocks) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = block.size;
+    allocInfo.memoryTypeIndex = lveDevice.findMemoryType(
+        block.memoryTypeBits,
+        block.lazilyAllocated
+            ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT
+            : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (lveDevice.allocateMemory(allocInfo, block.memory) != VK_SUCCESS) {
+      throw std::runtime_error("render graph: failed to allocate transient memory");
+    }
+    stats_.transientMemory += block.size;
+
+    // every resource in a block starts at offset 0, aliasing the ones it doesn't overlap with
+    for (Resource i : block.resources) {
+      ResourceInfo &resource = resources[i];
+      if (resource.isImage) {
+        vkBindImageMemory(lveDevice.device(), resource.image, block.memory, 0);
+      } else {
+        vkBindBufferMemory(lveDevice.device(), resource.buffer, block.memory, 0);
+      }
+    }
+  }
+
+  for (Resource i : transients) {
+    ResourceInfo &resource = resources[i];
+    if (!resource.isImage) continue;
+
+    // depth/stencil images are viewed through their depth aspect
+    VkImageAspectFlags viewAspect = resource.aspect;
+    if (viewAspect & VK_IMAGE_ASPECT_DEPTH_BIT) viewAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = resource.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = resource.imageDesc.format;
+    viewInfo.subresourceRange.aspectMask = viewAspect;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(lveDevice.device(), &viewInfo, nullptr, &resource.view) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("render graph: failed to create image view " + resource.name);
+    }
+  }
+}
+
+void LveRenderGraph::assignMemoryBlocks(const std::vector<Resource> &transients) {
+  // Largest first, each resource goes into the first block whose memory type fits and whose
+  // resources are all dead before it starts or born after it ends
+  std::vector<Resource> order = transients;
+  std::sort(order.begin(), order.end(), [this](Resource a, Resource b) {
+    return resources[a].requirements.size > resources[b].requirements.size;
+  });
+
+  for (Resource i : order) {
+    ResourceInfo &resource = resources[i];
+    uint32_t memoryTypeIndex;
+
+    // lazily allocated resources get a block of their own and nothing is placed in it
+    for (uint32_t b = 0; b < memoryBlocks.size() && resource.memoryBlock == UINT32_MAX &&
+                         !resource.lazilyAllocated;
+         b++) {
+      MemoryBlock &block = memoryBlocks[b];
+      if (block.lazilyAllocated) continue;
+      uint32_t typeBits = block.memoryTypeBits & resource.requirements.memoryTypeBits;
+      if (!lveDevice.tryFindMemoryType(
+              typeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryTypeIndex)) {
+        continue;
+      }
+
+      bool overlaps =
+          std::any_of(block.resources.begin(), block.resources.end(), [&](Resource other) {
+            return resource.firstPass <= resources[other].lastPass &&
+                   resources[other].firstPass <= resource.lastPass;
+          });
+      if (overlaps) continue;
+
+      block.memoryTypeBits = typeBits;
+      block.size = std::max(block.size, resource.requirements.size);
+      block.resources.push_back(i);
+      resource.memoryBlock = b;
+    }
+
+    if (resource.memoryBlock == UINT32_MAX) {
+      MemoryBlock block{};
+      block.size = resource.requirements.size;
+      block.memoryTypeBits = resource.requirements.memoryTypeBits;
+      block.lazilyAllocated = resource.lazilyAllocated;
+      block.resources.push_back(i);
+      resource.memoryBlock = static_cast<uint32_t>(memoryBlocks.size());
+      memoryBlocks.push_back(std::move(block));
+    }
+  }
+}
+
+void LveRenderGraph::computeBarriers() {
+  barriers.assign(passes.size() + 1, {});
+
+  std::vector<SyncState> states(resources.size());
+  for (size_t i = 0; i < resources.size(); i++) {
+    states[i].layout = resources[i].initialLayout;
+  }
+  // State the last resource to use each block left it in. The block's first resource has to
+  // wait for the last one from the previous execution, which may have used it any way its
+  // resources are used.
+  std::vector<SyncState> blockStates(memoryBlocks.size());
+  for (const auto &pass : passes) {
+    if (pass.culled) continue;
+    for (const auto &access : pass.accesses) {
+      const ResourceInfo &resource = resources[access.resource];
+      if (resource.imported) continue;
+      UsageInfo info = usageInfo(access.usage);
+      blockStates[resource.memoryBlock].writeStage |= info.stage;
+      blockStates[resource.memoryBlock].writeAccess |= info.writeAccess;
+    }
+  }
+
+  std::vector<PassUse> uses;
+  for (uint32_t p = 0; p < passes.size(); p++) {
+    if (passes[p].culled) continue;
+
+    // merge every access to the same resource, a pass sees a single state per resource
+    uses.clear();
+    for (const auto &access : passes[p].accesses) {
+      UsageInfo info = usageInfo(access.usage);
+      VkAccessFlags2KHR accessFlags = access.write ? info.writeAccess : info.readAccess;
+      VkImageLayout layout =
+          resources[access.resource].isImage ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+      auto use = std::find_if(uses.begin(), uses.end(), [&](const PassUse &u) {
+        return u.resource == access.resource;
+      });
+      if (use == uses.end()) {
+        uses.push_back(
+            {access.resource,
+             info.stage,
+             accessFlags,
+             access.write ? info.writeAccess : 0,
+             layout,
+             access.write});
+        continue;
+      }
+      if (use->layout != layout) {
+        throw std::runtime_error(
+            "render graph: pass " + passes[p].name + " needs " +
+            resources[access.resource].name + " in two layouts");
+      }
+      use->stage |= info.stage;
+      use->access |= accessFlags;
+      use->writeAccess |= access.write ? info.writeAccess : 0;
+      use->write = use->write || access.write;
+    }
+
+    for (const auto &use : uses) {
+      ResourceInfo &resource = resources[use.resource];
+      SyncState &state = states[use.resource];
+
+      // a transient's first use has to wait for whatever used its memory before
+      if (!resource.imported && p == resource.firstPass) {
+        const SyncState &previous = blockStates[resource.memoryBlock];
+        state.writeStage = previous.writeStage | previous.readStages;
+        state.writeAccess = previous.writeAccess;
+        state.readStages = 0;
+        state.readAccess = 0;
+        state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+      }
+
+      bool layoutChange = resource.isImage && state.layout != use.layout;
+      if (use.write || layoutChange) {
+        // write after write, write after read or a layout transition
+        VkPipelineStageFlags2KHR srcStage = state.writeStage | state.readStages;
+        if (srcStage != 0 || layoutChange) {
+          // nothing to wait for, use the destination stage so the transition still chains
+          // with semaphore waits on it (e.g. swap chain image acquisition)
+          if (srcStage == 0) srcStage = use.stage;
+          barriers[p].push_back(
+              {use.resource,
+               srcStage,
+               state.writeAccess,
+               use.stage,
+               use.access,
+               state.layout,
+               use.layout});
+        }
+
+        // a layout transition without writes behaves like a write that this pass already saw
+        state.writeStage = use.stage;
+        state.writeAccess = use.writeAccess;
+        state.readStages = use.write ? 0 : use.stage;
+        state.readAccess = use.write ? 0 : use.access;
+        state.layout = use.layout;
+      } else {
+        // read after write, unless an earlier barrier already made the write visible here
+        bool visible =
+            (use.stage & ~state.readStages) == 0 && (use.access & ~state.readAccess) == 0;
+        if (state.writeStage != 0 && !visible) {
+          barriers[p].push_back(
+              {use.resource,
+               state.writeStage,
+               state.writeAccess,
+               use.stage,
+               use.access,
+               state.layout,
+               state.layout});
+        }
+        state.readStages |= use.stage;
+        state.readAccess |= use.access;
+      }
+
+      if (!resource.imported && p == resource.lastPass) {
+        blockStates[resource.memoryBlock] = state;
+      }
+    }
+  }
+
+  // hand imported images back in the layout the caller expects
+  auto &finalBarriers = barriers.back();
+  for (Resource i = 0; i < resources.size(); i++) {
+    const ResourceInfo &resource = resources[i];
+    const SyncState &state = states[i];
+    if (!resource.imported || !resource.isImage ||
+        resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || state.layout == resource.finalLayout) {
+      continue;
+    }
+    VkPipelineStageFlags2KHR srcStage = state.writeStage | state.readStages;
+    finalBarriers.push_back(
+        {i,
+         srcStage ? srcStage : VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT_KHR,
+         state.writeAccess,
+         VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT_KHR,
+         0,
+         state.layout,
+         resource.finalLayout});
+  }
+
+  stats_.barrierBatches = 0;
+  stats_.imageBarriers = 0;
+  stats_.bufferBarriers = 0;
+  for (const auto &batch : barriers) {
+    if (batch.empty()) continue;
+    stats_.barrierBatches++;
+    for (const auto &barrier : batch) {
+      if (resources[barrier.resource].isImage) {
+        stats_.imageBarriers++;
+      } else {
+        stats_.bufferBarriers++;
+      }
+    }
+  }
+}
+
+void LveRenderGraph::execute(VkCommandBuffer commandBuffer) {
+  assert(compiled && "Render graph has to be compiled before executing it");
+
+  for (size_t i = 0; i < passes.size(); i++) {
+    if (passes[i].culled) continue;
+    recordBarriers(commandBuffer, barriers[i]);
+    passes[i].execute(commandBuffer);
+  }
+  recordBarriers(commandBuffer, barriers.back());
+}
+
+void LveRenderGraph::recordBarriers(
+    VkCommandBuffer commandBuffer, const std::vector<Barrier> &batch) {
+  if (batch.empty()) return;
+
+  if (lveDevice.synchronization2Enabled()) {
+    std::vector<VkImageMemoryBarrier2KHR> imageBarriers;
+    std::vector<VkBufferMemoryBarrier2KHR> bufferBarriers;
+    imageBarriers.reserve(batch.size());
+    bufferBarriers.reserve(batch.size());
+
+    for (const auto &barrier : batch) {
+      const ResourceInfo &resource = resources[barrier.resource];
+      if (resource.isImage) {
+        VkImageMemoryBarrier2KHR &imageBarrier = imageBarriers.emplace_back();
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+        imageBarrier.srcStageMask = barrier.srcStage;
+        imageBarrier.srcAccessMask = barrier.srcAccess;
+        imageBarrier.dstStageMask = barrier.dstStage;
+        imageBarrier.dstAccessMask = barrier.dstAccess;
+        imageBarrier.oldLayout = barrier.oldLayout;
+        imageBarrier.newLayout = barrier.newLayout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = resource.image;
+        imageBarrier.subresourceRange = {
+            resource.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+      } else {
+        VkBufferMemoryBarrier2KHR &bufferBarrier = bufferBarriers.emplace_back();
+        bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR;
+        bufferBarrier.srcStageMask = barrier.srcStage;
+        bufferBarrier.srcAccessMask = barrier.srcAccess;
+        bufferBarrier.dstStageMask = barrier.dstStage;
+        bufferBarrier.dstAccessMask = barrier.dstAccess;
+        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.buffer = resource.buffer;
+        bufferBarrier.offset = 0;
+        bufferBarrier.size = VK_WHOLE_SIZE;
+      }
+    }
+
+    VkDependencyInfoKHR dependencyInfo{};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+    dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+    dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+    dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+    dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+    lveDevice.cmdPipelineBarrier2(commandBuffer, dependencyInfo);
+    return;
+  }
+
+  // Without synchronization2 the batch becomes one barrier with the union of its stages. The
+  // stage and access bits used by the graph have the same values in both APIs.
+  std::vector<VkImageMemoryBarrier> imageBarriers;
+  std::vector<VkBufferMemoryBarrier> bufferBarriers;
+  imageBarriers.reserve(batch.size());
+  bufferBarriers.reserve(batch.size());
+  VkPipelineStageFlags srcStages = 0;
+  VkPipelineStageFlags dstStages = 0;
+
+  for (const auto &barrier : batch) {
+    const ResourceInfo &resource = resources[barrier.resource];
+    srcStages |= static_cast<VkPipelineStageFlags>(barrier.srcStage);
+    dstStages |= static_cast<VkPipelineStageFlags>(barrier.dstStage);
+    if (resource.isImage) {
+      VkImageMemoryBarrier &imageBarrier = imageBarriers.emplace_back();
+      imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      imageBarrier.srcAccessMask = static_cast<VkAccessFlags>(barrier.srcAccess);
+      imageBarrier.dstAccessMask = static_cast<VkAccessFlags>(barrier.dstAccess);
+      imageBarrier.oldLayout = barrier.oldLayout;
+      imageBarrier.newLayout = barrier.newLayout;
+      imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      imageBarrier.image = resource.image;
+      imageBarrier.subresourceRange = {
+          resource.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+    } else {
+      VkBufferMemoryBarrier &bufferBarrier = bufferBarriers.emplace_back();
+      bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+      bufferBarrier.srcAccessMask = static_cast<VkAccessFlags>(barrier.srcAccess);
+      bufferBarrier.dstAccessMask = static_cast<VkAccessFlags>(barrier.dstAccess);
+      bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      bufferBarrier.buffer = resource.buffer;
+      bufferBarrier.offset = 0;
+      bufferBarrier.size = VK_WHOLE_SIZE;
+    }
+  }
+
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      srcStages ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      dstStages ? dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+      0,
+      0,
+      nullptr,
+      static_cast<uint32_t>(bufferBarriers.size()),
+      bufferBarriers.data(),
+      static_cast<uint32_t>(imageBarriers.size()),
+      imageBarriers.data());
+}
+
+void LveRenderGraph::destroyTransientResources() {
+  // the last frames recorded from this graph may still be executing
+  auto &deletionQueue = lveDevice.deletionQueue();
+  for (auto &resource : resources) {
+    if (resource.imported) continue;
+    deletionQueue.destroyImageView(resource.view);
+    deletionQueue.destroyImage(resource.image);
+    deletionQueue.destroyBuffer(resource.buffer);
+  }
+  for (auto &block : memoryBlocks) {
+    deletionQueue.freeMemory(block.memory);
+  }
+  memoryBlocks.clear();
+}
+
+void LveRenderGraph::printStats() {
+  constexpr double MiB = 1024.0 * 1024.0;
+  std::cout << "Render graph: " << stats_.passes - stats_.culledPasses << " passes ("
+            << stats_.culledPasses << " culled), " << stats_.imageBarriers + stats_.bufferBarriers
+            << " barriers in " << stats_.barrierBatches << " batches, "
+            << stats_.transientResources << " transient resources ("
+            << stats_.transientAttachments << " transient attachments, " << stats_.lazilyAllocated
+            << " lazily allocated) in " << stats_.memoryBlocks
+            << " blocks: " << stats_.transientMemory / MiB << " MiB ("
+            << stats_.unaliasedMemory / MiB << " MiB without aliasing)" << std::endl;
+}
+
+}  // namespace lve
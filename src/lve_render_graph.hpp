@@ -0,0 +1,211 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// How a pass uses a resource. Determines the stages, access and image layout barriers are
+// built from, and the usage flags transient resources are created with.
+enum class LveResourceUsage {
+  ColorAttachment,
+  DepthAttachment,
+  SampledFragment,
+  SampledCompute,
+  Storage,  // storage image or buffer in a compute shader
+  TransferSrc,
+  TransferDst,
+  VertexBuffer,
+  IndexBuffer,
+  IndirectBuffer,
+  UniformBuffer,
+};
+
+// Frame graph. Passes declare which images and buffers they read and write, compile() culls
+// passes whose results are never used, works out the barriers between passes and places
+// transient resources whose lifetimes don't overlap in the same memory, so a chain of passes
+// only needs memory for the resources alive at the same time.
+//
+// The graph is built and compiled once and can then be executed every frame. Imported
+// resources may point to a different handle each frame (e.g. the acquired swap chain image).
+// Transient resources are not synchronized between executions, use one graph per frame in
+// flight.
+class LveRenderGraph {
+ public:
+  using Resource = uint32_t;
+  static constexpr Resource INVALID_RESOURCE = UINT32_MAX;
+
+  struct ImageDesc {
+    VkFormat format;
+    VkExtent2D extent;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+  };
+
+  struct Stats {
+    uint32_t passes = 0;
+    uint32_t culledPasses = 0;
+    uint32_t barrierBatches = 0;
+    uint32_t imageBarriers = 0;
+    uint32_t bufferBarriers = 0;
+    uint32_t transientResources = 0;
+    uint32_t memoryBlocks = 0;
+    // attachments that never leave their pass, in lazily allocated memory where available
+    uint32_t transientAttachments = 0;
+    uint32_t lazilyAllocated = 0;
+    // memory allocated for transient resources and what they'd need without aliasing
+    VkDeviceSize transientMemory = 0;
+    VkDeviceSize unaliasedMemory = 0;
+  };
+
+  class PassBuilder {
+   public:
+    void read(Resource resource, LveResourceUsage usage);
+    void write(Resource resource, LveResourceUsage usage);
+    // Keeps the pass even if nothing reads what it writes
+    void sideEffects();
+
+   private:
+    friend class LveRenderGraph;
+    PassBuilder(LveRenderGraph &graph, size_t pass) : graph{graph}, pass{pass} {}
+
+    LveRenderGraph &graph;
+    size_t pass;
+  };
+
+  using SetupFunction = std::function<void(PassBuilder &)>;
+  using ExecuteFunction = std::function<void(VkCommandBuffer)>;
+
+  explicit LveRenderGraph(LveDevice &device);
+  ~LveRenderGraph();
+
+  LveRenderGraph(const LveRenderGraph &) = delete;
+  LveRenderGraph &operator=(const LveRenderGraph &) = delete;
+
+  // Resources owned outside the graph. Passes writing them are never culled. The image is
+  // expected in initialLayout when execute starts and is left in finalLayout.
+  Resource importImage(
+      const std::string &name,
+      VkImage image,
+      VkImageView view,
+      VkImageAspectFlags aspect,
+      VkImageLayout initialLayout,
+      VkImageLayout finalLayout);
+  Resource importBuffer(const std::string &name, VkBuffer buffer, VkDeviceSize size);
+  // Swaps the handle of an imported resource, takes effect on the next execute
+  void setImage(Resource resource, VkImage image, VkImageView view);
+  void setBuffer(Resource resource, VkBuffer buffer);
+
+  // Created by compile() with the usage flags of every declared use. Contents are undefined
+  // when the first pass using them starts, that pass has to write them. Images only used as
+  // attachments by a single pass become transient attachments in lazily allocated memory
+  // where the device has it, those are never aliased.
+  Resource createImage(const std::string &name, const ImageDesc &desc);
+  Resource createBuffer(const std::string &name, VkDeviceSize size);
+
+  // Passes execute in the order they are added. A pass that loads an attachment before writing
+  // it has to declare the read as well, otherwise the pass that produced it may be culled.
+  void addPass(const std::string &name, const SetupFunction &setup, ExecuteFunction execute);
+
+  void compile();
+  void execute(VkCommandBuffer commandBuffer);
+
+  VkImage image(Resource resource) { return resources[resource].image; }
+  VkImageView imageView(Resource resource) { return resources[resource].view; }
+  VkBuffer buffer(Resource resource) { return resources[resource].buffer; }
+
+  const Stats &stats() { return stats_; }
+  void printStats();
+
+ private:
+  struct ResourceInfo {
+    std::string name;
+    bool isImage;
+    bool imported;
+    ImageDesc imageDesc{};
+    VkImageUsageFlags imageUsage = 0;
+    VkImageAspectFlags aspect = 0;
+    VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkDeviceSize size = 0;
+    VkBufferUsageFlags bufferUsage = 0;
+
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkBuffer buffer = VK_NULL_HANDLE;
+
+    // first and last surviving pass using the resource
+    uint32_t firstPass = UINT32_MAX;
+    uint32_t lastPass = 0;
+    uint32_t memoryBlock = UINT32_MAX;
+    VkMemoryRequirements requirements{};
+    bool lazilyAllocated = false;
+  };
+
+  struct Access {
+    Resource resource;
+    LveResourceUsage usage;
+    bool write;
+  };
+
+  struct Pass {
+    std::string name;
+    std::vector<Access> accesses;
+    ExecuteFunction execute;
+    bool sideEffects = false;
+    bool culled = false;
+  };
+
+  struct Barrier {
+    Resource resource;
+    VkPipelineStageFlags2KHR srcStage;
+    VkAccessFlags2KHR srcAccess;
+    VkPipelineStageFlags2KHR dstStage;
+    VkAccessFlags2KHR dstAccess;
+    VkImageLayout oldLayout;
+    VkImageLayout newLayout;
+  };
+
+  // Synchronization state of a resource, or of a memory block between aliased resources
+  struct SyncState {
+    VkPipelineStageFlags2KHR writeStage = 0;
+    VkAccessFlags2KHR writeAccess = 0;
+    // reads since the last write that are already ordered after it
+    VkPipelineStageFlags2KHR readStages = 0;
+    VkAccessFlags2KHR readAccess = 0;
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+  };
+
+  struct MemoryBlock {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    uint32_t memoryTypeBits = 0;
+    // holds a single resource, lazily allocated memory is committed on demand and not aliased
+    bool lazilyAllocated = false;
+    std::vector<Resource> resources;
+  };
+
+  Resource addResource(ResourceInfo info);
+  void cullPasses();
+  void computeLifetimes();
+  void createTransientResources();
+  void assignMemoryBlocks(const std::vector<Resource> &transients);
+  void computeBarriers();
+  void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier> &batch);
+  void destroyTransientResources();
+
+  LveDevice &lveDevice;
+  std::vector<ResourceInfo> resources;
+  std::vector<Pass> passes;
+  std::vector<MemoryBlock> memoryBlocks;
+  // barriers[i] are recorded before pass i, the last batch returns imports to finalLayout
+  std::vector<std::vector<Barrier>> barriers;
+  bool compiled = false;
+  Stats stats_;
+};
+
+}  // namespace lve
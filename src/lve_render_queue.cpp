@@ -0,0 +1,124 @@
+#include "lve_render_queue.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+
+namespace lve {
+
+namespace {
+
+constexpr int PASS_SHIFT = 60;
+constexpr int PIPELINE_SHIFT = 48;
+constexpr int MATERIAL_SHIFT = 32;
+constexpr int MESH_SHIFT = 16;
+
+// Below this the 8 histograms of the radix sort cost more than comparing
+constexpr size_t RADIX_SORT_MIN_DRAWS = 256;
+
+// A new pass starts from nothing bound, a new pipeline may come with a different layout
+uint32_t stateChanges(uint64_t previous, uint64_t key, bool first) {
+  uint64_t pipelineBits = key >> PIPELINE_SHIFT;
+  uint64_t materialBits = (key >> MATERIAL_SHIFT) & 0xffff;
+  uint64_t meshBits = (key >> MESH_SHIFT) & 0xffff;
+  if (first || (previous >> PASS_SHIFT) != (key >> PASS_SHIFT)) {
+    return LveRenderQueue::PIPELINE | LveRenderQueue::MATERIAL | LveRenderQueue::MESH;
+  }
+
+  uint32_t changes = 0;
+  if ((previous >> PIPELINE_SHIFT) != pipelineBits) {
+    changes |= LveRenderQueue::PIPELINE | LveRenderQueue::MATERIAL;
+  }
+  if (((previous >> MATERIAL_SHIFT) & 0xffff) != materialBits) {
+    changes |= LveRenderQueue::MATERIAL;
+  }
+  if (((previous >> MESH_SHIFT) & 0xffff) != meshBits) {
+    changes |= LveRenderQueue::MESH;
+  }
+  return changes;
+}
+
+}  // namespace
+
+uint64_t LveRenderQueue::makeKey(
+    uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth) {
+  assert(pass < MAX_PASSES && pipeline < MAX_PIPELINES && "state id out of key range");
+  assert(material < MAX_MATERIALS && mesh < MAX_MESHES && "state id out of key range");
+
+  uint64_t quantizedDepth =
+      static_cast<uint64_t>(std::min(std::max(depth, 0.f), 1.f) * 65535.f + 0.5f);
+  return static_cast<uint64_t>(pass) << PASS_SHIFT |
+         static_cast<uint64_t>(pipeline) << PIPELINE_SHIFT |
+         static_cast<uint64_t>(material) << MATERIAL_SHIFT |
+         static_cast<uint64_t>(mesh) << MESH_SHIFT | quantizedDepth;
+}
+
+void LveRenderQueue::reserve(size_t drawCount) {
+  draws_.reserve(drawCount);
+  scratch.reserve(drawCount);
+}
+
+void LveRenderQueue::sort() {
+  stats_ = Stats{};
+  stats_.draws = static_cast<uint32_t>(draws_.size());
+  for (size_t i = 0; i < draws_.size(); i++) {
+    uint32_t changes = stateChanges(i > 0 ? draws_[i - 1].key : 0, draws_[i].key, i == 0);
+    stats_.unsortedPipelineBinds += (changes & PIPELINE) != 0;
+    stats_.unsortedMaterialBinds += (changes & MATERIAL) != 0;
+    stats_.unsortedMeshBinds += (changes & MESH) != 0;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  if (draws_.size() < RADIX_SORT_MIN_DRAWS) {
+    std::stable_sort(draws_.begin(), draws_.end(), [](const Draw &a, const Draw &b) {
+      return a.key < b.key;
+    });
+  } else {
+    radixSort();
+  }
+  stats_.sortMilliseconds =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  for (size_t i = 0; i < draws_.size(); i++) {
+    Draw &draw = draws_[i];
+    draw.changes = stateChanges(i > 0 ? draws_[i - 1].key : 0, draw.key, i == 0);
+    stats_.pipelineBinds += (draw.changes & PIPELINE) != 0;
+    stats_.materialBinds += (draw.changes & MATERIAL) != 0;
+    stats_.meshBinds += (draw.changes & MESH) != 0;
+  }
+}
+
+// 8 passes of 8 bits. All histograms are counted in one sweep, passes over a byte every key
+// shares (unused passes, a single pipeline) are skipped.
+void LveRenderQueue::radixSort() {
+  constexpr int DIGITS = 8;
+  size_t count = draws_.size();
+  std::array<std::array<uint32_t, 256>, DIGITS> histograms{};
+  for (const Draw &draw : draws_) {
+    for (int digit = 0; digit < DIGITS; digit++) {
+      histograms[digit][(draw.key >> (digit * 8)) & 0xff]++;
+    }
+  }
+
+  scratch.resize(count);
+  for (int digit = 0; digit < DIGITS; digit++) {
+    auto &histogram = histograms[digit];
+    int shift = digit * 8;
+    if (histogram[(draws_[0].key >> shift) & 0xff] == count) continue;
+
+    uint32_t offset = 0;
+    for (uint32_t &bucket : histogram) {
+      uint32_t bucketCount = bucket;
+      bucket = offset;
+      offset += bucketCount;
+    }
+    for (const Draw &draw : draws_) {
+      scratch[histogram[(draw.key >> shift) & 0xff]++] = draw;
+    }
+    draws_.swap(scratch);
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,87 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Orders a frame's draws by a 64 bit state key so draws sharing a pipeline, material and mesh
+// end up next to each other, and works out which of that state each draw actually has to bind.
+// The queue only deals in keys and the caller's draw indices, recording is left to the caller:
+//
+//   queue.clear();
+//   queue.add(LveRenderQueue::makeKey(pass, pipelineId, materialId, meshId, depth), drawIndex);
+//   queue.sort();
+//   for (auto &draw : queue.draws())
+//     if (draw.changes & LveRenderQueue::PIPELINE) ... bind, then draw
+//
+// Key layout, most significant first:
+//   pass 4 bits | pipeline 12 bits | material 16 bits | mesh 16 bits | depth 16 bits
+// Keys are sorted with an LSD radix sort, which is stable, so draws with equal keys keep their
+// submission order.
+class LveRenderQueue {
+ public:
+  // Bits of Draw::changes
+  enum StateChange : uint32_t {
+    PIPELINE = 1 << 0,
+    MATERIAL = 1 << 1,
+    MESH = 1 << 2,
+  };
+
+  struct Draw {
+    uint64_t key;
+    uint32_t index;    // as passed to add()
+    uint32_t changes;  // state to bind before this draw, set by sort()
+  };
+
+  // Of the last sort(). The unsorted counts are what the draws would have bound in the order
+  // they were added.
+  struct Stats {
+    uint32_t draws = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t materialBinds = 0;
+    uint32_t meshBinds = 0;
+    uint32_t unsortedPipelineBinds = 0;
+    uint32_t unsortedMaterialBinds = 0;
+    uint32_t unsortedMeshBinds = 0;
+    double sortMilliseconds = 0.0;
+
+    uint32_t binds() const { return pipelineBinds + materialBinds + meshBinds; }
+    uint32_t unsortedBinds() const {
+      return unsortedPipelineBinds + unsortedMaterialBinds + unsortedMeshBinds;
+    }
+    // negative if the sorted order binds more than the order the draws were added in
+    int64_t bindsAvoided() const {
+      return static_cast<int64_t>(unsortedBinds()) - static_cast<int64_t>(binds());
+    }
+  };
+
+  static constexpr uint32_t MAX_PASSES = 1 << 4;
+  static constexpr uint32_t MAX_PIPELINES = 1 << 12;
+  static constexpr uint32_t MAX_MATERIALS = 1 << 16;
+  static constexpr uint32_t MAX_MESHES = 1 << 16;
+
+  // depth in [0, 1], smaller draws first within the same state. Pass 1 - depth for back to front.
+  static uint64_t makeKey(
+      uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+  void reserve(size_t drawCount);
+  void clear() { draws_.clear(); }
+  void add(uint64_t key, uint32_t index) { draws_.push_back({key, index, 0}); }
+
+  void sort();
+
+  const std::vector<Draw> &draws() const { return draws_; }
+  const Stats &stats() const { return stats_; }
+
+ private:
+  void radixSort();
+
+  std::vector<Draw> draws_;
+  std::vector<Draw> scratch;
+  Stats stats_;
+};
+
+}  // namespace lve
@@ -0,0 +1,54 @@
+#include "lve_shader_module.hpp"
+#include "lve_embedded_shaders.hpp"
+
+// std
+#include <fstream>
+#include <stdexcept>
+
+namespace lve {
+
+  LveShaderModule::LveShaderModule(LveDevice &device, const std::string &filepath)
+    : lveDevice{device}, path{filepath} {
+    if (auto embedded = findEmbeddedShader(filepath)) {
+      createShaderModule(embedded->code, embedded->size);
+      return;
+    }
+
+    auto code = readFile(filepath);
+    createShaderModule(reinterpret_cast<const uint32_t*>(code.data()), code.size());
+  }
+
+  // Pipelines don't reference their shader modules once created, no need to defer this
+  LveShaderModule::~LveShaderModule() {
+    vkDestroyShaderModule(lveDevice.device(), shaderModule, nullptr);
+  }
+
+  std::vector<char> LveShaderModule::readFile(const std::string &filepath) {
+    std::ifstream file{ filepath, std::ios::ate | std::ios::binary };
+
+    if (!file.is_open()) {
+      throw std::runtime_error("failed to open file: " + filepath);
+    }
+
+    // The end of the file means the size of it
+    size_t fileSize = static_cast<size_t>(file.tellg());
+    std::vector<char> buffer(fileSize);
+
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+    file.close();
+
+    return buffer;
+  }
+
+  void LveShaderModule::createShaderModule(const uint32_t *code, size_t size) {
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = size;
+    createInfo.pCode = code;
+
+    if (vkCreateShaderModule(lveDevice.device(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create shader module");
+    }
+  }
+}
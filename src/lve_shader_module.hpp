@@ -0,0 +1,34 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lve {
+  // Owns a VkShaderModule. Shared between pipelines through LvePipelineRegistry so every
+  // SPIR-V file is read and handed to the driver once. Shaders embedded in the executable are
+  // used straight from the binary, the file on disk is only read for shaders that aren't.
+  class LveShaderModule {
+    public:
+      LveShaderModule(LveDevice &device, const std::string &filepath);
+      ~LveShaderModule();
+
+      LveShaderModule(const LveShaderModule&) = delete;
+      LveShaderModule& operator=(const LveShaderModule&) = delete;
+
+      VkShaderModule module() { return shaderModule; }
+      const std::string &filepath() { return path; }
+
+    private:
+      static std::vector<char> readFile(const std::string &filepath);
+
+      LveDevice &lveDevice;
+      VkShaderModule shaderModule;
+      std::string path;
+
+      void createShaderModule(const uint32_t *code, size_t size);
+  };
+}
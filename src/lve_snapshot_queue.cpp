@@ -0,0 +1,58 @@
+#include "lve_snapshot_queue.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+
+namespace lve {
+
+LveSnapshotQueue::LveSnapshotQueue(uint32_t slotCount) : slots(slotCount, SlotState::Free) {
+  assert(slotCount >= 2 && "The producer and the consumer need a slot each");
+  slots[writing] = SlotState::Writing;
+}
+
+bool LveSnapshotQueue::publish() {
+  std::unique_lock<std::mutex> lock{mutex};
+  if (closed) return false;
+
+  slots[writing] = SlotState::Published;
+  published.push_back(writing);
+  condition.notify_all();
+
+  auto freeSlot = slots.end();
+  condition.wait(lock, [&] {
+    freeSlot = std::find(slots.begin(), slots.end(), SlotState::Free);
+    return closed || freeSlot != slots.end();
+  });
+  if (closed) return false;
+
+  *freeSlot = SlotState::Writing;
+  writing = static_cast<uint32_t>(freeSlot - slots.begin());
+  return true;
+}
+
+bool LveSnapshotQueue::acquire(uint32_t &slot) {
+  std::unique_lock<std::mutex> lock{mutex};
+  // the previous snapshot is done with, the producer may be waiting for it
+  auto reading = std::find(slots.begin(), slots.end(), SlotState::Reading);
+  if (reading != slots.end()) {
+    *reading = SlotState::Free;
+    condition.notify_all();
+  }
+
+  condition.wait(lock, [this] { return closed || !published.empty(); });
+  if (closed) return false;
+
+  slot = published.front();
+  published.pop_front();
+  slots[slot] = SlotState::Reading;
+  return true;
+}
+
+void LveSnapshotQueue::close() {
+  std::lock_guard<std::mutex> lock{mutex};
+  closed = true;
+  condition.notify_all();
+}
+
+}  // namespace lve
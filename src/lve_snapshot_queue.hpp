@@ -0,0 +1,49 @@
+#pragma once
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace lve {
+
+// Hands snapshots from a producer thread to a consumer thread through a fixed set of slots the
+// caller owns, e.g. an array of per-frame render state. The producer fills writeSlot() while
+// the consumer reads the slot it acquired, so neither copies nor locks the state itself.
+// Snapshots are consumed in the order they were published. The producer runs at most
+// slotCount - 1 snapshots ahead: with 2 slots it prepares frame N + 1 while frame N is
+// consumed, with 3 it can also have N + 2 ready.
+class LveSnapshotQueue {
+ public:
+  explicit LveSnapshotQueue(uint32_t slotCount = 3);
+
+  LveSnapshotQueue(const LveSnapshotQueue &) = delete;
+  LveSnapshotQueue &operator=(const LveSnapshotQueue &) = delete;
+
+  // Producer side. The slot to fill next, the consumer doesn't touch it until it's published.
+  uint32_t writeSlot() const { return writing; }
+  // Queues writeSlot() for the consumer and blocks until another slot is free to write.
+  // Returns false once the queue is closed.
+  bool publish();
+
+  // Consumer side. Releases the slot acquired last and waits for the next published one.
+  // Returns false once the queue is closed.
+  bool acquire(uint32_t &slot);
+
+  // Wakes and fails every wait on both sides, from either thread
+  void close();
+
+ private:
+  enum class SlotState : uint8_t { Free, Writing, Published, Reading };
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::vector<SlotState> slots;
+  std::deque<uint32_t> published;
+  uint32_t writing = 0;
+  bool closed = false;
+};
+
+}  // namespace lve
@@ -1,6 +1,9 @@
 #include "lve_swap_chain.hpp"
 
+#include "lve_trace.hpp"
+
 // std
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <cstring>
@@ -10,13 +13,31 @@
 
 namespace lve {
 
-LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent)
+LveSwapChain::LveSwapChain(
+    LveDevice &deviceRef,
+    VkExtent2D extent,
+    VkSampleCountFlagBits requestedSamples,
+    bool dynamicRendering)
     : device{deviceRef}, windowExtent{extent} {
+    msaaSamples = std::min(requestedSamples, device.getMaxUsableSampleCount());
+    this->dynamicRendering = dynamicRendering && device.dynamicRenderingEnabled();
     init();
+    printSampleCountReport();
 }
 
-LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent, std::shared_ptr<LveSwapChain> previous)
+LveSwapChain::LveSwapChain(
+    LveDevice &deviceRef,
+    VkExtent2D extent,
+    std::shared_ptr<LveSwapChain> previous,
+    VkSampleCountFlagBits requestedSamples,
+    bool dynamicRendering)
     : device{deviceRef}, windowExtent{extent}, oldSwapChain(previous) {
+    msaaSamples = std::min(requestedSamples, device.getMaxUsableSampleCount());
+    this->dynamicRendering = dynamicRendering && device.dynamicRenderingEnabled();
+    if (previous) {
+      presentId = previous->presentId;
+      firstPresentId = presentId + 1;
+    }
     init();
 
     // Clean up old swap chain since it's no longer needed
@@ -26,45 +47,77 @@ LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent, std::shared_
 void LveSwapChain::init() {
   createSwapChain();
   createImageViews();
-  createRenderPass();
-  createDepthResources();
-  createFramebuffers();
+  swapChainDepthFormat = findDepthFormat();
+  // with dynamic rendering attachments are bound when recording, there is nothing to rebuild
+  if (!dynamicRendering) {
+    createRenderPass();
+    swapChainFramebuffers.assign(imageCount() * MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+  }
   createSyncObjects();
+
+  depthImages.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+  depthImageMemorys.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+  depthImageViews.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+  colorImages.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+  colorImageMemorys.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+  colorImageViews.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
 }
 
 
 LveSwapChain::~LveSwapChain() {
+  // frames still in flight may reference any of these, so retire them instead of waiting
+  auto &deletionQueue = device.deletionQueue();
+
+  for (auto framebuffer : swapChainFramebuffers) {
+    deletionQueue.destroyFramebuffer(framebuffer);
+  }
+
   for (auto imageView : swapChainImageViews) {
-    vkDestroyImageView(device.device(), imageView, nullptr);
+    deletionQueue.destroyImageView(imageView);
   }
   swapChainImageViews.clear();
 
   if (swapChain != nullptr) {
-    vkDestroySwapchainKHR(device.device(), swapChain, nullptr);
+    deletionQueue.destroySwapchain(swapChain);
     swapChain = nullptr;
   }
 
-  for (int i = 0; i < depthImages.size(); i++) {
-    vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-    vkDestroyImage(device.device(), depthImages[i], nullptr);
-    vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+  for (size_t i = 0; i < depthImages.size(); i++) {
+    deletionQueue.destroyImageView(depthImageViews[i]);
+    deletionQueue.destroyImage(depthImages[i]);
+    deletionQueue.freeMemory(depthImageMemorys[i]);
   }
 
-  for (auto framebuffer : swapChainFramebuffers) {
-    vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+  for (size_t i = 0; i < colorImages.size(); i++) {
+    deletionQueue.destroyImageView(colorImageViews[i]);
+    deletionQueue.destroyImage(colorImages[i]);
+    deletionQueue.freeMemory(colorImageMemorys[i]);
   }
 
-  vkDestroyRenderPass(device.device(), renderPass, nullptr);
+  deletionQueue.destroyRenderPass(renderPass);
 
-  // cleanup synchronization objects
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
-    vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-    vkDestroyFence(device.device(), inFlightFences[i], nullptr);
+  // cleanup synchronization objects, empty if they were handed over to a newer swap chain
+  for (auto semaphore : renderFinishedSemaphores) {
+    deletionQueue.destroySemaphore(semaphore);
+  }
+  for (auto semaphore : imageAvailableSemaphores) {
+    deletionQueue.destroySemaphore(semaphore);
+  }
+  for (auto fence : inFlightFences) {
+    deletionQueue.destroyFence(fence);
   }
 }
 
-VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex) {
+VkFramebuffer LveSwapChain::getFrameBuffer(int index) {
+  size_t framebufferIndex = index * MAX_FRAMES_IN_FLIGHT + currentFrame;
+  if (swapChainFramebuffers[framebufferIndex] == VK_NULL_HANDLE) {
+    createFrameAttachments(currentFrame);
+    createFramebuffer(index, currentFrame);
+  }
+  return swapChainFramebuffers[framebufferIndex];
+}
+
+void LveSwapChain::waitForFrameFence() {
   vkWaitForFences(
       device.device(),
       1,
@@ -72,6 +125,13 @@ VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex) {
       VK_TRUE,
       std::numeric_limits<uint64_t>::max());
 
+  device.deletionQueue().collect(inFlightFrames[currentFrame]);
+}
+
+VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex) {
+  LVE_TRACE_SCOPE("acquireNextImage");
+  waitForFrameFence();
+
   VkResult result = vkAcquireNextImageKHR(
       device.device(),
       swapChain,
@@ -85,6 +145,7 @@ VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex) {
 
 VkResult LveSwapChain::submitCommandBuffers(
     const VkCommandBuffer *buffers, uint32_t *imageIndex) {
+  LVE_TRACE_SCOPE("submitCommandBuffers");
   if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
     vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
   }
@@ -111,6 +172,7 @@ VkResult LveSwapChain::submitCommandBuffers(
       VK_SUCCESS) {
     throw std::runtime_error("failed to submit draw command buffer!");
   }
+  inFlightFrames[currentFrame] = device.deletionQueue().frameSubmitted();
 
   VkPresentInfoKHR presentInfo = {};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -124,6 +186,15 @@ VkResult LveSwapChain::submitCommandBuffers(
 
   presentInfo.pImageIndices = imageIndex;
 
+  presentId++;
+  VkPresentIdKHR presentIdInfo = {};
+  if (device.presentWaitEnabled()) {
+    presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentIdInfo.swapchainCount = 1;
+    presentIdInfo.pPresentIds = &presentId;
+    presentInfo.pNext = &presentIdInfo;
+  }
+
   auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
 
   currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
@@ -131,6 +202,13 @@ VkResult LveSwapChain::submitCommandBuffers(
   return result;
 }
 
+VkResult LveSwapChain::waitForPresent(uint64_t id, uint64_t timeout) {
+  if (!device.presentWaitEnabled() || id < firstPresentId || id > presentId) {
+    return VK_NOT_READY;
+  }
+  return device.waitForPresent(swapChain, id, timeout);
+}
+
 void LveSwapChain::createSwapChain() {
   SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
@@ -214,9 +292,11 @@ void LveSwapChain::createImageViews() {
 }
 
 void LveSwapChain::createRenderPass() {
+  bool multisampled = msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
   VkAttachmentDescription depthAttachment{};
-  depthAttachment.format = findDepthFormat();
-  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment.format = swapChainDepthFormat;
+  depthAttachment.samples = msaaSamples;
   depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
   depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
@@ -228,24 +308,43 @@ void LveSwapChain::createRenderPass() {
   depthAttachmentRef.attachment = 1;
   depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
+  // With multisampling attachment 0 is the transient MSAA target, it is resolved into the swap
+  // chain image at the end of the subpass and its samples are never written to memory
   VkAttachmentDescription colorAttachment = {};
   colorAttachment.format = getSwapChainImageFormat();
-  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  colorAttachment.samples = msaaSamples;
   colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.storeOp =
+      multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
   colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  colorAttachment.finalLayout =
+      multisampled ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
   VkAttachmentReference colorAttachmentRef = {};
   colorAttachmentRef.attachment = 0;
   colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+  VkAttachmentDescription resolveAttachment = {};
+  resolveAttachment.format = getSwapChainImageFormat();
+  resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  resolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  resolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  resolveAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  resolveAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+  VkAttachmentReference resolveAttachmentRef = {};
+  resolveAttachmentRef.attachment = 2;
+  resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
   VkSubpassDescription subpass = {};
   subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
   subpass.colorAttachmentCount = 1;
   subpass.pColorAttachments = &colorAttachmentRef;
+  subpass.pResolveAttachments = multisampled ? &resolveAttachmentRef : nullptr;
   subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
   VkSubpassDependency dependency = {};
@@ -259,10 +358,13 @@ void LveSwapChain::createRenderPass() {
   dependency.dstAccessMask =
       VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
-  std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+  std::array<VkAttachmentDescription, 3> attachments = {
+      colorAttachment,
+      depthAttachment,
+      resolveAttachment};
   VkRenderPassCreateInfo renderPassInfo = {};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.attachmentCount = multisampled ? 3 : 2;
   renderPassInfo.pAttachments = attachments.data();
   renderPassInfo.subpassCount = 1;
   renderPassInfo.pSubpasses = &subpass;
@@ -274,84 +376,180 @@ void LveSwapChain::createRenderPass() {
   }
 }
 
-void LveSwapChain::createFramebuffers() {
-  swapChainFramebuffers.resize(imageCount());
-  for (size_t i = 0; i < imageCount(); i++) {
-    std::array<VkImageView, 2> attachments = {swapChainImageViews[i], depthImageViews[i]};
-
-    VkExtent2D swapChainExtent = getSwapChainExtent();
-    VkFramebufferCreateInfo framebufferInfo = {};
-    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = renderPass;
-    framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-    framebufferInfo.pAttachments = attachments.data();
-    framebufferInfo.width = swapChainExtent.width;
-    framebufferInfo.height = swapChainExtent.height;
-    framebufferInfo.layers = 1;
-
-    if (vkCreateFramebuffer(
-            device.device(),
-            &framebufferInfo,
-            nullptr,
-            &swapChainFramebuffers[i]) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create framebuffer!");
-    }
+void LveSwapChain::createFramebuffer(size_t imageIndex, size_t frameIndex) {
+  std::vector<VkImageView> attachments;
+  if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+    attachments = {
+        colorImageViews[frameIndex],
+        depthImageViews[frameIndex],
+        swapChainImageViews[imageIndex]};
+  } else {
+    attachments = {swapChainImageViews[imageIndex], depthImageViews[frameIndex]};
+  }
+
+  VkExtent2D swapChainExtent = getSwapChainExtent();
+  VkFramebufferCreateInfo framebufferInfo = {};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = renderPass;
+  framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  framebufferInfo.pAttachments = attachments.data();
+  framebufferInfo.width = swapChainExtent.width;
+  framebufferInfo.height = swapChainExtent.height;
+  framebufferInfo.layers = 1;
+
+  if (vkCreateFramebuffer(
+          device.device(),
+          &framebufferInfo,
+          nullptr,
+          &swapChainFramebuffers[imageIndex * MAX_FRAMES_IN_FLIGHT + frameIndex]) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create framebuffer!");
+  }
+}
+
+void LveSwapChain::createFrameAttachments(size_t index) {
+  if (depthImages[index] != VK_NULL_HANDLE) {
+    return;
+  }
+  createDepthResources(index);
+  if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+    createColorResources(index);
   }
 }
 
-void LveSwapChain::createDepthResources() {
-  VkFormat depthFormat = findDepthFormat();
+void LveSwapChain::createDepthResources(size_t index) {
+  VkFormat depthFormat = swapChainDepthFormat;
   VkExtent2D swapChainExtent = getSwapChainExtent();
 
-  depthImages.resize(imageCount());
-  depthImageMemorys.resize(imageCount());
-  depthImageViews.resize(imageCount());
-
-  for (int i = 0; i < depthImages.size(); i++) {
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = swapChainExtent.width;
-    imageInfo.extent.height = swapChainExtent.height;
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = depthFormat;
-    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    imageInfo.flags = 0;
-
-    device.createImageWithInfo(
-        imageInfo,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        depthImages[i],
-        depthImageMemorys[i]);
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = swapChainExtent.width;
+  imageInfo.extent.height = swapChainExtent.height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = depthFormat;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  // depth is cleared on load and never stored, tilers can keep it entirely in tile memory
+  imageInfo.usage =
+      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+  imageInfo.samples = msaaSamples;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.flags = 0;
+
+  device.createImageWithInfo(
+      imageInfo,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      depthImages[index],
+      depthImageMemorys[index]);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = depthImages[index];
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = depthFormat;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+  viewInfo.subresourceRange.baseMipLevel = 0;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+
+  if (vkCreateImageView(device.device(), &viewInfo, nullptr, &depthImageViews[index]) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture image view!");
+  }
+}
 
-    VkImageViewCreateInfo viewInfo{};
-    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewInfo.image = depthImages[i];
-    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    viewInfo.format = depthFormat;
-    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-    viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
-    viewInfo.subresourceRange.baseArrayLayer = 0;
-    viewInfo.subresourceRange.layerCount = 1;
+void LveSwapChain::createColorResources(size_t index) {
+  VkExtent2D swapChainExtent = getSwapChainExtent();
 
-    if (vkCreateImageView(device.device(), &viewInfo, nullptr, &depthImageViews[i]) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create texture image view!");
-    }
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = swapChainExtent.width;
+  imageInfo.extent.height = swapChainExtent.height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = swapChainImageFormat;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage =
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+  imageInfo.samples = msaaSamples;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.flags = 0;
+
+  device.createImageWithInfo(
+      imageInfo,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      colorImages[index],
+      colorImageMemorys[index]);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = colorImages[index];
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = swapChainImageFormat;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.baseMipLevel = 0;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+
+  if (vkCreateImageView(device.device(), &viewInfo, nullptr, &colorImageViews[index]) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture image view!");
+  }
+}
+
+void LveSwapChain::printSampleCountReport() {
+  // Estimated attachment footprint per sample count, assuming 4 byte color and depth texels.
+  // Lazily allocated memory can keep most of this in tile memory on tiled GPUs. Nothing here
+  // is measured, frame times per sample count come from FrameBench --samples 1,2,4,8.
+  VkSampleCountFlagBits maxSamples = device.getMaxUsableSampleCount();
+  double pixels = static_cast<double>(swapChainExtent.width) * swapChainExtent.height;
+  double swapImagesMiB = pixels * 4.0 * imageCount() / (1024.0 * 1024.0);
+
+  std::cout << "MSAA: using " << msaaSamples << "x, device supports up to " << maxSamples << "x"
+            << std::endl;
+  for (uint32_t samples = 1; samples <= static_cast<uint32_t>(maxSamples); samples <<= 1) {
+    // single sampled rendering draws straight into the swap chain image
+    double bytesPerSample = samples > 1 ? 8.0 : 4.0;
+    double attachmentsMiB =
+        pixels * samples * bytesPerSample * MAX_FRAMES_IN_FLIGHT / (1024.0 * 1024.0);
+    std::cout << "\t" << samples << "x: " << samples << " coverage samples per pixel, "
+              << attachmentsMiB << " MiB attachments (estimated) + " << swapImagesMiB
+              << " MiB swap chain"
+              << (samples == static_cast<uint32_t>(msaaSamples) ? " (active)" : "") << std::endl;
   }
 }
 
 void LveSwapChain::createSyncObjects() {
+  imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+
+  // Frames submitted through the previous swap chain are only tracked by its fences, take them
+  // over so waiting on a frame slot still covers work that is in flight across the recreation
+  if (oldSwapChain) {
+    imageAvailableSemaphores = std::move(oldSwapChain->imageAvailableSemaphores);
+    renderFinishedSemaphores = std::move(oldSwapChain->renderFinishedSemaphores);
+    inFlightFences = std::move(oldSwapChain->inFlightFences);
+    inFlightFrames = std::move(oldSwapChain->inFlightFrames);
+    currentFrame = oldSwapChain->currentFrame;
+    oldSwapChain->imageAvailableSemaphores.clear();
+    oldSwapChain->renderFinishedSemaphores.clear();
+    oldSwapChain->inFlightFences.clear();
+    oldSwapChain->inFlightFrames.clear();
+    return;
+  }
+
   imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
   renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
   inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-  imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+  inFlightFrames.resize(MAX_FRAMES_IN_FLIGHT, 0);
 
   VkSemaphoreCreateInfo semaphoreInfo = {};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -15,19 +15,38 @@ class LveSwapChain {
  public:
   static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
-  LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent);
-  LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<LveSwapChain> previous);
+  // requestedSamples is clamped to what the device supports for color and depth attachments.
+  // dynamicRendering drops the render pass and framebuffers when the device supports it, the
+  // caller then provides the depth and multisampled attachments (see LveRenderGraph).
+  LveSwapChain(
+      LveDevice &deviceRef,
+      VkExtent2D windowExtent,
+      VkSampleCountFlagBits requestedSamples = VK_SAMPLE_COUNT_1_BIT,
+      bool dynamicRendering = false);
+  LveSwapChain(
+      LveDevice &deviceRef,
+      VkExtent2D windowExtent,
+      std::shared_ptr<LveSwapChain> previous,
+      VkSampleCountFlagBits requestedSamples = VK_SAMPLE_COUNT_1_BIT,
+      bool dynamicRendering = false);
   ~LveSwapChain();
 
   LveSwapChain(const LveSwapChain&) = delete;
   LveSwapChain& operator=(const LveSwapChain&) = delete;
 
-  VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
+  // Framebuffer for the given image and the current frame slot, which owns the depth and
+  // multisampled color attachments. Framebuffers and attachments are created on first use.
+  VkFramebuffer getFrameBuffer(int index);
+  // VK_NULL_HANDLE with dynamic rendering
   VkRenderPass getRenderPass() { return renderPass; }
+  VkImage getImage(int index) { return swapChainImages[index]; }
   VkImageView getImageView(int index) { return swapChainImageViews[index]; }
   size_t imageCount() { return swapChainImages.size(); }
   VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
   VkExtent2D getSwapChainExtent() { return swapChainExtent; }
+  VkFormat getSwapChainDepthFormat() { return swapChainDepthFormat; }
+  VkSampleCountFlagBits getSampleCount() { return msaaSamples; }
+  bool usesDynamicRendering() { return dynamicRendering; }
   uint32_t width() { return swapChainExtent.width; }
   uint32_t height() { return swapChainExtent.height; }
 
@@ -36,16 +55,36 @@ class LveSwapChain {
   }
   VkFormat findDepthFormat();
 
+  bool compareSwapFormats(const LveSwapChain &swapChain) const {
+    return swapChain.swapChainDepthFormat == swapChainDepthFormat &&
+           swapChain.swapChainImageFormat == swapChainImageFormat &&
+           swapChain.msaaSamples == msaaSamples &&
+           swapChain.dynamicRendering == dynamicRendering;
+  }
+
+  // Blocks until the GPU has finished the frame that last used the current frame slot.
+  // acquireNextImage calls this too, waiting again on an already signaled fence is cheap.
+  void waitForFrameFence();
   VkResult acquireNextImage(uint32_t *imageIndex);
   VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
 
+  size_t getFrameIndex() { return currentFrame; }
+  // Id given to the most recent present, increases monotonically across swap chain recreation
+  uint64_t lastPresentId() { return presentId; }
+  // Waits until the present with the given id is displayed, VK_NOT_READY if it was never
+  // presented through this swap chain or VK_KHR_present_wait is not available
+  VkResult waitForPresent(uint64_t id, uint64_t timeout);
+
  private:
   void init();
   void createSwapChain();
   void createImageViews();
-  void createDepthResources();
+  void createFrameAttachments(size_t index);
+  void createDepthResources(size_t index);
+  void createColorResources(size_t index);
+  void printSampleCountReport();
   void createRenderPass();
-  void createFramebuffers();
+  void createFramebuffer(size_t imageIndex, size_t frameIndex);
   void createSyncObjects();
 
   // Helper functions
@@ -56,14 +95,22 @@ class LveSwapChain {
   VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities);
 
   VkFormat swapChainImageFormat;
+  VkFormat swapChainDepthFormat;
+  VkSampleCountFlagBits msaaSamples;
   VkExtent2D swapChainExtent;
+  bool dynamicRendering;
 
   std::vector<VkFramebuffer> swapChainFramebuffers;
-  VkRenderPass renderPass;
+  VkRenderPass renderPass = VK_NULL_HANDLE;
 
+  // one per frame in flight, only frames that are actually rendering need depth
   std::vector<VkImage> depthImages;
   std::vector<VkDeviceMemory> depthImageMemorys;
   std::vector<VkImageView> depthImageViews;
+  // multisampled color attachments resolved into the swap chain image, one per frame in flight
+  std::vector<VkImage> colorImages;
+  std::vector<VkDeviceMemory> colorImageMemorys;
+  std::vector<VkImageView> colorImageViews;
   std::vector<VkImage> swapChainImages;
   std::vector<VkImageView> swapChainImageViews;
 
@@ -77,7 +124,12 @@ class LveSwapChain {
   std::vector<VkSemaphore> renderFinishedSemaphores;
   std::vector<VkFence> inFlightFences;
   std::vector<VkFence> imagesInFlight;
+  // deletion queue frame last submitted with each in flight fence
+  std::vector<uint64_t> inFlightFrames;
   size_t currentFrame = 0;
+
+  uint64_t presentId = 0;
+  uint64_t firstPresentId = 1;
 };
 
 }  // namespace lve
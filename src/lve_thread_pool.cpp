@@ -0,0 +1,403 @@
+#include "lve_thread_pool.hpp"
+
+#include "lve_trace.hpp"
+
+// std
+#include <algorithm>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace lve {
+
+class LveThreadPool::Job {
+ public:
+  std::function<void()> task;
+  // dependencies not finished yet, plus one held by submit until all of them are registered
+  std::atomic<uint32_t> pendingDependencies{1};
+  std::atomic<bool> done{false};
+  // threads blocked in wait() on this job
+  std::atomic<uint32_t> waiters{0};
+  // jobs depending on this one, guarded by mutex and only added to before done is set
+  std::mutex mutex;
+  std::vector<JobHandle> continuations;
+  // keeps the job alive while it is queued
+  JobHandle self;
+};
+
+// Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models").
+// The owning worker pushes and pops at the bottom, other threads steal from the top. Only a
+// pop racing a steal for the last job takes a compare-and-swap.
+class LveThreadPool::Deque {
+ public:
+  Deque() { grow(nullptr, 0, 0); }
+
+  // owner only
+  void push(Job *job) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    Buffer *buffer = current.load(std::memory_order_relaxed);
+    if (b - t >= static_cast<int64_t>(buffer->mask)) buffer = grow(buffer, t, b);
+    buffer->slots[b & buffer->mask].store(job, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_seq_cst);
+  }
+
+  // owner only, newest first
+  Job *pop() {
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    Buffer *buffer = current.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_seq_cst);
+    if (t > b) {
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    Job *job = buffer->slots[b & buffer->mask].load(std::memory_order_relaxed);
+    if (t == b) {
+      // the last job, a thief may be taking it too
+      if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst)) job = nullptr;
+      bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+  }
+
+  // any thread, oldest first. Returns null when empty or when another thread won the job.
+  Job *steal() {
+    int64_t t = top.load(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_seq_cst);
+    if (t >= b) return nullptr;
+
+    Buffer *buffer = current.load(std::memory_order_acquire);
+    Job *job = buffer->slots[t & buffer->mask].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst)) return nullptr;
+    return job;
+  }
+
+ private:
+  static constexpr size_t INITIAL_CAPACITY = 256;
+
+  struct Buffer {
+    explicit Buffer(size_t capacity)
+        : mask{capacity - 1}, slots{new std::atomic<Job *>[capacity]} {}
+
+    size_t mask;
+    std::unique_ptr<std::atomic<Job *>[]> slots;
+  };
+
+  // Doubles the buffer. Thieves may still read the old one, so replaced buffers are kept until
+  // the deque is destroyed.
+  Buffer *grow(Buffer *old, int64_t t, int64_t b) {
+    size_t capacity = old ? 2 * (old->mask + 1) : INITIAL_CAPACITY;
+    buffers.push_back(std::make_unique<Buffer>(capacity));
+    Buffer *buffer = buffers.back().get();
+    for (int64_t i = t; i < b; i++) {
+      buffer->slots[i & buffer->mask].store(
+          old->slots[i & old->mask].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    current.store(buffer, std::memory_order_release);
+    return buffer;
+  }
+
+  std::atomic<int64_t> top{0};
+  std::atomic<int64_t> bottom{0};
+  std::atomic<Buffer *> current{nullptr};
+  std::vector<std::unique_ptr<Buffer>> buffers;
+};
+
+namespace {
+
+// set on the pool's own workers, so jobs they submit go onto their deque
+thread_local LveThreadPool *currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+// where each thread starts looking for a victim, so thieves spread over the workers
+thread_local uint32_t stealSeed = 0;
+
+uint32_t nextStealStart(size_t workerCount) {
+  if (stealSeed == 0) {
+    size_t id = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    stealSeed = static_cast<uint32_t>(id) | 1u;
+  }
+  // xorshift32
+  stealSeed ^= stealSeed << 13;
+  stealSeed ^= stealSeed >> 17;
+  stealSeed ^= stealSeed << 5;
+  return stealSeed % static_cast<uint32_t>(workerCount);
+}
+
+// tries before an idle worker goes to sleep, jobs often arrive in quick succession
+constexpr int IDLE_SPINS = 64;
+
+}  // namespace
+
+LveThreadPool::LveThreadPool(size_t workerCount, bool pinWorkers) {
+  if (workerCount == 0) {
+    unsigned int hardwareThreads = std::thread::hardware_concurrency();
+    workerCount = std::max(1u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u);
+  }
+
+  // every deque exists before a worker could steal from it
+  for (size_t i = 0; i < workerCount; i++) {
+    deques.push_back(std::make_unique<Deque>());
+  }
+  size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+  workers.reserve(workerCount);
+  for (size_t i = 0; i < workerCount; i++) {
+    workers.emplace_back([this, i, pinWorkers, hardwareThreads] {
+      // hardware thread 0 is left to the main thread
+      if (pinWorkers) pinCurrentThread((i + 1) % hardwareThreads);
+      workerLoop(i);
+    });
+  }
+}
+
+LveThreadPool::~LveThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock{sleepMutex};
+    stopping = true;
+  }
+  condition.notify_all();
+
+  // queued jobs still run, owners rely on them finishing. Jobs whose dependencies never
+  // finish are dropped.
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+LveThreadPool::JobHandle LveThreadPool::submit(std::function<void()> task) {
+  return submit(std::move(task), {});
+}
+
+LveThreadPool::JobHandle LveThreadPool::submit(
+    std::function<void()> task, const std::vector<JobHandle> &dependencies) {
+  auto job = std::make_shared<Job>();
+  job->task = std::move(task);
+
+  for (const auto &dependency : dependencies) {
+    if (!dependency) continue;
+    std::lock_guard<std::mutex> lock{dependency->mutex};
+    if (dependency->done) continue;
+    job->pendingDependencies++;
+    dependency->continuations.push_back(job);
+  }
+  release(job);
+  return job;
+}
+
+void LveThreadPool::release(const JobHandle &job) {
+  if (job->pendingDependencies.fetch_sub(1) != 1) return;
+  job->self = job;
+  schedule(job.get());
+}
+
+void LveThreadPool::schedule(Job *job) {
+  // counted first, so a sleeping worker never misses a job that is already visible
+  queuedJobs++;
+  if (currentPool == this) {
+    deques[currentWorker]->push(job);
+  } else {
+    std::lock_guard<std::mutex> lock{injectedMutex};
+    injected.push_back(job);
+  }
+  wake();
+}
+
+void LveThreadPool::wait(const JobHandle &job) {
+  if (!job) return;
+  bool worker = currentPool == this;
+
+  while (!job->done) {
+    if (worker) {
+      if (Job *other = findJob()) {
+        run(other);
+        continue;
+      }
+    }
+
+    std::unique_lock<std::mutex> lock{sleepMutex};
+    job->waiters++;
+    if (worker) {
+      sleepers++;
+      condition.wait(lock, [&] { return job->done || queuedJobs > 0; });
+      sleepers--;
+    } else {
+      doneCondition.wait(lock, [&] { return job->done.load(); });
+    }
+    job->waiters--;
+  }
+}
+
+bool LveThreadPool::isDone(const JobHandle &job) { return !job || job->done; }
+
+void LveThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &task) {
+  if (count == 0) return;
+
+  // Helpers may only get to run after every index is taken, the state outlives this call for
+  // them but task is only touched while an index is still unclaimed
+  struct State {
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> finished{0};
+    std::mutex mutex;
+    std::condition_variable done;
+    // the caller is one of the pool's workers and sleeps on the pool's condition instead
+    bool workerCaller = false;
+  };
+  auto state = std::make_shared<State>();
+  state->workerCaller = currentPool == this;
+  const std::function<void(size_t)> *taskPtr = &task;
+
+  auto run = [this, count, taskPtr](State &state) {
+    size_t finished = 0;
+    for (size_t i = state.next++; i < count; i = state.next++) {
+      (*taskPtr)(i);
+      finished++;
+    }
+    if (finished == 0) return;
+
+    if (state.finished.fetch_add(finished) + finished == count) {
+      if (state.workerCaller) {
+        std::lock_guard<std::mutex> lock{sleepMutex};
+        condition.notify_all();
+      } else {
+        std::lock_guard<std::mutex> lock{state.mutex};
+        state.done.notify_one();
+      }
+    }
+  };
+
+  size_t helpers = std::min(workers.size(), count - 1);
+  for (size_t i = 0; i < helpers; i++) {
+    submit([state, run] { run(*state); });
+  }
+  run(*state);
+
+  if (state->workerCaller) {
+    // a worker keeps its deque moving, the indices left are already running elsewhere
+    while (state->finished < count) {
+      if (Job *other = findJob()) {
+        this->run(other);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock{sleepMutex};
+      sleepers++;
+      condition.wait(lock, [&] { return state->finished == count || queuedJobs > 0; });
+      sleepers--;
+    }
+    return;
+  }
+  std::unique_lock<std::mutex> lock{state->mutex};
+  state->done.wait(lock, [&] { return state->finished == count; });
+}
+
+LveThreadPool::Job *LveThreadPool::findJob() {
+  Job *job = nullptr;
+  if (currentPool == this) job = deques[currentWorker]->pop();
+
+  if (!job) {
+    std::lock_guard<std::mutex> lock{injectedMutex};
+    if (!injected.empty()) {
+      job = injected.front();
+      injected.pop_front();
+    }
+  }
+
+  if (!job) {
+    size_t start = nextStealStart(deques.size());
+    for (size_t i = 0; i < deques.size() && !job; i++) {
+      size_t victim = (start + i) % deques.size();
+      if (currentPool == this && victim == currentWorker) continue;
+      job = deques[victim]->steal();
+    }
+  }
+
+  if (job) queuedJobs--;
+  return job;
+}
+
+void LveThreadPool::run(Job *queued) {
+  JobHandle job = std::move(queued->self);
+  {
+    LVE_TRACE_SCOPE("job");
+    job->task();
+  }
+  // captures are released before continuations run
+  job->task = nullptr;
+  finish(*job);
+}
+
+void LveThreadPool::finish(Job &job) {
+  std::vector<JobHandle> continuations;
+  {
+    std::lock_guard<std::mutex> lock{job.mutex};
+    job.done = true;
+    continuations.swap(job.continuations);
+  }
+
+  if (job.waiters > 0) {
+    std::lock_guard<std::mutex> lock{sleepMutex};
+    condition.notify_all();
+    doneCondition.notify_all();
+  }
+  for (const auto &continuation : continuations) {
+    release(continuation);
+  }
+}
+
+void LveThreadPool::wake() {
+  if (sleepers == 0) return;
+  std::lock_guard<std::mutex> lock{sleepMutex};
+  condition.notify_one();
+}
+
+void LveThreadPool::workerLoop(size_t index) {
+  currentPool = this;
+  currentWorker = index;
+  LveTrace::setThreadName("worker");
+
+  int idle = 0;
+  while (true) {
+    if (Job *job = findJob()) {
+      run(job);
+      idle = 0;
+      continue;
+    }
+    if (++idle < IDLE_SPINS) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock{sleepMutex};
+    sleepers++;
+    condition.wait(lock, [this] { return stopping || queuedJobs > 0; });
+    sleepers--;
+    if (stopping && queuedJobs == 0) return;
+    idle = 0;
+  }
+}
+
+bool LveThreadPool::pinCurrentThread(size_t hardwareThread) {
+#if defined(_WIN32)
+  if (hardwareThread >= sizeof(DWORD_PTR) * 8) return false;
+  return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << hardwareThread) != 0;
+#elif defined(__linux__)
+  if (hardwareThread >= CPU_SETSIZE) return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(hardwareThread, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)hardwareThread;
+  return false;
+#endif
+}
+
+}  // namespace lve
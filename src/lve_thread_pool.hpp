@@ -0,0 +1,91 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lve {
+
+// Work-stealing job scheduler. Every worker owns a deque: jobs submitted from a worker go onto
+// its own deque and it takes the newest first, idle workers steal the oldest job of another
+// worker without taking a lock. Jobs submitted from other threads go through a shared queue.
+//
+// A job can depend on earlier ones and is only queued once they all finished, so chains of
+// work are expressed as continuations instead of threads blocking on each other. Tasks must
+// not throw.
+//
+// Workers that wait run other jobs in the meantime, on the same stack, and the wait can't
+// return before the jobs it picked up return. Waits inside jobs must not form a cycle through
+// that: if job A waits and picks up job K, and K waits on a continuation of A, neither ever
+// finishes. Inside a job, only wait for jobs that don't depend on a job that may be waiting
+// itself, e.g. ones it submitted without dependencies, and chain everything else with
+// dependencies.
+class LveThreadPool {
+ public:
+  class Job;
+  using JobHandle = std::shared_ptr<Job>;
+
+  // 0 picks one worker per hardware thread, leaving one for the main thread. With pinWorkers,
+  // worker i runs on hardware thread i + 1 only, where the platform supports it.
+  explicit LveThreadPool(size_t workerCount = 0, bool pinWorkers = false);
+  ~LveThreadPool();
+
+  LveThreadPool(const LveThreadPool &) = delete;
+  LveThreadPool &operator=(const LveThreadPool &) = delete;
+
+  JobHandle submit(std::function<void()> task);
+  // task runs once every job in dependencies finished
+  JobHandle submit(std::function<void()> task, const std::vector<JobHandle> &dependencies);
+  // Returns once job finished. Workers run other jobs meanwhile, other threads block, so the
+  // main thread doesn't pick up unrelated long work such as a pipeline compile. From inside a
+  // job, see above for what job may depend on.
+  void wait(const JobHandle &job);
+  static bool isDone(const JobHandle &job);
+
+  size_t workerCount() { return workers.size(); }
+
+  // Runs task(0) .. task(count - 1) on the workers and the calling thread, returns once all of
+  // them finished. The calling thread keeps taking indices itself, so it never waits on workers
+  // that are still busy with earlier submissions. A worker calling it runs other jobs while the
+  // last indices finish elsewhere, like wait().
+  void parallelFor(size_t count, const std::function<void(size_t)> &task);
+
+  // Restricts the calling thread to one hardware thread. Returns false where unsupported.
+  static bool pinCurrentThread(size_t hardwareThread);
+
+ private:
+  class Deque;
+
+  void workerLoop(size_t index);
+  // drops one of the job's pending dependencies, queues it once none are left
+  void release(const JobHandle &job);
+  void schedule(Job *job);
+  // A queued job from the calling worker's deque, the shared queue or another worker's deque
+  Job *findJob();
+  void run(Job *job);
+  void finish(Job &job);
+  void wake();
+
+  std::vector<std::thread> workers;
+  std::vector<std::unique_ptr<Deque>> deques;  // one per worker
+
+  std::mutex injectedMutex;
+  std::deque<Job *> injected;  // submitted from threads that aren't workers
+
+  // jobs sitting in a deque or the shared queue
+  std::atomic<size_t> queuedJobs{0};
+  std::atomic<uint32_t> sleepers{0};
+  std::mutex sleepMutex;
+  std::condition_variable condition;  // workers, also while they wait for a job
+  std::condition_variable doneCondition;  // other threads waiting for a job
+  std::atomic<bool> stopping{false};
+};
+
+}  // namespace lve
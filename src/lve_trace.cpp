@@ -0,0 +1,195 @@
+#include "lve_trace.hpp"
+
+// std
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace lve {
+
+std::atomic<bool> LveTrace::enabled_{false};
+
+namespace {
+
+struct Event {
+  const char *name;
+  const char *track;  // null for CPU events
+  uint64_t start;
+  uint64_t end;
+};
+
+// Written only by the owning thread. count and next are published with release stores, so the
+// thread writing the file sees complete events without taking a lock.
+struct Chunk {
+  static constexpr size_t CAPACITY = 4096;
+
+  Event events[CAPACITY];
+  std::atomic<size_t> count{0};
+  std::atomic<Chunk *> next{nullptr};
+};
+
+struct ThreadBuffer {
+  uint32_t id;
+  std::string name;
+  // tail is only touched by the owning thread. head and read are only touched by stop(), which
+  // frees chunks once they are read and the owner has moved on to a later one. Both are null
+  // until the thread records its first event.
+  Chunk *head = nullptr;
+  Chunk *tail = nullptr;
+  size_t read = 0;
+
+  ~ThreadBuffer() {
+    while (head) {
+      Chunk *next = head->next.load();
+      delete head;
+      head = next;
+    }
+  }
+};
+
+// Buffers live until the program exits, a thread that ends keeps its events for the next stop()
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+std::string tracePath;
+uint64_t traceStart = 0;
+
+thread_local ThreadBuffer *threadBuffer = nullptr;
+
+ThreadBuffer &currentThreadBuffer() {
+  if (threadBuffer == nullptr) {
+    // once per thread
+    std::lock_guard<std::mutex> lock{registryMutex};
+    auto buffer = std::make_unique<ThreadBuffer>();
+    buffer->id = static_cast<uint32_t>(threadBuffers.size()) + 1;
+    threadBuffer = buffer.get();
+    threadBuffers.push_back(std::move(buffer));
+  }
+  return *threadBuffer;
+}
+
+void push(const Event &event) {
+  ThreadBuffer &buffer = currentThreadBuffer();
+  if (buffer.tail == nullptr) {
+    std::lock_guard<std::mutex> lock{registryMutex};
+    buffer.head = buffer.tail = new Chunk;
+  }
+  Chunk *chunk = buffer.tail;
+  size_t count = chunk->count.load(std::memory_order_relaxed);
+  if (count == Chunk::CAPACITY) {
+    Chunk *next = new Chunk;
+    chunk->next.store(next, std::memory_order_release);
+    buffer.tail = chunk = next;
+    count = 0;
+  }
+  chunk->events[count] = event;
+  chunk->count.store(count + 1, std::memory_order_release);
+}
+
+double microseconds(uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / 1000.0; }
+
+}  // namespace
+
+void LveTrace::start(const std::string &path) {
+  std::lock_guard<std::mutex> lock{registryMutex};
+  tracePath = path;
+  traceStart = now();
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+void LveTrace::stop() {
+  if (!enabled()) return;
+  enabled_.store(false, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock{registryMutex};
+  FILE *file = std::fopen(tracePath.c_str(), "w");
+  if (!file) throw std::runtime_error("failed to open trace file " + tracePath);
+
+  // CPU threads are rows of process 1, GPU tracks rows of process 2
+  std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  std::fprintf(
+      file,
+      "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+      "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}}");
+  std::map<std::string, uint32_t> gpuTracks;
+
+  for (auto &buffer : threadBuffers) {
+    if (!buffer->name.empty()) {
+      std::fprintf(
+          file,
+          ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+          "\"args\":{\"name\":\"%s\"}}",
+          buffer->id,
+          buffer->name.c_str());
+    }
+
+    while (buffer->head) {
+      Chunk *chunk = buffer->head;
+      size_t count = chunk->count.load(std::memory_order_acquire);
+      for (; buffer->read < count; buffer->read++) {
+        const Event &event = chunk->events[buffer->read];
+        // begun before this trace started, e.g. in a previous one
+        if (event.start < traceStart) continue;
+
+        uint32_t pid = 1;
+        uint32_t tid = buffer->id;
+        if (event.track) {
+          auto track = gpuTracks.emplace(event.track, static_cast<uint32_t>(gpuTracks.size()) + 1);
+          if (track.second) {
+            std::fprintf(
+                file,
+                ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":%u,"
+                "\"args\":{\"name\":\"%s\"}}",
+                track.first->second,
+                event.track);
+          }
+          pid = 2;
+          tid = track.first->second;
+        }
+        std::fprintf(
+            file,
+            ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+            event.name,
+            pid,
+            tid,
+            microseconds(event.start - traceStart),
+            microseconds(event.end > event.start ? event.end - event.start : 0));
+      }
+
+      Chunk *next = chunk->next.load(std::memory_order_acquire);
+      // the owner only links a new chunk once this one is full, everything in it is read
+      if (next == nullptr) break;
+      delete chunk;
+      buffer->head = next;
+      buffer->read = 0;
+    }
+  }
+
+  std::fprintf(file, "\n]}\n");
+  std::fclose(file);
+}
+
+uint64_t LveTrace::now() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+}
+
+void LveTrace::cpuEvent(const char *name, uint64_t start, uint64_t end) {
+  push({name, nullptr, start, end});
+}
+
+void LveTrace::gpuEvent(const char *name, const char *track, uint64_t start, uint64_t end) {
+  push({name, track, start, end});
+}
+
+void LveTrace::setThreadName(const char *name) {
+  ThreadBuffer &buffer = currentThreadBuffer();
+  std::lock_guard<std::mutex> lock{registryMutex};
+  if (buffer.name.empty()) buffer.name = name;
+}
+
+}  // namespace lve
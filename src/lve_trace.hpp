@@ -0,0 +1,63 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace lve {
+
+// Records CPU and GPU events into a Chrome trace (chrome://tracing, ui.perfetto.dev). Each thread
+// appends to its own buffer without locks, so recording costs a clock read and a store, and
+// when tracing is off a scope costs one relaxed atomic load. Names must be string literals or
+// otherwise outlive the trace.
+//
+//   LveTrace::start("trace.json");
+//   { LVE_TRACE_SCOPE("update"); ... }
+//   LveTrace::stop();  // writes the file
+//
+// GPU events are passed in already converted to now()'s clock, see LveGpuTimer.
+class LveTrace {
+ public:
+  static void start(const std::string &path);
+  // Writes every event recorded since start(). Events still being recorded on other threads
+  // may be left out.
+  static void stop();
+
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+  // Nanoseconds on std::chrono::steady_clock
+  static uint64_t now();
+
+  static void cpuEvent(const char *name, uint64_t start, uint64_t end);
+  // Shown on its own row per track, e.g. one per queue
+  static void gpuEvent(const char *name, const char *track, uint64_t start, uint64_t end);
+  // Label of the calling thread's row, the first call on each thread wins
+  static void setThreadName(const char *name);
+
+ private:
+  static std::atomic<bool> enabled_;
+};
+
+class LveTraceScope {
+ public:
+  explicit LveTraceScope(const char *name)
+      : name{name}, start{LveTrace::enabled() ? LveTrace::now() : 0} {}
+  ~LveTraceScope() {
+    if (start != 0 && LveTrace::enabled()) LveTrace::cpuEvent(name, start, LveTrace::now());
+  }
+
+  LveTraceScope(const LveTraceScope &) = delete;
+  LveTraceScope &operator=(const LveTraceScope &) = delete;
+
+ private:
+  const char *name;
+  uint64_t start;
+};
+
+}  // namespace lve
+
+#define LVE_TRACE_CONCAT_(a, b) a##b
+#define LVE_TRACE_CONCAT(a, b) LVE_TRACE_CONCAT_(a, b)
+// Traces the rest of the enclosing block
+#define LVE_TRACE_SCOPE(name) \
+  ::lve::LveTraceScope LVE_TRACE_CONCAT(lveTraceScope, __LINE__) { name }
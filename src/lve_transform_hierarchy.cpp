@@ -0,0 +1,163 @@
+#include "lve_transform_hierarchy.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+
+namespace lve {
+
+namespace {
+// Levels smaller than this are swept on the calling thread, splitting them costs more than the
+// matrix products
+constexpr uint32_t PARALLEL_CHUNK_SIZE = 4096;
+}  // namespace
+
+void LveTransformHierarchy::reserve(size_t nodeCount) {
+  indices.reserve(nodeCount);
+  parentNodes.reserve(nodeCount);
+  depths.reserve(nodeCount);
+  parents.reserve(nodeCount);
+  locals.reserve(nodeCount);
+  worlds.reserve(nodeCount);
+  dirty.reserve(nodeCount);
+  changed.reserve(nodeCount);
+  nodes.reserve(nodeCount);
+}
+
+LveTransformHierarchy::Node LveTransformHierarchy::createNode(
+    Node parent, const glm::mat4 &localTransform) {
+  assert((parent == INVALID_NODE || parent < indices.size()) && "Parent node does not exist");
+
+  Node node = static_cast<Node>(indices.size());
+  uint32_t depth = parent == INVALID_NODE ? 0 : depths[parent] + 1;
+  uint32_t position = static_cast<uint32_t>(nodes.size());
+
+  // appending keeps the depth order as long as the node doesn't go above the deepest level,
+  // otherwise the arrays are re-sorted once on the next update
+  uint32_t deepest = static_cast<uint32_t>(levelOffsets.size()) - 2;
+  if (!nodes.empty() && depth < deepest) {
+    sorted = false;
+  }
+
+  indices.push_back(position);
+  parentNodes.push_back(parent);
+  depths.push_back(depth);
+
+  parents.push_back(parent == INVALID_NODE ? INVALID_NODE : indices[parent]);
+  locals.push_back(localTransform);
+  worlds.push_back(localTransform);
+  dirty.push_back(1);
+  changed.push_back(0);
+  nodes.push_back(node);
+
+  if (sorted) {
+    if (depth + 2 > levelOffsets.size()) {
+      levelOffsets.push_back(levelOffsets.back());
+    }
+    levelOffsets.back()++;
+  }
+  minDirtyDepth = std::min(minDirtyDepth, depth);
+  return node;
+}
+
+void LveTransformHierarchy::setLocalTransform(Node node, const glm::mat4 &localTransform) {
+  uint32_t position = indices[node];
+  locals[position] = localTransform;
+  dirty[position] = 1;
+  minDirtyDepth = std::min(minDirtyDepth, depths[node]);
+}
+
+void LveTransformHierarchy::sortByDepth() {
+  uint32_t levelCount = *std::max_element(depths.begin(), depths.end()) + 1;
+
+  // counting sort, stable so a parent added before its child stays before it
+  levelOffsets.assign(levelCount + 1, 0);
+  for (uint32_t depth : depths) levelOffsets[depth + 1]++;
+  for (uint32_t level = 0; level < levelCount; level++) {
+    levelOffsets[level + 1] += levelOffsets[level];
+  }
+
+  std::vector<uint32_t> next(levelOffsets.begin(), levelOffsets.end() - 1);
+  std::vector<uint32_t> newIndices(indices.size());
+  for (uint32_t position = 0; position < nodes.size(); position++) {
+    Node node = nodes[position];
+    newIndices[node] = next[depths[node]]++;
+  }
+
+  auto permute = [&](auto &values) {
+    std::remove_reference_t<decltype(values)> sortedValues(values.size());
+    for (uint32_t position = 0; position < nodes.size(); position++) {
+      sortedValues[newIndices[nodes[position]]] = values[position];
+    }
+    values.swap(sortedValues);
+  };
+  permute(locals);
+  permute(worlds);
+  permute(dirty);
+  permute(nodes);
+
+  indices.swap(newIndices);
+  for (uint32_t position = 0; position < nodes.size(); position++) {
+    Node parent = parentNodes[nodes[position]];
+    parents[position] = parent == INVALID_NODE ? INVALID_NODE : indices[parent];
+  }
+  sorted = true;
+}
+
+uint32_t LveTransformHierarchy::updateRange(uint32_t begin, uint32_t end) {
+  uint32_t updated = 0;
+  for (uint32_t i = begin; i < end; i++) {
+    uint32_t parent = parents[i];
+    bool parentChanged = parent != INVALID_NODE && changed[parent];
+    if (!dirty[i] && !parentChanged) continue;
+
+    worlds[i] = parent == INVALID_NODE ? locals[i] : worlds[parent] * locals[i];
+    dirty[i] = 0;
+    changed[i] = 1;
+    updated++;
+  }
+  return updated;
+}
+
+void LveTransformHierarchy::update(LveThreadPool *threadPool) {
+  stats_.resorted = false;
+  if (!sorted) {
+    sortByDepth();
+    stats_.resorted = true;
+  }
+
+  uint32_t levelCount = static_cast<uint32_t>(levelOffsets.size()) - 1;
+  stats_.nodes = static_cast<uint32_t>(nodes.size());
+  stats_.levels = levelCount;
+  stats_.updatedNodes = 0;
+
+  std::memset(changed.data(), 0, changed.size());
+  // nothing above the shallowest dirty node can change
+  uint32_t firstLevel = std::min(minDirtyDepth, levelCount);
+  stats_.skippedLevels = firstLevel;
+  minDirtyDepth = UINT32_MAX;
+
+  for (uint32_t level = firstLevel; level < levelCount; level++) {
+    uint32_t begin = levelOffsets[level];
+    uint32_t end = levelOffsets[level + 1];
+    uint32_t chunks = (end - begin + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+
+    if (threadPool == nullptr || chunks < 2) {
+      stats_.updatedNodes += updateRange(begin, end);
+      continue;
+    }
+
+    std::atomic<uint32_t> updated{0};
+    threadPool->parallelFor(chunks, [&](size_t chunk) {
+      uint32_t chunkBegin = begin + static_cast<uint32_t>(chunk) * PARALLEL_CHUNK_SIZE;
+      uint32_t chunkEnd = std::min(end, chunkBegin + PARALLEL_CHUNK_SIZE);
+      updated.fetch_add(updateRange(chunkBegin, chunkEnd), std::memory_order_relaxed);
+    });
+    stats_.updatedNodes += updated.load(std::memory_order_relaxed);
+  }
+}
+
+}  // namespace lve
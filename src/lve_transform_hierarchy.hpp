@@ -0,0 +1,83 @@
+#pragma once
+
+#include "lve_thread_pool.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Parent/child transforms for the scene. Node data is kept in separate arrays ordered by depth
+// in the tree, so every parent is stored before its children and update() is one linear sweep
+// per level. Only nodes whose local transform changed, and their descendants, have their world
+// transform recomputed. Nodes on the same level don't depend on each other, large levels are
+// split across a thread pool.
+//
+// Nodes are referred to by a stable handle, their position in the arrays changes when a node is
+// added above the deepest level and the arrays are re-sorted on the next update.
+class LveTransformHierarchy {
+ public:
+  using Node = uint32_t;
+  static constexpr Node INVALID_NODE = UINT32_MAX;
+
+  struct Stats {
+    uint32_t nodes = 0;
+    uint32_t levels = 0;
+    // of the last update
+    uint32_t updatedNodes = 0;
+    uint32_t skippedLevels = 0;
+    bool resorted = false;
+  };
+
+  LveTransformHierarchy() = default;
+
+  LveTransformHierarchy(const LveTransformHierarchy &) = delete;
+  LveTransformHierarchy &operator=(const LveTransformHierarchy &) = delete;
+
+  void reserve(size_t nodeCount);
+  Node createNode(Node parent = INVALID_NODE, const glm::mat4 &localTransform = glm::mat4{1.f});
+
+  void setLocalTransform(Node node, const glm::mat4 &localTransform);
+  const glm::mat4 &localTransform(Node node) const { return locals[indices[node]]; }
+  // As of the last update
+  const glm::mat4 &worldTransform(Node node) const { return worlds[indices[node]]; }
+  bool worldChanged(Node node) const { return changed[indices[node]] != 0; }
+  Node parent(Node node) const { return parentNodes[node]; }
+  size_t size() const { return indices.size(); }
+
+  // Recomputes the world transform of every dirty node and its descendants
+  void update(LveThreadPool *threadPool = nullptr);
+
+  const Stats &stats() const { return stats_; }
+
+ private:
+  void sortByDepth();
+  uint32_t updateRange(uint32_t begin, uint32_t end);
+
+  // indexed by Node
+  std::vector<uint32_t> indices;
+  std::vector<Node> parentNodes;
+  std::vector<uint32_t> depths;
+
+  // indexed by position, ordered by depth
+  std::vector<uint32_t> parents;  // position of the parent, INVALID_NODE for roots
+  std::vector<glm::mat4> locals;
+  std::vector<glm::mat4> worlds;
+  std::vector<uint8_t> dirty;    // local transform changed since the last update
+  std::vector<uint8_t> changed;  // world transform recomputed by the last update
+  std::vector<Node> nodes;
+
+  // positions [levelOffsets[d], levelOffsets[d + 1]) hold the nodes of depth d
+  std::vector<uint32_t> levelOffsets{0};
+  uint32_t minDirtyDepth = UINT32_MAX;
+  bool sorted = true;
+  Stats stats_;
+};
+
+}  // namespace lve
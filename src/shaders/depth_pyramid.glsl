@@ -0,0 +1,40 @@
+// Shared by depth_pyramid.comp and depth_pyramid_ms.comp, which define loadDepth().
+// Each texel keeps the farthest depth of the 2x2 source texels below it. Levels are halved
+// rounding down, so the last row and column also take the texels an odd size leaves over and
+// every source texel is covered.
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (set = 0, binding = 1, r32f) uniform writeonly image2D destination;
+
+layout (push_constant) uniform Push {
+  uvec2 sourceSize;
+  uvec2 destinationSize;
+  uint samples;
+} push;
+
+float loadDepth(ivec2 texel);
+
+void main() {
+  uvec2 texel = gl_GlobalInvocationID.xy;
+  if (any(greaterThanEqual(texel, push.destinationSize))) {
+    return;
+  }
+
+  uvec2 first = texel * 2;
+  uvec2 last = min(first + 1, push.sourceSize - 1);
+  if (texel.x == push.destinationSize.x - 1) {
+    last.x = push.sourceSize.x - 1;
+  }
+  if (texel.y == push.destinationSize.y - 1) {
+    last.y = push.sourceSize.y - 1;
+  }
+
+  float farthest = 0.0;
+  for (uint y = first.y; y <= last.y; y++) {
+    for (uint x = first.x; x <= last.x; x++) {
+      farthest = max(farthest, loadDepth(ivec2(x, y)));
+    }
+  }
+  imageStore(destination, ivec2(texel), vec4(farthest));
+}
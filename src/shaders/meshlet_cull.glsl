@@ -0,0 +1,76 @@
+// Shared by meshlet_cull.comp and meshlet_occlusion_cull.comp
+
+struct Meshlet {
+  vec4 sphere;      // xyz center, w radius
+  vec4 coneApex;    // xyz apex
+  vec4 coneAxis;    // xyz axis, w cutoff
+  uint firstIndex;
+  uint indexCount;
+  uint padding0;
+  uint padding1;
+};
+
+// VkDrawIndexedIndirectCommand
+struct DrawCommand {
+  uint indexCount;
+  uint instanceCount;
+  uint firstIndex;
+  int vertexOffset;
+  uint firstInstance;
+};
+
+layout (std430, set = 0, binding = 0) readonly buffer Meshlets {
+  Meshlet meshlets[];
+};
+
+layout (std430, set = 0, binding = 1) writeonly buffer DrawCommands {
+  DrawCommand drawCommands[];
+};
+
+layout (std430, set = 0, binding = 2) buffer Counters {
+  uint drawn;
+  uint frustumCulled;
+  uint backfaceCulled;
+  uint occlusionCulled;
+};
+
+// One entry per meshlet, whether it passed the occlusion test last frame
+layout (std430, set = 0, binding = 3) buffer Visibility {
+  uint visibility[];
+};
+
+layout (push_constant) uniform Push {
+  mat4 modelViewProjection;
+  vec4 camera;     // w = 1: position in model space, w = 0: view direction
+  uint meshletCount;
+  uint backfaceCulling;
+  uint phase;      // see LveMeshletCuller::Phase
+  uint pyramidLevels;
+  uvec2 depthSize;
+} push;
+
+// Gribb/Hartmann planes for clip space with 0 <= z <= w, the sphere is tested in model space
+bool insideFrustum(vec4 sphere) {
+  mat4 m = transpose(push.modelViewProjection);
+  vec4 planes[6] = vec4[](m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[2], m[3] - m[2]);
+  for (int i = 0; i < 6; i++) {
+    float scale = length(planes[i].xyz);
+    if (scale > 0.0 && dot(planes[i].xyz, sphere.xyz) + planes[i].w < -sphere.w * scale) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool backfacing(Meshlet meshlet) {
+  if (push.backfaceCulling == 0) {
+    return false;
+  }
+  vec3 view = push.camera.w == 0.0 ? push.camera.xyz
+                                   : normalize(meshlet.coneApex.xyz - push.camera.xyz);
+  return dot(view, meshlet.coneAxis.xyz) >= meshlet.coneAxis.w;
+}
+
+void writeDraw(uint index, Meshlet meshlet, bool draw) {
+  drawCommands[index] = DrawCommand(meshlet.indexCount, draw ? 1 : 0, meshlet.firstIndex, 0, 0);
+}
@@ -1,9 +1,16 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "simple_shader_effects.glsl"
+
+// Specialized at pipeline creation, the disabled paths are compiled out
+layout (constant_id = 0) const bool GRAYSCALE = false;
+layout (constant_id = 1) const bool CONTRAST = false;
+layout (constant_id = 2) const bool POSTERIZE = false;
 
 layout (location = 0) in vec3 fragColor;
 layout (location = 0) out vec4 outColor;
 
 void main() {
-  outColor = vec4(fragColor, 1.0);
+  outColor = vec4(applyEffects(fragColor, GRAYSCALE, CONTRAST, POSTERIZE), 1.0);
 }
-
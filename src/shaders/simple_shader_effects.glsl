@@ -0,0 +1,16 @@
+// Shared by simple_shader.frag, where specialization constants select the effects, and
+// simple_shader_uber.frag, which branches on them at runtime. The same code either way, so the
+// two only differ in how the effects are selected.
+
+vec3 applyEffects(vec3 color, bool grayscale, bool contrast, bool posterize) {
+  if (grayscale) {
+    color = vec3(dot(color, vec3(0.299, 0.587, 0.114)));
+  }
+  if (contrast) {
+    color = smoothstep(0.0, 1.0, color);
+  }
+  if (posterize) {
+    color = floor(color * 4.0 + 0.5) / 4.0;
+  }
+  return color;
+}
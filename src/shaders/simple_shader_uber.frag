@@ -0,0 +1,28 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// simple_shader.frag with the effects picked per draw instead of per pipeline, one pipeline
+// serves every combination at the cost of runtime branches
+
+#include "simple_shader_effects.glsl"
+
+const uint EFFECT_GRAYSCALE = 1u;
+const uint EFFECT_CONTRAST = 2u;
+const uint EFFECT_POSTERIZE = 4u;
+
+layout (push_constant) uniform Push {
+  uint effects;
+} push;
+
+layout (location = 0) in vec3 fragColor;
+layout (location = 0) out vec4 outColor;
+
+void main() {
+  outColor = vec4(
+      applyEffects(
+          fragColor,
+          (push.effects & EFFECT_GRAYSCALE) != 0u,
+          (push.effects & EFFECT_CONTRAST) != 0u,
+          (push.effects & EFFECT_POSTERIZE) != 0u),
+      1.0);
+}